@@ -46,4 +46,23 @@ tinyrt::AVX2Float abs(const tinyrt::AVX2Float& f) {
       _mm256_castsi256_ps(_mm256_set1_epi32(1 << 31));
   return _mm256_andnot_ps(kSignMask, f.avx);
 }
+
+tinyrt::AVX2Float floor(const tinyrt::AVX2Float& f) {
+  return _mm256_floor_ps(f.avx);
+}
+
+tinyrt::AVX2Float logb(const tinyrt::AVX2Float& f) {
+  const auto biased =
+      _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(f.avx), 23),
+                       _mm256_set1_epi32(0xff));
+  return _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(127)));
+}
+
+tinyrt::AVX2Float ldexp(const tinyrt::AVX2Float& f,
+                        const tinyrt::AVX2Float& exp) {
+  const auto scale = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(exp.avx), _mm256_set1_epi32(127)),
+      23);
+  return _mm256_mul_ps(f.avx, _mm256_castsi256_ps(scale));
+}
 }  // namespace std
@@ -24,6 +24,9 @@
 
 #include <immintrin.h>
 
+#include <cstdint>
+#include <ostream>
+
 #include "util/algorithm.h"
 
 namespace tinyrt {
@@ -33,6 +36,10 @@ class AVX2Float final {
   /*implicit*/ AVX2Float(const float source) : avx(_mm256_set1_ps(source)) {}
   /*implicit*/ AVX2Float(const __m256 source) : avx(source) {}
 
+  AVX2Float operator-() const {
+    return _mm256_xor_ps(avx, _mm256_set1_ps(-0.f));
+  }
+
   AVX2Float operator+(const AVX2Float& other) const {
     return _mm256_add_ps(avx, other.avx);
   }
@@ -142,6 +149,10 @@ class AVX2Float final {
     return _mm256_blendv_ps(_mm256_set1_ps(replace), avx, mask.avx);
   }
 
+  AVX2Float retain(const AVX2Float& mask, const AVX2Float& replace) const {
+    return _mm256_blendv_ps(replace.avx, avx, mask.avx);
+  }
+
   friend AVX2Float operator/(const float a, const AVX2Float& b) {
     return AVX2Float(a) / b;
   }
@@ -162,9 +173,30 @@ const tinyrt::AVX2Float min<tinyrt::AVX2Float>(const tinyrt::AVX2Float& a,
 template <>
 const tinyrt::AVX2Float max<tinyrt::AVX2Float>(const tinyrt::AVX2Float& a,
                                                const tinyrt::AVX2Float& b);
+
+// Defined inline so that Vec3T arithmetic compiles to plain FMA sequences.
+template <>
+inline const tinyrt::AVX2Float fma<tinyrt::AVX2Float>(
+    const tinyrt::AVX2Float& a, const tinyrt::AVX2Float& b,
+    const tinyrt::AVX2Float& c) {
+  return _mm256_fmadd_ps(a.avx, b.avx, c.avx);
+}
+
+template <>
+inline const tinyrt::AVX2Float fms<tinyrt::AVX2Float>(
+    const tinyrt::AVX2Float& a, const tinyrt::AVX2Float& b,
+    const tinyrt::AVX2Float& c) {
+  return _mm256_fmsub_ps(a.avx, b.avx, c.avx);
+}
 }  // namespace tinyrt
 
 namespace std {
 tinyrt::AVX2Float sqrt(const tinyrt::AVX2Float& f);
 tinyrt::AVX2Float abs(const tinyrt::AVX2Float& f);
+tinyrt::AVX2Float floor(const tinyrt::AVX2Float& f);
+// Unbiased exponent of normal floats.
+tinyrt::AVX2Float logb(const tinyrt::AVX2Float& f);
+// Scales by 2^exp for integral exp in [-126, 127].
+tinyrt::AVX2Float ldexp(const tinyrt::AVX2Float& f,
+                        const tinyrt::AVX2Float& exp);
 }  // namespace std
\ No newline at end of file
@@ -44,4 +44,17 @@ tinyrt::AVX512Float sqrt(const tinyrt::AVX512Float& f) {
 tinyrt::AVX512Float abs(const tinyrt::AVX512Float& f) {
   return _mm512_abs_ps(f.avx);
 }
+
+tinyrt::AVX512Float floor(const tinyrt::AVX512Float& f) {
+  return _mm512_floor_ps(f.avx);
+}
+
+tinyrt::AVX512Float logb(const tinyrt::AVX512Float& f) {
+  return _mm512_getexp_ps(f.avx);
+}
+
+tinyrt::AVX512Float ldexp(const tinyrt::AVX512Float& f,
+                          const tinyrt::AVX512Float& exp) {
+  return _mm512_scalef_ps(f.avx, exp.avx);
+}
 }  // namespace std
@@ -24,6 +24,8 @@
 
 #include <immintrin.h>
 
+#include <cstdint>
+
 #include "util/algorithm.h"
 
 namespace tinyrt {
@@ -49,6 +51,10 @@ class AVX512Float final {
   /*implicit*/ AVX512Float(const float source) : avx(_mm512_set1_ps(source)) {}
   /*implicit*/ AVX512Float(const __m512 source) : avx(source) {}
 
+  AVX512Float operator-() const {
+    return _mm512_sub_ps(_mm512_setzero_ps(), avx);
+  }
+
   AVX512Float operator+(const AVX512Float& other) const {
     return _mm512_add_ps(avx, other.avx);
   }
@@ -135,6 +141,11 @@ class AVX512Float final {
     return _mm512_mask_blend_ps(mask.mask, _mm512_set1_ps(replace), avx);
   }
 
+  AVX512Float retain(const AVX512FMask& mask,
+                     const AVX512Float& replace) const {
+    return _mm512_mask_blend_ps(mask.mask, replace.avx, avx);
+  }
+
   friend AVX512Float operator/(const float a, const AVX512Float& b) {
     return AVX512Float(a) / b;
   }
@@ -153,9 +164,30 @@ const tinyrt::AVX512Float min<tinyrt::AVX512Float>(
 template <>
 const tinyrt::AVX512Float max<tinyrt::AVX512Float>(
     const tinyrt::AVX512Float& a, const tinyrt::AVX512Float& b);
+
+// Defined inline so that Vec3T arithmetic compiles to plain FMA sequences.
+template <>
+inline const tinyrt::AVX512Float fma<tinyrt::AVX512Float>(
+    const tinyrt::AVX512Float& a, const tinyrt::AVX512Float& b,
+    const tinyrt::AVX512Float& c) {
+  return _mm512_fmadd_ps(a.avx, b.avx, c.avx);
+}
+
+template <>
+inline const tinyrt::AVX512Float fms<tinyrt::AVX512Float>(
+    const tinyrt::AVX512Float& a, const tinyrt::AVX512Float& b,
+    const tinyrt::AVX512Float& c) {
+  return _mm512_fmsub_ps(a.avx, b.avx, c.avx);
+}
 }  // namespace tinyrt
 
 namespace std {
 tinyrt::AVX512Float sqrt(const tinyrt::AVX512Float& f);
 tinyrt::AVX512Float abs(const tinyrt::AVX512Float& f);
+tinyrt::AVX512Float floor(const tinyrt::AVX512Float& f);
+// Unbiased exponent of normal floats.
+tinyrt::AVX512Float logb(const tinyrt::AVX512Float& f);
+// Scales by 2^exp for integral exp in [-126, 127].
+tinyrt::AVX512Float ldexp(const tinyrt::AVX512Float& f,
+                          const tinyrt::AVX512Float& exp);
 }  // namespace std
\ No newline at end of file
@@ -33,13 +33,17 @@ std::optional<Intersection> BasicIntersecter::intersect(const Ray& ray) const {
   if (!scene_) {
     throw std::runtime_error("Must initialize with a scene first!");
   }
-  std::optional<Intersection> intersection;
-  for (const auto& triangle : scene_->triangles()) {
-    auto candidate = ::tinyrt::intersect(ray, *triangle);
-    if (candidate && (!intersection || intersection->time > candidate->time)) {
-      intersection = candidate;
+  std::optional<Hit> hit;
+  const auto& mesh = scene_->mesh();
+  for (auto primitive = 0U; primitive < mesh.size(); ++primitive) {
+    auto candidate = ::tinyrt::intersect(ray, mesh, primitive);
+    if (candidate && (!hit || hit->time > candidate->time)) {
+      hit = candidate;
     }
   }
-  return intersection;
+  if (!hit) {
+    return std::nullopt;
+  }
+  return Intersection(ray, *hit, *scene_);
 }
 }  // namespace tinyrt
@@ -0,0 +1,174 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+#include "core/camera.h"
+#include "core/framebuffer.h"
+#include "core/image_writer.h"
+#include "core/rasterizer.h"
+#include "util/async.h"
+#include "util/json.h"
+#include "util/log.h"
+
+namespace tinyrt {
+std::vector<Job> readViews(const std::string& path, const Job& defaults) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  std::vector<Job> views;
+  for (std::string line; std::getline(in, line);) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    const auto& view =
+        views.emplace_back(parseJob(Json::parse(line), defaults));
+    if (view.scenePath != defaults.scenePath ||
+        view.meshOptions.quantizePositions !=
+            defaults.meshOptions.quantizePositions) {
+      throw std::runtime_error("Views must all be of the -obj scene");
+    }
+  }
+  return views;
+}
+
+std::vector<Job> turntable(const Job& base, const Vec3& center,
+                           const unsigned n) {
+  const auto axis = base.up.normalize();
+  // Rodrigues' rotation about axis.
+  const auto rotate = [&](const Vec3& v, const float angle) {
+    return v * std::cos(angle) + axis.cross(v) * std::sin(angle) +
+           axis * (axis.dot(v) * (1 - std::cos(angle)));
+  };
+  const std::filesystem::path out(base.outPath);
+  std::vector<Job> views;
+  for (auto i = 0U; i < n; ++i) {
+    const float angle = 2 * M_PI * i / n;
+    auto& view = views.emplace_back(base);
+    view.position = center + rotate(base.position - center, angle);
+    view.direction = rotate(base.direction, angle);
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%04u", i);
+    view.outPath = (out.parent_path() / (out.stem().string() + number +
+                                         out.extension().string()))
+                       .string();
+  }
+  return views;
+}
+
+void renderBatch(const std::vector<Job>& views, const Scene& scene,
+                 const Renderer& renderer) {
+  for (const auto& view : views) {
+    if (view.preview || view.bandRows > 0 || !view.checkpointPath.empty()) {
+      throw std::runtime_error(
+          "Batch views cannot have previews, bands or checkpoints: " +
+          view.outPath);
+    }
+  }
+  struct View {
+    Camera::RayGenerator rayGenerator;
+    Framebuffer result;
+    Progress progress;
+    ImageWriter writer;
+    std::optional<GBuffer> gbuffer;
+  };
+  std::vector<std::unique_ptr<View>> states;
+  // Index of the first task of each view.
+  std::vector<unsigned> firstTasks;
+  auto totalBlocks = 0U;
+  for (const auto& view : views) {
+    const auto& state = states.emplace_back(new View{
+        Camera(view.position, view.direction, view.up, view.fov)
+            .adapt(view.width, view.height),
+        Framebuffer(view.width, view.height, view.region()),
+        Progress(view.width, view.height, view.region()),
+        ImageWriter(view.outPath, view.width, view.height, view.region()),
+        std::nullopt,
+    });
+    // rasterize() uses the thread pool itself, so it can't run from the
+    // tasks below.
+    if (view.rasterSamples > 0) {
+      state->gbuffer.emplace(view.width, view.height, view.region(),
+                             jitteredOffsets(view.rasterSamples, view.seed));
+      rasterize(scene, state->rayGenerator, *state->gbuffer);
+    }
+    firstTasks.push_back(totalBlocks);
+    totalBlocks += state->result.numTiles();
+  }
+
+  LOG(INFO) << "Rendering " << views.size() << " views.";
+  const auto begin = std::chrono::steady_clock::now();
+  std::atomic_uint completed = 0;
+  Async::submitN(
+      [&](const unsigned task) {
+        const auto index =
+            std::upper_bound(firstTasks.begin(), firstTasks.end(), task) -
+            firstTasks.begin() - 1;
+        const auto& view = views[index];
+        auto& state = *states[index];
+        const auto pixels = state.result.tile(task - firstTasks[index]);
+        TraceOptions options{
+            .indirectRays = 1,
+            .shadowRays = 1,
+        };
+        const auto passSamples = std::max(view.passSamples, 1U);
+        for (auto done = 0U; done < view.samples;
+             done += options.directRays) {
+          options.directRays = std::min(passSamples, view.samples - done);
+          if (state.gbuffer) {
+            renderer.renderRasterizedPass(scene, state.rayGenerator, options,
+                                          view.seed, pixels, *state.gbuffer,
+                                          state.progress, state.result);
+          } else {
+            renderer.renderPass(scene, state.rayGenerator, options, view.seed,
+                                pixels, state.progress, state.result);
+          }
+        }
+        state.writer.submit(state.result, pixels);
+        const auto completedBlocks = ++completed;
+        if (completedBlocks % std::max(totalBlocks / 10, 1U) == 0) {
+          LOG(INFO) << "Finished " << completedBlocks << "/" << totalBlocks;
+        }
+      },
+      totalBlocks);
+  for (auto& state : states) {
+    state->writer.finish();
+  }
+  LOG(INFO) << "Rendering finished. Time elapsed="
+            << std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now() - begin)
+                   .count()
+            << "s.";
+}
+}  // namespace tinyrt
@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/job.h"
+#include "core/render.h"
+#include "core/scene.h"
+#include "core/vec3.h"
+
+namespace tinyrt {
+// Views of defaults' scene from a file of parseJob() lines, blank lines
+// skipped. Throws std::runtime_error if the file does not open or a view
+// names another scene.
+std::vector<Job> readViews(const std::string& path, const Job& defaults);
+
+// n views orbiting base's camera about the axis through center along its up
+// vector, each written to base's output path with the view number before
+// the extension.
+std::vector<Job> turntable(const Job& base, const Vec3& center, unsigned n);
+
+// Renders several views of one scene in one go. The tiles of all views share
+// one pool of work, so threads that run out of tiles in one image carry on
+// with the next rather than idle through its tail. Each tile runs all of its
+// passes in a row, which gives the same pixels as render(); views with
+// rasterSamples have their G-buffers rasterized up front.
+//
+// Previews, bands and checkpoints are for single renders. Throws
+// std::runtime_error for views that ask for them.
+void renderBatch(const std::vector<Job>& views, const Scene& scene,
+                 const Renderer& renderer);
+}  // namespace tinyrt
@@ -22,9 +22,7 @@
 
 #include "core/bounding_box.h"
 
-#include <chrono>
 #include <limits>
-#include <random>
 
 namespace tinyrt {
 namespace {
@@ -54,15 +52,13 @@ float BoundingBox::area() const {
   return (size_->x * size_->y + size_->x * size_->z + size_->y * size_->z) * 2;
 }
 
-Vec3 BoundingBox::random() const {
+Vec3 BoundingBox::random(Random& random) const {
   if (min_.same(max_)) {
     return min_;
   }
-  static thread_local std::mt19937 generator;
-  std::uniform_real_distribution gen(0.f, 1.f);
   Vec3 pos = size_;
   for (auto i = 0; i < 3; ++i) {
-    pos[i] *= gen(generator);
+    pos[i] *= random.uniform();
   }
   return min_ + pos;
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "core/random.h"
 #include "core/vec3.h"
 
 namespace tinyrt {
@@ -31,7 +32,7 @@ class BoundingBox final {
   BoundingBox(const Vec3& min, const Vec3& max);
 
   bool contains(const Vec3& point) const;
-  Vec3 random() const;
+  Vec3 random(Random& random) const;
   const Vec3& center() const;
   const Vec3& size() const;
   float area() const;
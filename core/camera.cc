@@ -30,8 +30,8 @@ Camera::Camera(const Vec3& position, const Vec3& direction, const Vec3& up,
       up_(up.normalize()),
       fov_(fov) {}
 
-std::function<Ray(float, float)> Camera::adapt(const unsigned width,
-                                               const unsigned height) const {
+Camera::RayGenerator Camera::adapt(const unsigned width,
+                                   const unsigned height) const {
   const auto aspectRatio = width * 1.f / height;
   const auto left = up_.cross(direction_);
   const auto fov = std::tan(fov_ / 360 * M_PI);
@@ -40,8 +40,12 @@ std::function<Ray(float, float)> Camera::adapt(const unsigned width,
   const auto topLeft = position_ + direction_ + adaptedUp + adaptedLeft;
   const auto xbasis = -adaptedLeft * 2.f / width;
   const auto ybasis = -adaptedUp * 2.f / height;
-  return [position = position_, topLeft, xbasis, ybasis](float x, float y) {
-    return Ray(position, topLeft + xbasis * x + ybasis * y - position);
+  return RayGenerator{
+      .position = position_,
+      .topLeft = topLeft,
+      .xbasis = xbasis,
+      .ybasis = ybasis,
+      .spread = ybasis.norm(),
   };
 }
 }  // namespace tinyrt
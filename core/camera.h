@@ -22,17 +22,51 @@
 
 #pragma once
 
-#include <functional>
+#include <optional>
+#include <utility>
 
 #include "core/intersecter.h"
 
 namespace tinyrt {
 class Camera final {
  public:
+  // Maps continuous pixel coordinates to primary rays. A plain struct rather
+  // than a std::function so that per-sample calls can inline.
+  struct RayGenerator {
+    Vec3 position;
+    Vec3 topLeft;
+    Vec3 xbasis;
+    Vec3 ybasis;
+    // Angle subtended by a pixel, for the primary ray cones.
+    float spread;
+
+    Ray operator()(const float x, const float y) const {
+      return Ray(position, topLeft + xbasis * x + ybasis * y - position, 0.f,
+                 spread);
+    }
+
+    // The continuous pixel coordinates whose ray passes through point, the
+    // inverse of operator(), or nullopt for points behind the camera.
+    std::optional<std::pair<float, float>> project(const Vec3& point) const {
+      // Solves topLeft + xbasis * x + ybasis * y = position + d * k for x, y
+      // and k by Cramer's rule.
+      const auto d = point - position;
+      const auto r = position - topLeft;
+      const auto n = xbasis.cross(ybasis);
+      const auto k = -r.dot(n) / d.dot(n);
+      if (!(k > 0)) {
+        return std::nullopt;
+      }
+      const auto yd = ybasis.cross(d);
+      const auto xd = xbasis.cross(d);
+      return std::make_pair(r.dot(yd) / xbasis.dot(yd),
+                            r.dot(xd) / ybasis.dot(xd));
+    }
+  };
+
   Camera(const Vec3& position, const Vec3& direction, const Vec3& up,
          const float fov);
-  std::function<Ray(float, float)> adapt(const unsigned width,
-                                         const unsigned height) const;
+  RayGenerator adapt(const unsigned width, const unsigned height) const;
 
  private:
   const Vec3 position_;
@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/checkpoint.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+
+#include "util/mapped_file.h"
+
+namespace tinyrt {
+namespace {
+constexpr char kMagic[8] = "TRCKPT";
+constexpr uint32_t kVersion = 1;
+
+static_assert(std::is_trivially_copyable_v<PixelProgress>);
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t pixelSize;
+  uint32_t width;
+  uint32_t height;
+  uint32_t seed;
+  uint32_t samples;
+  uint64_t key;
+};
+
+static void writeAll(const int fd, const char* data, size_t size) {
+  while (size > 0) {
+    const auto written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Failed to write checkpoint");
+    }
+    data += written;
+    size -= written;
+  }
+}
+}  // namespace
+
+void saveCheckpoint(const std::string& path, const Checkpoint& checkpoint,
+                    const Progress& progress) {
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.pixelSize = sizeof(PixelProgress);
+  header.width = progress.width();
+  header.height = progress.height();
+  header.seed = checkpoint.seed;
+  header.samples = checkpoint.samples;
+  header.key = checkpoint.key;
+
+  const auto temporaryPath = path + ".tmp";
+  const auto fd = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                         0644);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to create " + temporaryPath);
+  }
+  try {
+    writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header));
+    // Pixels go out in storage order, padding included, so that loading is
+    // a single copy.
+    const auto& pixels = progress.pixels();
+    writeAll(fd, reinterpret_cast<const char*>(pixels.data()),
+             pixels.size() * sizeof(PixelProgress));
+    if (::fsync(fd) != 0) {
+      throw std::runtime_error("Failed to sync checkpoint");
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  if (::close(fd) != 0) {
+    throw std::runtime_error("Failed to write checkpoint");
+  }
+  std::filesystem::rename(temporaryPath, path);
+}
+
+Checkpoint loadCheckpoint(const std::string& path, Progress& progress) {
+  const MappedFile file(path);
+  const auto data = file.contents();
+  Header header;
+  if (data.size() < sizeof(header)) {
+    throw std::runtime_error("Damaged checkpoint: " + path);
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion ||
+      header.pixelSize != sizeof(PixelProgress)) {
+    throw std::runtime_error("Not a checkpoint of this version: " + path);
+  }
+  if (header.width != progress.width() ||
+      header.height != progress.height()) {
+    throw std::runtime_error("Checkpoint is for another image size: " + path);
+  }
+  auto& pixels = progress.pixels();
+  const auto size = pixels.size() * sizeof(PixelProgress);
+  if (data.size() != sizeof(header) + size) {
+    throw std::runtime_error("Damaged checkpoint: " + path);
+  }
+  std::memcpy(pixels.data(), data.data() + sizeof(header), size);
+  return {.key = header.key, .seed = header.seed, .samples = header.samples};
+}
+}  // namespace tinyrt
@@ -0,0 +1,61 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "core/framebuffer.h"
+
+namespace tinyrt {
+// Where a pixel of a progressive render is at.
+struct PixelProgress {
+  // Radiance summed over all samples so far.
+  Color sum;
+  uint32_t samples = 0;
+  // Random::position() of the pixel's stream.
+  uint64_t random = 0;
+};
+
+using Progress = TiledImage<PixelProgress>;
+
+// What a checkpoint file holds besides the pixels.
+struct Checkpoint {
+  // Fingerprint of the inputs that determine the render, e.g. scene, camera
+  // and trace options; a checkpoint only resumes the same render.
+  uint64_t key = 0;
+  uint32_t seed = 0;
+  // Samples per pixel taken so far.
+  uint32_t samples = 0;
+};
+
+// Writes checkpoint and progress to path. The file is written aside, synced
+// and renamed over path, so a crash leaves either the old or the new
+// checkpoint. Throws std::runtime_error on I/O errors.
+void saveCheckpoint(const std::string& path, const Checkpoint& checkpoint,
+                    const Progress& progress);
+
+// Reads path into progress, which must have the checkpoint's size. Throws
+// std::runtime_error if the file is missing, damaged or of another size.
+Checkpoint loadCheckpoint(const std::string& path, Progress& progress);
+}  // namespace tinyrt
@@ -0,0 +1,348 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/coordinator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "core/camera.h"
+#include "core/render.h"
+#include "core/scene_loader.h"
+#include "util/async.h"
+#include "util/hash.h"
+#include "util/json.h"
+#include "util/log.h"
+
+namespace tinyrt {
+using namespace std::literals;
+
+namespace {
+// Seed of the chunk-th unit of a tile. The pilot keeps the job's.
+static uint32_t chunkSeed(const uint32_t seed, const unsigned chunk) {
+  return chunk == 0 ? seed
+                    : static_cast<uint32_t>(
+                          hashBytes(std::to_string(chunk), seed));
+}
+
+// Throws std::runtime_error if job asks for what workers do not do.
+static Job checkJob(Job job) {
+  if (job.preview || job.bandRows > 0 || !job.checkpointPath.empty() ||
+      job.resume || job.rasterSamples > 0) {
+    throw std::runtime_error(
+        "Distributed renders cannot have previews, bands, checkpoints or "
+        "rasterized primary hits");
+  }
+  return job;
+}
+}  // namespace
+
+Coordinator::Coordinator(Job job)
+    : job_(checkJob(std::move(job))),
+      samples_(std::max(job_.samples, 1U)),
+      passSamples_(std::max(job_.passSamples, 1U)),
+      chunks_(1 + (samples_ - 1 + passSamples_ - 1) / passSamples_),
+      result_(job_.width, job_.height, job_.region()),
+      writer_(job_.outPath, job_.width, job_.height, job_.region()),
+      tiles_(result_.numTiles()),
+      remaining_(tiles_.size()) {
+  for (auto tile = 0U; tile < tiles_.size(); ++tile) {
+    tiles_[tile].partials.resize(chunks_);
+    tiles_[tile].pending = chunks_;
+    pilots_.push_back({.id = tile * chunks_, .samples = 1});
+  }
+}
+
+void Coordinator::run(const Socket& listener) {
+  LOG(INFO) << "Waiting for workers, " << tiles_.size() << " tiles in "
+            << tiles_.size() * chunks_ << " units.";
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (;;) {
+    {
+      std::lock_guard lock(mutex_);
+      if (remaining_ == 0) {
+        break;
+      }
+    }
+    if (auto worker = listener.accept(100ms)) {
+      workers.emplace_back(&Coordinator::serve, this, std::move(*worker),
+                           workers.size());
+    }
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  writer_.finish();
+  LOG(INFO) << "Rendering finished. Time elapsed="
+            << std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now() - begin)
+                   .count()
+            << "s.";
+}
+
+void Coordinator::serve(Socket worker, const unsigned index) {
+  std::vector<Unit> assigned;
+  auto rendered = 0U;
+  try {
+    std::string line;
+    if (!worker.readLine(line)) {
+      return;
+    }
+    LOG(INFO) << "Worker " << index << " joined with "
+              << Json::parse(line)["threads"].number(1) << " threads.";
+    worker.write(jobJson(job_) + "\n");
+    while (worker.readLine(line)) {
+      const auto message = Json::parse(line);
+      if (message["want"].isNumber()) {
+        worker.write(assign(message["want"].number(), assigned) + "\n");
+        if (assigned.empty()) {
+          break;
+        }
+        continue;
+      }
+      const unsigned id = message["unit"].number();
+      const auto unit =
+          std::find_if(assigned.begin(), assigned.end(),
+                       [&](const Unit& unit) { return unit.id == id; });
+      if (unit == assigned.end()) {
+        throw std::runtime_error("Unit " + std::to_string(id) +
+                                 " was not assigned to the worker");
+      }
+      const auto pixels = result_.tile(id / chunks_);
+      std::vector<Color> sums((pixels.x1 - pixels.x0) *
+                              (pixels.y1 - pixels.y0));
+      std::vector<float> payload(sums.size() * 3);
+      if (!worker.read(payload.data(), payload.size() * sizeof(float))) {
+        break;
+      }
+      for (auto i = 0UL; i < sums.size(); ++i) {
+        sums[i] = {payload[3 * i], payload[3 * i + 1], payload[3 * i + 2]};
+      }
+      finish(*unit, message["seconds"].number(), std::move(sums));
+      assigned.erase(unit);
+      ++rendered;
+    }
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Worker " << index << " failed: " << e.what();
+  }
+  std::lock_guard lock(mutex_);
+  for (const auto& unit : assigned) {
+    if (unit.id % chunks_ == 0) {
+      pilots_.push_front(unit);
+    } else {
+      queue_.push(unit);
+    }
+  }
+  ready_.notify_all();
+  LOG(INFO) << "Worker " << index << " left after " << rendered
+            << " units" << (assigned.empty() ? "." : ", returned the rest.");
+}
+
+std::string Coordinator::assign(const double want,
+                                std::vector<Unit>& assigned) {
+  std::unique_lock lock(mutex_);
+  ready_.wait(lock, [&] {
+    return !pilots_.empty() || !queue_.empty() || remaining_ == 0;
+  });
+  std::string units;
+  for (auto n = 0; n < want && (!pilots_.empty() || !queue_.empty()); ++n) {
+    Unit unit;
+    if (!pilots_.empty()) {
+      unit = pilots_.front();
+      pilots_.pop_front();
+    } else {
+      unit = queue_.top();
+      queue_.pop();
+    }
+    assigned.push_back(unit);
+    const auto pixels = result_.tile(unit.id / chunks_);
+    units += (units.empty() ? "[" : ",[") + std::to_string(unit.id) + "," +
+             std::to_string(pixels.x0) + "," + std::to_string(pixels.y0) +
+             "," + std::to_string(pixels.x1) + "," +
+             std::to_string(pixels.y1) + "," +
+             std::to_string(unit.samples) + "," +
+             std::to_string(chunkSeed(job_.seed, unit.id % chunks_)) + "]";
+  }
+  return "{\"units\":[" + units + "]}";
+}
+
+void Coordinator::finish(const Unit& unit, const double seconds,
+                         std::vector<Color> sums) {
+  const auto index = unit.id / chunks_;
+  const auto chunk = unit.id % chunks_;
+  std::lock_guard lock(mutex_);
+  auto& tile = tiles_[index];
+  tile.partials[chunk] = std::move(sums);
+  if (chunk == 0) {
+    for (auto next = 1U; next < chunks_; ++next) {
+      const auto samples =
+          std::min(passSamples_, samples_ - 1 - (next - 1) * passSamples_);
+      queue_.push({
+          .id = unit.id + next,
+          .samples = samples,
+          .cost = seconds * samples,
+      });
+    }
+    ready_.notify_all();
+  }
+  if (--tile.pending > 0) {
+    return;
+  }
+  const auto pixels = result_.tile(index);
+  auto i = 0U;
+  for (auto y = pixels.y0; y < pixels.y1; ++y) {
+    for (auto x = pixels.x0; x < pixels.x1; ++x, ++i) {
+      Color sum;
+      for (const auto& partial : tile.partials) {
+        sum += partial[i];
+      }
+      result_(x, y) = sum / samples_;
+    }
+  }
+  tile.partials = {};
+  writer_.submit(result_, pixels);
+  if (--remaining_ % std::max(unsigned(tiles_.size()) / 10, 1U) == 0) {
+    LOG(INFO) << "Finished " << tiles_.size() - remaining_ << "/"
+              << tiles_.size();
+  }
+  if (remaining_ == 0) {
+    ready_.notify_all();
+  }
+}
+
+void work(const std::string& address, const int avx, const bool useSceneCache,
+          const size_t textureBudget) {
+  auto coordinator = Socket::connect(address);
+  const auto threads = std::max(std::thread::hardware_concurrency(), 1U);
+  coordinator.write("{\"threads\":" + std::to_string(threads) + "}\n");
+  std::string line;
+  if (!coordinator.readLine(line)) {
+    throw std::runtime_error("Coordinator hung up");
+  }
+  const auto job = parseJob(Json::parse(line), Job{});
+  const auto scene = loadScene(job.scenePath, job.meshOptions, useSceneCache);
+  LOG(INFO) << "Scene created: " << *scene;
+  scene->textures().setBudget(textureBudget);
+  const auto renderer = createRenderer(avx);
+  renderer->initialize(*scene);
+  const auto rayGenerator =
+      Camera(job.position, job.direction, job.up, job.fov)
+          .adapt(job.width, job.height);
+
+  auto rendered = 0U;
+  // Units for all threads at a time, and their results in one go with the
+  // request for the next.
+  std::string results;
+  for (;;) {
+    coordinator.write(results + "{\"want\":" + std::to_string(threads) +
+                      "}\n");
+    if (!coordinator.readLine(line)) {
+      throw std::runtime_error("Coordinator hung up");
+    }
+    const auto units = Json::parse(line)["units"];
+    if (units.size() == 0) {
+      break;
+    }
+    // Checked up front, as a unit that does not fit the frame would make a
+    // task throw, or allocate a framebuffer for a wrapped-around size.
+    struct Work {
+      unsigned id;
+      Block pixels;
+      unsigned samples;
+      uint32_t seed;
+    };
+    const auto region = job.region();
+    std::vector<Work> work;
+    for (auto i = 0UL; i < units.size(); ++i) {
+      const auto& unit = units[i];
+      const auto field = [&](const size_t f) -> unsigned {
+        const auto value = unit[f].number(-1);
+        if (!(value >= 0 && value < 4294967296.) || value != unsigned(value)) {
+          throw std::runtime_error("Bad unit from coordinator");
+        }
+        return value;
+      };
+      const Block pixels{field(1), field(2), field(3), field(4)};
+      if (pixels.x0 < region.x0 || pixels.x0 >= pixels.x1 ||
+          pixels.x1 > region.x1 || pixels.y0 < region.y0 ||
+          pixels.y0 >= pixels.y1 || pixels.y1 > region.y1 || field(5) < 1) {
+        throw std::runtime_error("Bad unit from coordinator");
+      }
+      work.push_back({field(0), pixels, field(5), field(6)});
+    }
+    std::vector<std::string> replies(work.size());
+    // A throwing task would take its pool thread down and never let submitN()
+    // return, so errors are carried out and rethrown; the coordinator then
+    // hands this worker's units to others.
+    std::vector<std::exception_ptr> errors(work.size());
+    Async::submitN(
+        [&](const unsigned index) {
+          try {
+            const auto& unit = work[index];
+            const auto& pixels = unit.pixels;
+            const TraceOptions options{
+                .directRays = unit.samples,
+                .indirectRays = 1,
+                .shadowRays = 1,
+            };
+            Framebuffer image(job.width, job.height, pixels);
+            Progress progress(job.width, job.height, pixels);
+            const auto begin = std::chrono::steady_clock::now();
+            renderer->renderPass(*scene, rayGenerator, options, unit.seed,
+                                 pixels, progress, image);
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - begin;
+            std::vector<float> payload;
+            for (auto y = pixels.y0; y < pixels.y1; ++y) {
+              for (auto x = pixels.x0; x < pixels.x1; ++x) {
+                const auto& sum = progress(x, y).sum;
+                payload.insert(payload.end(), {sum->x, sum->y, sum->z});
+              }
+            }
+            replies[index] =
+                "{\"unit\":" + std::to_string(unit.id) +
+                ",\"seconds\":" + std::to_string(elapsed.count()) + "}\n" +
+                std::string(reinterpret_cast<const char*>(payload.data()),
+                            payload.size() * sizeof(float));
+          } catch (...) {
+            errors[index] = std::current_exception();
+          }
+        },
+        work.size());
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    results.clear();
+    for (const auto& reply : replies) {
+      results += reply;
+    }
+    rendered += units.size();
+  }
+  LOG(INFO) << "Done after " << rendered << " units.";
+}
+}  // namespace tinyrt
@@ -0,0 +1,126 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "core/framebuffer.h"
+#include "core/image_writer.h"
+#include "core/job.h"
+#include "util/socket.h"
+
+namespace tinyrt {
+// Distributed rendering: a coordinator hands a job's tiles to worker
+// processes in units, a run of samples over one tile with a seed of its own.
+// A tile's first unit, its pilot, takes a single sample and is timed. The
+// rest of its samples follow in units of up to passSamples, which wait in
+// order of the cost the pilot predicts for them, the most expensive first.
+// Slow tiles, e.g. behind glass, then start early rather than hold up the
+// end of the render while other workers idle, and cheap units fill in the
+// gaps.
+//
+// Over the wire, lines of JSON go both ways:
+//   worker:      {"threads":n} on connecting
+//   coordinator: the job, as a parseJob() line
+//   worker:      {"want":n}
+//   coordinator: {"units":[[id,x0,y0,x1,y1,samples,seed],...]}
+//   worker:      {"unit":id,"seconds":s} per rendered unit, each followed by
+//                the sums of its samples, 3 native floats per pixel in row
+//                order, then the next {"want":n}
+// No units in an answer means the render is done.
+
+// Coordinator of a distributed render: hands out the units of job to the
+// workers that connect, see work(), and merges what they send back into the
+// output file. Units of a tile are weighted by their samples and merged in
+// a fixed order, so the image does not depend on how many workers there
+// were or which of them rendered what. Units of a worker that goes away go
+// back to the queue.
+//
+// Workers trace every sample in full; throws std::runtime_error for jobs
+// that ask for previews, bands, checkpoints or rasterized primary hits.
+class Coordinator final {
+ public:
+  explicit Coordinator(Job job);
+
+  // Accepts workers on listener until the render is done.
+  void run(const Socket& listener);
+
+ private:
+  struct Unit {
+    // tile * chunks_ + chunk.
+    unsigned id;
+    unsigned samples;
+    // Estimated seconds to render.
+    double cost = 0;
+
+    bool operator<(const Unit& other) const { return cost < other.cost; }
+  };
+  struct Tile {
+    // Sums of samples of each chunk received, in row order.
+    std::vector<std::vector<Color>> partials;
+    unsigned pending;
+  };
+
+  // Talks to one worker until the render is done or the worker goes away.
+  void serve(Socket worker, unsigned index);
+
+  // Up to want units for a worker, added to assigned, as the units message.
+  // Waits while there are none to give but the render is not done, since a
+  // worker may yet fail and leave some.
+  std::string assign(double want, std::vector<Unit>& assigned);
+
+  // Takes in a rendered unit. A pilot queues the rest of its tile; the last
+  // unit of a tile completes it.
+  void finish(const Unit& unit, double seconds, std::vector<Color> sums);
+
+  const Job job_;
+  const unsigned samples_;
+  const unsigned passSamples_;
+  // Units per tile: the pilot and the rest of the samples in passes.
+  const unsigned chunks_;
+  Framebuffer result_;
+  ImageWriter writer_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::vector<Tile> tiles_;
+  // Tiles not complete yet.
+  size_t remaining_;
+  // Pilots go first, in tile order.
+  std::deque<Unit> pilots_;
+  std::priority_queue<Unit> queue_;
+};
+
+// Worker of a distributed render: renders the units the coordinator at
+// address hands out until there are none left, with the kernels for AVX
+// version avx, see createRenderer(). The job's scene must be at the same
+// path here as where the coordinator runs.
+void work(const std::string& address, int avx, bool useSceneCache,
+          size_t textureBudget);
+}  // namespace tinyrt
@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "core/shader.h"
+#include "util/aligned_allocator.h"
+
+namespace tinyrt {
+// Pixels [x0, x1) x [y0, y1) of an image.
+struct Block {
+  unsigned x0;
+  unsigned y0;
+  unsigned x1;
+  unsigned y1;
+};
+
+// Heap allocated image stored tile by tile: the kTileSize x kTileSize pixels
+// of each tile are contiguous and start on a cache line, so threads working
+// on different tiles never write to the same line. Tiles are numbered row by
+// row; edge tiles are padded to full size.
+//
+// An image may hold only a region of a larger width x height frame, e.g. one
+// band of a render too large for memory. Pixels are addressed in frame
+// coordinates either way, and tiles start at the region's corner.
+template <typename TPixel>
+class TiledImage final {
+ public:
+  static constexpr unsigned kTileSize = 8;
+  static_assert(kTileSize * kTileSize * sizeof(TPixel) % 64 == 0);
+
+  TiledImage(const unsigned width, const unsigned height)
+      : TiledImage(width, height, {0, 0, width, height}) {}
+
+  TiledImage(const unsigned width, const unsigned height, const Block& region)
+      : width_(width),
+        height_(height),
+        region_(region),
+        tilesX_((region.x1 - region.x0 + kTileSize - 1) / kTileSize),
+        tilesY_((region.y1 - region.y0 + kTileSize - 1) / kTileSize),
+        pixels_(size_t{tilesX_} * tilesY_ * kTileSize * kTileSize) {}
+
+  // Size of the whole frame.
+  unsigned width() const { return width_; }
+  unsigned height() const { return height_; }
+  // The pixels held.
+  const Block& region() const { return region_; }
+  unsigned tilesX() const { return tilesX_; }
+  unsigned tilesY() const { return tilesY_; }
+  unsigned numTiles() const { return tilesX_ * tilesY_; }
+
+  // The pixels of tile index, clipped to the region.
+  Block tile(const unsigned index) const {
+    const auto x0 = region_.x0 + index % tilesX_ * kTileSize;
+    const auto y0 = region_.y0 + index / tilesX_ * kTileSize;
+    return {
+        .x0 = x0,
+        .y0 = y0,
+        .x1 = std::min(region_.x1, x0 + kTileSize),
+        .y1 = std::min(region_.y1, y0 + kTileSize),
+    };
+  }
+
+  TPixel& operator()(const unsigned x, const unsigned y) {
+    return pixels_[offset(x, y)];
+  }
+  const TPixel& operator()(const unsigned x, const unsigned y) const {
+    return pixels_[offset(x, y)];
+  }
+
+  // All pixels in storage order, padding included.
+  aligned_vector<TPixel>& pixels() { return pixels_; }
+  const aligned_vector<TPixel>& pixels() const { return pixels_; }
+
+ private:
+  size_t offset(unsigned x, unsigned y) const {
+    x -= region_.x0;
+    y -= region_.y0;
+    const size_t tile = (y / kTileSize) * tilesX_ + x / kTileSize;
+    return tile * kTileSize * kTileSize + (y % kTileSize) * kTileSize +
+           x % kTileSize;
+  }
+
+  const unsigned width_;
+  const unsigned height_;
+  const Block region_;
+  const unsigned tilesX_;
+  const unsigned tilesY_;
+  aligned_vector<TPixel> pixels_;
+};
+
+// Float RGB image that renderers write into.
+using Framebuffer = TiledImage<Color>;
+}  // namespace tinyrt
@@ -0,0 +1,477 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/glb.h"
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#include "util/half.h"
+
+namespace tinyrt {
+namespace {
+static_assert(std::endian::native == std::endian::little,
+              "glTF buffers are read in place");
+
+constexpr uint32_t kMagic = 0x46546C67;  // "glTF"
+constexpr uint32_t kJsonChunk = 0x4E4F534A;
+constexpr uint32_t kBinChunk = 0x004E4942;
+constexpr int kTriangles = 4;
+
+enum ComponentType {
+  BYTE = 5120,
+  UNSIGNED_BYTE = 5121,
+  SHORT = 5122,
+  UNSIGNED_SHORT = 5123,
+  UNSIGNED_INT = 5125,
+  FLOAT = 5126,
+};
+
+// Column-major, as glTF stores it.
+using Matrix = std::array<float, 16>;
+
+constexpr Matrix kIdentity = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+static Matrix multiply(const Matrix& a, const Matrix& b) {
+  Matrix result{};
+  for (auto col = 0; col < 4; ++col) {
+    for (auto row = 0; row < 4; ++row) {
+      for (auto k = 0; k < 4; ++k) {
+        result[col * 4 + row] += a[k * 4 + row] * b[col * 4 + k];
+      }
+    }
+  }
+  return result;
+}
+
+static Vec3 transformPoint(const Matrix& m, const Vec3& p) {
+  return Vec3(m[0] * p->x + m[4] * p->y + m[8] * p->z + m[12],
+              m[1] * p->x + m[5] * p->y + m[9] * p->z + m[13],
+              m[2] * p->x + m[6] * p->y + m[10] * p->z + m[14]);
+}
+
+// Normals transform by the inverse transpose of the upper 3x3, which is its
+// cofactor matrix over its determinant. Only the determinant's sign matters
+// after normalizing; a mirroring transform would flip normals without it.
+static Vec3 transformNormal(const Matrix& m, const Vec3& n) {
+  const Vec3 c0(m[0], m[1], m[2]);
+  const Vec3 c1(m[4], m[5], m[6]);
+  const Vec3 c2(m[8], m[9], m[10]);
+  const auto r0 = c1.cross(c2);
+  const auto r1 = c2.cross(c0);
+  const auto r2 = c0.cross(c1);
+  const auto sign = c0.dot(r0) < 0 ? -1.f : 1.f;
+  return ((r0 * n->x + r1 * n->y + r2 * n->z) * sign).normalize();
+}
+
+static Matrix localTransform(const Json& node) {
+  if (node.contains("matrix")) {
+    Matrix m;
+    for (auto i = 0UL; i < m.size(); ++i) {
+      m[i] = node["matrix"][i].number();
+    }
+    return m;
+  }
+  const auto& t = node["translation"];
+  const auto& r = node["rotation"];
+  const auto& s = node["scale"];
+  const float x = r[0UL].number(), y = r[1].number(), z = r[2].number(),
+              w = r[3].number(1);
+  const float sx = s[0UL].number(1), sy = s[1].number(1), sz = s[2].number(1);
+  return {(1 - 2 * (y * y + z * z)) * sx,
+          2 * (x * y + z * w) * sx,
+          2 * (x * z - y * w) * sx,
+          0,
+          2 * (x * y - z * w) * sy,
+          (1 - 2 * (x * x + z * z)) * sy,
+          2 * (y * z + x * w) * sy,
+          0,
+          2 * (x * z + y * w) * sz,
+          2 * (y * z - x * w) * sz,
+          (1 - 2 * (x * x + y * y)) * sz,
+          0,
+          static_cast<float>(t[0UL].number()),
+          static_cast<float>(t[1].number()),
+          static_cast<float>(t[2].number()),
+          1};
+}
+
+template <typename T>
+static T load(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+// A count, size or offset from the glTF JSON. None can be valid beyond limit,
+// the size of the BIN chunk, and refusing them early keeps the bounds checks
+// from wrapping around.
+static size_t bounded(const Json& value, const size_t limit,
+                      const double fallback = 0) {
+  const auto number = value.number(fallback);
+  if (!(number >= 0 && number <= limit)) {
+    throw std::out_of_range("glTF accessor exceeds its buffer");
+  }
+  return static_cast<size_t>(number);
+}
+
+// An index from the glTF JSON into array, e.g. a node's "mesh" into "meshes".
+// Like bounded(), this checks the number before it becomes a size_t.
+static size_t indexInto(const Json& value, const Json& array,
+                        const double fallback = 0) {
+  const auto number = value.number(fallback);
+  if (!(number >= 0 && number < array.size())) {
+    throw std::out_of_range("glTF index out of range");
+  }
+  return static_cast<size_t>(number);
+}
+
+// A typed, bounds-checked view of one accessor in the BIN chunk.
+class Accessor final {
+ public:
+  Accessor(const Json& gltf, const std::string_view bin, const size_t index,
+           const size_t expectedComponents) {
+    const auto& accessor = gltf["accessors"][index];
+    if (!accessor.isObject()) {
+      throw std::out_of_range("glTF accessor index out of range");
+    }
+    if (accessor.contains("sparse")) {
+      throw std::runtime_error("Sparse glTF accessors are not supported");
+    }
+    count_ = bounded(accessor["count"], bin.size());
+    // Anything else is left to sizeOf() to reject.
+    const auto componentType = accessor["componentType"].number();
+    componentType_ = componentType >= int{BYTE} && componentType <= int{FLOAT}
+                         ? static_cast<int>(componentType)
+                         : 0;
+    normalized_ = accessor["normalized"].boolean();
+    components_ = componentsOf(accessor["type"].string());
+    if (components_ < expectedComponents) {
+      throw std::runtime_error("Unexpected glTF accessor type");
+    }
+    const auto& view = gltf["bufferViews"][indexInto(accessor["bufferView"],
+                                                     gltf["bufferViews"])];
+    if (!view.isObject() || view["buffer"].number() != 0 ||
+        gltf["buffers"][0UL].contains("uri")) {
+      throw std::runtime_error("glTF data must be in the GLB BIN chunk");
+    }
+    const size_t componentSize = sizeOf(componentType_);
+    const size_t elementSize = componentSize * components_;
+    stride_ = bounded(view["byteStride"], bin.size(), elementSize);
+    const auto accessorOffset = bounded(accessor["byteOffset"], bin.size());
+    const auto offset =
+        bounded(view["byteOffset"], bin.size()) + accessorOffset;
+    const auto length = bounded(view["byteLength"], bin.size());
+    // Every term is at most bin.size(), so once the product is known to fit
+    // too none of the sums can wrap around.
+    if (count_ > 0 &&
+        ((stride_ > 0 && count_ - 1 > bin.size() / stride_) ||
+         offset + (count_ - 1) * stride_ + elementSize > bin.size() ||
+         accessorOffset + (count_ - 1) * stride_ + elementSize > length)) {
+      throw std::out_of_range("glTF accessor exceeds its buffer");
+    }
+    data_ = bin.data() + offset;
+  }
+
+  size_t size() const { return count_; }
+
+  float get(const size_t i, const size_t component) const {
+    const auto* p = data_ + i * stride_ + component * sizeOf(componentType_);
+    switch (componentType_) {
+      case BYTE:
+        return scale(load<int8_t>(p), 127.f);
+      case UNSIGNED_BYTE:
+        return scale(load<uint8_t>(p), 255.f);
+      case SHORT:
+        return scale(load<int16_t>(p), 32767.f);
+      case UNSIGNED_SHORT:
+        return scale(load<uint16_t>(p), 65535.f);
+      case UNSIGNED_INT:
+        return load<uint32_t>(p);
+      default:
+        return load<float>(p);
+    }
+  }
+
+  uint32_t index(const size_t i) const {
+    const auto* p = data_ + i * stride_;
+    switch (componentType_) {
+      case UNSIGNED_BYTE:
+        return load<uint8_t>(p);
+      case UNSIGNED_SHORT:
+        return load<uint16_t>(p);
+      case UNSIGNED_INT:
+        return load<uint32_t>(p);
+      default:
+        throw std::runtime_error("Invalid glTF index type");
+    }
+  }
+
+  Vec3 vec3(const size_t i) const {
+    return Vec3(get(i, 0), get(i, 1), get(i, 2));
+  }
+
+ private:
+  static size_t sizeOf(const int componentType) {
+    switch (componentType) {
+      case BYTE:
+      case UNSIGNED_BYTE:
+        return 1;
+      case SHORT:
+      case UNSIGNED_SHORT:
+        return 2;
+      case UNSIGNED_INT:
+      case FLOAT:
+        return 4;
+      default:
+        throw std::runtime_error("Invalid glTF component type");
+    }
+  }
+
+  static size_t componentsOf(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    throw std::runtime_error("Unsupported glTF accessor type: " + type);
+  }
+
+  float scale(const float value, const float max) const {
+    return normalized_ ? std::max(value / max, -1.f) : value;
+  }
+
+  const char* data_;
+  size_t count_;
+  size_t stride_;
+  int componentType_;
+  size_t components_;
+  bool normalized_;
+};
+
+static Material toMaterial(const Json& material) {
+  const auto& pbr = material["pbrMetallicRoughness"];
+  const auto& base = pbr["baseColorFactor"];
+  const auto& emissive = material["emissiveFactor"];
+  const float metallic = pbr["metallicFactor"].number(1);
+  const float roughness = pbr["roughnessFactor"].number(1);
+  const Vec3 baseColor(base[0UL].number(1), base[1].number(1),
+                       base[2].number(1));
+  Material result;
+  result.diffuse = baseColor * (1 - metallic);
+  // Phong stand-in for the metallic-roughness model: metals tint their
+  // highlight, and rougher surfaces get a wider lobe.
+  result.specular = Vec3(.04f, .04f, .04f) * (1 - metallic) +
+                    baseColor * metallic;
+  result.specularExponent =
+      std::max(2.f / std::max(roughness * roughness * roughness * roughness,
+                              1e-4f) - 2.f, 1.f);
+  result.emittance = Vec3(emissive[0UL].number(), emissive[1].number(),
+                          emissive[2].number());
+  result.illuminationModel = static_cast<Material::IlluminationModel>(
+      Material::DIFFUSE | Material::SPECULAR);
+  return result;
+}
+
+struct Builder {
+  const Json& gltf;
+  const std::string_view bin;
+  Mesh& mesh;
+
+  void addNode(const size_t index, const Matrix& parent, const unsigned depth) {
+    // Node graphs must be trees; the depth bound also stops cycles.
+    if (depth > 64) {
+      throw std::runtime_error("glTF node hierarchy too deep");
+    }
+    const auto& node = gltf["nodes"][index];
+    if (!node.isObject()) {
+      throw std::out_of_range("glTF node index out of range");
+    }
+    const auto transform = multiply(parent, localTransform(node));
+    if (node.contains("mesh")) {
+      const auto& gltfMesh =
+          gltf["meshes"][indexInto(node["mesh"], gltf["meshes"])];
+      for (auto i = 0UL; i < gltfMesh["primitives"].size(); ++i) {
+        addPrimitive(gltfMesh["primitives"][i], transform);
+      }
+    }
+    for (auto i = 0UL; i < node["children"].size(); ++i) {
+      addNode(indexInto(node["children"][i], gltf["nodes"]), transform,
+              depth + 1);
+    }
+  }
+
+  void addPrimitive(const Json& primitive, const Matrix& transform) {
+    if (primitive["mode"].number(kTriangles) != kTriangles) {
+      throw std::runtime_error("Only glTF triangle lists are supported");
+    }
+    const auto& attributes = primitive["attributes"];
+    if (!attributes.contains("POSITION")) {
+      throw std::runtime_error("glTF primitive without POSITION");
+    }
+    const auto& accessors = gltf["accessors"];
+    const Accessor positions(
+        gltf, bin, indexInto(attributes["POSITION"], accessors), 3);
+    const auto first = static_cast<uint32_t>(mesh.positions.size());
+    std::optional<Accessor> normals, texcoords;
+    if (attributes.contains("NORMAL")) {
+      normals.emplace(gltf, bin, indexInto(attributes["NORMAL"], accessors),
+                      3);
+    }
+    if (attributes.contains("TEXCOORD_0")) {
+      texcoords.emplace(gltf, bin,
+                        indexInto(attributes["TEXCOORD_0"], accessors), 2);
+    }
+    if ((normals && normals->size() != positions.size()) ||
+        (texcoords && texcoords->size() != positions.size())) {
+      throw std::runtime_error("glTF attributes differ in count");
+    }
+    for (auto i = 0UL; i < positions.size(); ++i) {
+      mesh.positions.push_back(transformPoint(transform, positions.vec3(i)));
+      // Mesh keeps normals per vertex or not at all, so primitives without
+      // normals get smooth ones below.
+      mesh.normals.push_back(
+          normals ? Mesh::encodeNormal(transformNormal(transform,
+                                                       normals->vec3(i)))
+                  : 0);
+      mesh.texcoords.push_back(
+          texcoords ? std::array<uint16_t, 2>{floatToHalf(texcoords->get(i, 0)),
+                                              floatToHalf(texcoords->get(i, 1))}
+                    : std::array<uint16_t, 2>{});
+    }
+    // Material 0 is the fallback for primitives without one.
+    const auto material =
+        primitive.contains("material")
+            ? static_cast<uint32_t>(
+                  indexInto(primitive["material"], gltf["materials"]) + 1)
+            : 0U;
+    const auto firstIndex = mesh.indices.size();
+    if (primitive.contains("indices")) {
+      const Accessor indices(
+          gltf, bin, indexInto(primitive["indices"], accessors), 1);
+      for (auto i = 0UL; i + 2 < indices.size(); i += 3) {
+        for (auto corner = 0; corner < 3; ++corner) {
+          const auto index = indices.index(i + corner);
+          if (index >= positions.size()) {
+            throw std::out_of_range("glTF index out of range");
+          }
+          mesh.indices.push_back(first + index);
+        }
+        mesh.materialIds.push_back(material);
+      }
+    } else {
+      for (auto i = 0UL; i + 2 < positions.size(); i += 3) {
+        mesh.indices.insert(mesh.indices.end(),
+                            {first + static_cast<uint32_t>(i),
+                             first + static_cast<uint32_t>(i + 1),
+                             first + static_cast<uint32_t>(i + 2)});
+        mesh.materialIds.push_back(material);
+      }
+    }
+    if (!normals) {
+      // As Mesh::computeNormals() does, over this primitive's vertices.
+      const auto& p = mesh.positions;
+      std::vector<Vec3> sums(p.size() - first);
+      for (auto i = firstIndex; i < mesh.indices.size(); i += 3) {
+        const auto* corners = &mesh.indices[i];
+        const auto& a = p[corners[0]];
+        // Unnormalized, so larger faces weigh more.
+        const auto normal = (p[corners[1]] - a).cross(p[corners[2]] - a);
+        for (auto corner = 0; corner < 3; ++corner) {
+          sums[corners[corner] - first] += normal;
+        }
+      }
+      for (auto i = 0UL; i < sums.size(); ++i) {
+        mesh.normals[first + i] = Mesh::encodeNormal(sums[i]);
+      }
+    }
+  }
+};
+}  // namespace
+
+Glb::Glb(const std::string& path) : file_(path) {
+  const auto data = file_.contents();
+  if (data.size() < 12 || load<uint32_t>(data.data()) != kMagic) {
+    throw std::runtime_error("Not a GLB file");
+  }
+  if (load<uint32_t>(data.data() + 4) != 2) {
+    throw std::runtime_error("Only glTF 2.0 is supported");
+  }
+  const auto length =
+      std::min<size_t>(load<uint32_t>(data.data() + 8), data.size());
+  bool hasJson = false;
+  for (size_t offset = 12; offset + 8 <= length;) {
+    const size_t chunkLength = load<uint32_t>(data.data() + offset);
+    const auto chunkType = load<uint32_t>(data.data() + offset + 4);
+    offset += 8;
+    if (chunkLength > length - offset) {
+      throw std::runtime_error("Truncated GLB chunk");
+    }
+    const auto chunk = data.substr(offset, chunkLength);
+    if (chunkType == kJsonChunk && !hasJson) {
+      json_ = Json::parse(chunk);
+      hasJson = true;
+    } else if (chunkType == kBinChunk && bin_.empty()) {
+      bin_ = chunk;
+    }
+    // Chunks are 4 byte aligned.
+    offset += (chunkLength + 3) & ~size_t{3};
+  }
+  if (!hasJson) {
+    throw std::runtime_error("GLB file without a JSON chunk");
+  }
+}
+
+std::unique_ptr<Scene> Glb::toScene(const MeshOptions& meshOptions) const {
+  Mesh mesh;
+  Builder builder{json_, bin_, mesh};
+  const auto& scenes = json_["scenes"];
+  if (scenes.size() > 0) {
+    const auto& scene = scenes[indexInto(json_["scene"], scenes)];
+    for (auto i = 0UL; i < scene["nodes"].size(); ++i) {
+      builder.addNode(indexInto(scene["nodes"][i], json_["nodes"]), kIdentity,
+                      0);
+    }
+  } else {
+    // Without scenes, every mesh is instanced once at the origin.
+    for (auto i = 0UL; i < json_["meshes"].size(); ++i) {
+      for (auto j = 0UL; j < json_["meshes"][i]["primitives"].size(); ++j) {
+        builder.addPrimitive(json_["meshes"][i]["primitives"][j], kIdentity);
+      }
+    }
+  }
+
+  std::vector<Material> materials;
+  Material fallback;
+  fallback.diffuse = Vec3(.8f, .8f, .8f);
+  fallback.illuminationModel = Material::DIFFUSE;
+  materials.push_back(fallback);
+  for (auto i = 0UL; i < json_["materials"].size(); ++i) {
+    materials.push_back(toMaterial(json_["materials"][i]));
+  }
+  return std::make_unique<Scene>(std::move(mesh), std::move(materials),
+                                 meshOptions);
+}
+}  // namespace tinyrt
@@ -0,0 +1,53 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "core/scene.h"
+#include "util/json.h"
+#include "util/mapped_file.h"
+
+namespace tinyrt {
+// A binary glTF 2.0 (.glb) file. The JSON chunk is parsed up front; toScene()
+// reads the accessors straight from the mapped BIN chunk into the scene's
+// mesh, with node transforms applied. Only indexed or non-indexed triangle
+// lists in the embedded buffer are supported.
+class Glb final {
+ public:
+  explicit Glb(const std::string& path);
+  Glb(const Glb&) = delete;
+  Glb& operator=(const Glb&) = delete;
+
+  std::unique_ptr<Scene> toScene(const MeshOptions& meshOptions = {}) const;
+
+  friend std::ostream& operator<<(std::ostream& os, const Glb& glb);
+
+ private:
+  MappedFile file_;
+  Json json_;
+  std::string_view bin_;
+};
+}  // namespace tinyrt
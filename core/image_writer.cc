@@ -0,0 +1,323 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/image_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace tinyrt {
+namespace {
+static_assert(std::endian::native == std::endian::little,
+              "Pixels are written in native byte order");
+
+// Channels of an EXR scanline, which come in alphabetical order.
+constexpr int kExrChannels[] = {2, 1, 0};  // B, G, R.
+// Per scanline: its y and the size of its pixel data.
+constexpr size_t kExrLinePrefix = 8;
+
+template <typename T>
+static void append(std::string& out, const T& value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void appendAttribute(std::string& out, const char* name,
+                            const char* type, const std::string& value) {
+  out.append(name, std::strlen(name) + 1);
+  out.append(type, std::strlen(type) + 1);
+  append(out, static_cast<int32_t>(value.size()));
+  out += value;
+}
+
+// Header, offset table and scanline prefixes of an uncompressed EXR of window
+// in a width x height frame, i.e. everything but the pixels.
+static std::string exrLayout(const unsigned width, const unsigned height,
+                             const Block& window) {
+  std::string header;
+  append(header, int32_t{20000630});  // Magic.
+  append(header, int32_t{2});         // Version 2, single part scanlines.
+
+  std::string channels;
+  for (const auto* name : {"B", "G", "R"}) {
+    channels.append(name, 2);
+    append(channels, int32_t{2});  // FLOAT.
+    append(channels, int32_t{0});  // pLinear and reserved.
+    append(channels, int32_t{1});  // x sampling.
+    append(channels, int32_t{1});  // y sampling.
+  }
+  channels += '\0';
+  std::string dataWindow, displayWindow;
+  for (const int32_t value : {int32_t(window.x0), int32_t(window.y0),
+                              int32_t(window.x1) - 1, int32_t(window.y1) - 1}) {
+    append(dataWindow, value);
+  }
+  for (const int32_t value : {0, 0, int32_t(width) - 1, int32_t(height) - 1}) {
+    append(displayWindow, value);
+  }
+  std::string pixelAspectRatio, screenWindowCenter, screenWindowWidth;
+  append(pixelAspectRatio, 1.f);
+  append(screenWindowCenter, 0.f);
+  append(screenWindowCenter, 0.f);
+  append(screenWindowWidth, 1.f);
+  appendAttribute(header, "channels", "chlist", channels);
+  appendAttribute(header, "compression", "compression", std::string(1, 0));
+  appendAttribute(header, "dataWindow", "box2i", dataWindow);
+  appendAttribute(header, "displayWindow", "box2i", displayWindow);
+  appendAttribute(header, "lineOrder", "lineOrder", std::string(1, 0));
+  appendAttribute(header, "pixelAspectRatio", "float", pixelAspectRatio);
+  appendAttribute(header, "screenWindowCenter", "v2f", screenWindowCenter);
+  appendAttribute(header, "screenWindowWidth", "float", screenWindowWidth);
+  header += '\0';
+
+  const auto lines = window.y1 - window.y0;
+  const size_t lineSize = size_t{window.x1 - window.x0} * 3 * sizeof(float);
+  const auto firstLine = header.size() + size_t{lines} * sizeof(uint64_t);
+  for (auto y = 0U; y < lines; ++y) {
+    append(header, uint64_t{firstLine + y * (kExrLinePrefix + lineSize)});
+  }
+  // The line prefixes are interleaved with pixel data; they are patched in
+  // by the ImageWriter constructor.
+  return header;
+}
+
+static uint8_t toByte(const float value) {
+  return std::max(std::min(static_cast<int>(value * 255), 255), 0);
+}
+}  // namespace
+
+ImageFormat imageFormatOf(const std::string& path) {
+  if (path.ends_with(".pfm")) {
+    return ImageFormat::PFM;
+  }
+  if (path.ends_with(".exr")) {
+    return ImageFormat::EXR;
+  }
+  return ImageFormat::PPM;
+}
+
+ImageWriter::ImageWriter(const std::string& path, const unsigned width,
+                         const unsigned height)
+    : ImageWriter(path, width, height, {0, 0, width, height}) {}
+
+ImageWriter::ImageWriter(const std::string& path, const unsigned frameWidth,
+                         const unsigned frameHeight, const Block& window)
+    : window_(window), format_(imageFormatOf(path)) {
+  // The file holds just the window.
+  const auto width = window.x1 - window.x0;
+  const auto height = window.y1 - window.y0;
+  std::string header;
+  size_t size = 0;
+  switch (format_) {
+    case ImageFormat::PPM:
+      header = "P6\n" + std::to_string(width) + " " + std::to_string(height) +
+               "\n255\n";
+      size = header.size() + size_t{width} * height * 3;
+      break;
+    case ImageFormat::PFM:
+      // A negative scale marks little-endian data.
+      header = "PF\n" + std::to_string(width) + " " + std::to_string(height) +
+               "\n-1.0\n";
+      size = header.size() + size_t{width} * height * 3 * sizeof(float);
+      break;
+    case ImageFormat::EXR:
+      header = exrLayout(frameWidth, frameHeight, window);
+      size = header.size() +
+             height * (kExrLinePrefix + size_t{width} * 3 * sizeof(float));
+      break;
+  }
+  dataOffset_ = header.size();
+
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("Failed to open " + path + " for writing");
+  }
+  try {
+    if (::ftruncate(fd_, size) != 0) {
+      throw std::runtime_error("Failed to size " + path);
+    }
+    pwriteAll(header.data(), header.size(), 0);
+    if (format_ == ImageFormat::EXR) {
+      const auto lineSize = static_cast<int32_t>(width * 3 * sizeof(float));
+      for (auto y = 0U; y < height; ++y) {
+        const int32_t prefix[] = {static_cast<int32_t>(window.y0 + y),
+                                  lineSize};
+        pwriteAll(reinterpret_cast<const char*>(prefix), sizeof(prefix),
+                  dataOffset_ + size_t{y} * (kExrLinePrefix + lineSize));
+      }
+    }
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+  thread_ = std::thread([this] { run(); });
+}
+
+ImageWriter::~ImageWriter() {
+  try {
+    finish();
+  } catch (const std::exception&) {
+  }
+}
+
+void ImageWriter::submit(const Framebuffer& image, const Block& block) {
+  {
+    std::lock_guard<std::mutex> l(mu_);
+    queue_.emplace_back(&image, block);
+  }
+  cv_.notify_one();
+}
+
+void ImageWriter::drain() {
+  std::unique_lock<std::mutex> l(mu_);
+  drained_.wait(l, [this] { return queue_.empty() && !busy_; });
+}
+
+void ImageWriter::finish() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> l(mu_);
+      done_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    if (::close(fd_) != 0 && !error_) {
+      error_ = std::make_exception_ptr(
+          std::runtime_error("Failed to close image file"));
+    }
+  }
+  if (error_) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+void ImageWriter::run() {
+  std::unique_lock<std::mutex> l(mu_);
+  while (true) {
+    cv_.wait(l, [this] { return !queue_.empty() || done_; });
+    if (queue_.empty()) {
+      return;
+    }
+    const auto [image, block] = queue_.front();
+    queue_.pop_front();
+    busy_ = true;
+    l.unlock();
+    // After a failure, keep draining the queue so that finish() returns.
+    if (!error_) {
+      try {
+        write(*image, block);
+      } catch (...) {
+        error_ = std::current_exception();
+      }
+    }
+    l.lock();
+    busy_ = false;
+    if (queue_.empty()) {
+      drained_.notify_all();
+    }
+  }
+}
+
+void ImageWriter::write(const Framebuffer& image, const Block& block) {
+  // Sizes and coordinates within the file's window.
+  const size_t width = window_.x1 - window_.x0;
+  const size_t height = window_.y1 - window_.y0;
+  const size_t x0 = block.x0 - window_.x0;
+  const auto span = block.x1 - block.x0;
+  std::vector<uint8_t> bytes;
+  std::vector<float> floats;
+  for (auto frameY = block.y0; frameY < block.y1; ++frameY) {
+    const size_t y = frameY - window_.y0;
+    switch (format_) {
+      case ImageFormat::PPM:
+        bytes.clear();
+        for (auto x = block.x0; x < block.x1; ++x) {
+          for (auto c = 0; c < 3; ++c) {
+            bytes.push_back(toByte(image(x, frameY)[c]));
+          }
+        }
+        pwriteAll(reinterpret_cast<const char*>(bytes.data()), bytes.size(),
+                  dataOffset_ + (y * width + x0) * 3);
+        break;
+      case ImageFormat::PFM:
+        floats.clear();
+        for (auto x = block.x0; x < block.x1; ++x) {
+          for (auto c = 0; c < 3; ++c) {
+            floats.push_back(image(x, frameY)[c]);
+          }
+        }
+        // Rows run bottom to top.
+        pwriteAll(reinterpret_cast<const char*>(floats.data()),
+                  floats.size() * sizeof(float),
+                  dataOffset_ + ((height - 1 - y) * width + x0) * 3 *
+                                    sizeof(float));
+        break;
+      case ImageFormat::EXR: {
+        // Each scanline holds all of B, then G, then R.
+        const auto line = dataOffset_ +
+                          y * (kExrLinePrefix + width * 3 * sizeof(float)) +
+                          kExrLinePrefix;
+        for (auto plane = 0U; plane < 3; ++plane) {
+          floats.clear();
+          for (auto x = block.x0; x < block.x1; ++x) {
+            floats.push_back(image(x, frameY)[kExrChannels[plane]]);
+          }
+          pwriteAll(reinterpret_cast<const char*>(floats.data()),
+                    span * sizeof(float),
+                    line + (plane * width + x0) * sizeof(float));
+        }
+        break;
+      }
+    }
+  }
+}
+
+void ImageWriter::pwriteAll(const char* data, size_t size, size_t offset) {
+  while (size > 0) {
+    const auto written = ::pwrite(fd_, data, size, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Failed to write image file");
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+void writeImage(const std::string& path, const Framebuffer& image) {
+  ImageWriter writer(path, image.width(), image.height());
+  for (auto tile = 0U; tile < image.numTiles(); ++tile) {
+    writer.submit(image, image.tile(tile));
+  }
+  writer.finish();
+}
+}  // namespace tinyrt
@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "core/framebuffer.h"
+
+namespace tinyrt {
+enum class ImageFormat {
+  PPM,  // Binary P6, 8 bits per channel, clamped to [0, 1].
+  PFM,  // Little-endian float RGB.
+  EXR,  // OpenEXR, uncompressed float scanlines.
+};
+
+// By extension: .pfm, .exr, and otherwise PPM.
+ImageFormat imageFormatOf(const std::string& path);
+
+// Writes an image file block by block from a background thread, so that
+// output I/O overlaps with rendering. All supported formats are
+// uncompressed, so the file is laid out at its final size up front and each
+// block is written straight to its pixels' offsets, in any order. Memory use
+// is therefore independent of the image size, and images larger than memory
+// can be written one band at a time.
+class ImageWriter final {
+ public:
+  // Creates path for a width x height image.
+  ImageWriter(const std::string& path, unsigned width, unsigned height);
+  // Creates path for only the window of a width x height frame, e.g. a crop
+  // of it. Pixels keep their frame coordinates in submit(). EXR files record
+  // the window in the frame, so that they composite back in place.
+  ImageWriter(const std::string& path, unsigned width, unsigned height,
+              const Block& window);
+  ImageWriter(const ImageWriter&) = delete;
+  ImageWriter& operator=(const ImageWriter&) = delete;
+  // Finishes pending writes, dropping any error.
+  ~ImageWriter();
+
+  // Queues block of image for writing. image must stay alive, and the
+  // block's pixels unchanged, until drain() or finish() returns.
+  void submit(const Framebuffer& image, const Block& block);
+  // Waits until all submitted blocks are written.
+  void drain();
+  // Waits until all submitted blocks are written, and closes the file.
+  // Throws std::runtime_error if any write failed.
+  void finish();
+
+ private:
+  void run();
+  void write(const Framebuffer& image, const Block& block);
+  void pwriteAll(const char* data, size_t size, size_t offset);
+
+  const Block window_;
+  const ImageFormat format_;
+  int fd_ = -1;
+  // Offset of the first pixel data.
+  size_t dataOffset_ = 0;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  // Signalled when the queue runs empty.
+  std::condition_variable drained_;
+  std::deque<std::pair<const Framebuffer*, Block>> queue_;
+  // Whether the thread is writing a block it took off the queue.
+  bool busy_ = false;
+  bool done_ = false;
+  std::exception_ptr error_;
+  std::thread thread_;
+};
+
+// Writes image to path in one go; pixels outside its region stay black.
+void writeImage(const std::string& path, const Framebuffer& image);
+}  // namespace tinyrt
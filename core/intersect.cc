@@ -22,19 +22,22 @@
 
 #include "core/intersect.h"
 
+#include <limits>
+
 namespace tinyrt {
-std::optional<Intersection> intersect(const Ray& ray,
-                                      const Triangle& triangle) {
+std::optional<Hit> intersect(const Ray& ray, const Mesh& mesh,
+                             const uint32_t primitive) {
   const float EPSILON = 1e-6f;
-  auto ab = triangle.b().coord - triangle.a().coord;
-  auto ac = triangle.c().coord - triangle.a().coord;
+  const auto p0 = mesh.position(primitive, 0);
+  auto ab = mesh.position(primitive, 1) - p0;
+  auto ac = mesh.position(primitive, 2) - p0;
   auto h = ray.direction.cross(ac);
   auto a = ab.dot(h);
   if (a > -EPSILON && a < EPSILON) {
     return std::nullopt;
   }
   auto f = 1.f / a;
-  auto s = ray.origin - triangle.a().coord;
+  auto s = ray.origin - p0;
   auto u = f * s.dot(h);
   if (u < 0.0 || u > 1.0) {
     return std::nullopt;
@@ -48,24 +51,26 @@ std::optional<Intersection> intersect(const Ray& ray,
   if (t <= EPSILON) {
     return std::nullopt;
   }
-  return Intersection(ray, t, Vec3(u, v, 0.f), triangle, triangle.material());
+  return Hit{t, u, v, primitive};
 }
 
 template <typename T>
-std::optional<Intersection> intersect(const Ray& ray, const T& triangles,
-                                      const float tEntry, const float tExit) {
+std::optional<Hit> intersect(const Ray& ray, const T& triangles,
+                             const float tEntry, const float tExit) {
   using vec3_t = typename T::vec3_t;
   using float_t = typename vec3_t::float_t;
-  static const float_t EPSILON = 1e-6f;
-  static const float_t ZERO = 0.f;
-  static const float_t ONE = 1.f;
+  // Plain locals rather than statics: broadcasts are cheaper than the
+  // initialization guard, and this is the innermost loop.
+  const float_t EPSILON = 1e-6f;
+  const float_t ZERO = 0.f;
+  const float_t ONE = 1.f;
   vec3_t origin(ray.origin->x, ray.origin->y, ray.origin->z);
   vec3_t direction(ray.direction->x, ray.direction->y, ray.direction->z);
   auto ab = triangles.b() - triangles.a();
   auto ac = triangles.c() - triangles.a();
   auto h = direction.cross(ac);
   auto a = ab.dot(h);
-  auto pass = std::abs(a) >= EPSILON;
+  auto pass = (a >= EPSILON) || (a <= -EPSILON);
   if (!pass) {
     return std::nullopt;
   }
@@ -93,59 +98,67 @@ std::optional<Intersection> intersect(const Ray& ray, const T& triangles,
   if (idx < 0) {
     return std::nullopt;
   }
-  const auto& triangle = *triangles.sources[idx];
-  return Intersection(ray, t.v[idx], Vec3(u.v[idx], v.v[idx], 0.f), triangle,
-                      triangle.material());
+  return Hit{t.v[idx], u.v[idx], v.v[idx], triangles.primitives[idx]};
 }
 
-/* explicit */ template std::optional<Intersection> intersect<AVX512Triangle>(
+/* explicit */ template std::optional<Hit> intersect<AVX512Triangle>(
     const Ray& ray, const AVX512Triangle& triangles, const float tEntry,
     const float tExit);
 
-/* explicit */ template std::optional<Intersection> intersect<AVX2Triangle>(
+/* explicit */ template std::optional<Hit> intersect<AVX2Triangle>(
     const Ray& ray, const AVX2Triangle& triangles, const float tEntry,
     const float tExit);
 
+// Slab tests pick the near and far planes from the ray's sign bits instead of
+// swapping. Axis-parallel rays have infinite reciprocals, so a ray starting
+// exactly on a slab plane yields 0 * inf = NaN; every min/max below is written
+// so that a NaN candidate loses and the previous bound is kept.
 std::optional<std::pair<float, float>> intersect(const Ray& ray,
                                                  const BoundingBox& aabb) {
-  float tmin = (aabb.min()->x - ray.origin->x) / ray.direction->x;
-  float tmax = (aabb.max()->x - ray.origin->x) / ray.direction->x;
-
-  if (tmin > tmax) {
-    std::swap(tmin, tmax);
-  }
-
-  float tymin = (aabb.min()->y - ray.origin->y) / ray.direction->y;
-  float tymax = (aabb.max()->y - ray.origin->y) / ray.direction->y;
-
-  if (tymin > tymax) {
-    std::swap(tymin, tymax);
-  }
-  if (tymin > tmin) {
-    tmin = tymin;
-  }
-  if (tymax < tmax) {
-    tmax = tymax;
-  }
-  if (tmax <= tmin) {
+  const Vec3* bounds[2] = {&aabb.min(), &aabb.max()};
+  float tEntry = -std::numeric_limits<float>::infinity();
+  float tExit = std::numeric_limits<float>::infinity();
+  for (auto dim = 0U; dim < 3; ++dim) {
+    const auto tNear = ((*bounds[ray.sign[dim]])[dim] - ray.origin[dim]) *
+                       ray.invDirection[dim];
+    const auto tFar = ((*bounds[1 - ray.sign[dim]])[dim] - ray.origin[dim]) *
+                      ray.invDirection[dim];
+    tEntry = tNear > tEntry ? tNear : tEntry;
+    tExit = tFar < tExit ? tFar : tExit;
+  }
+  if (tExit < tEntry) {
     return std::nullopt;
   }
+  return std::make_pair(tEntry, tExit);
+}
 
-  float tzmin = (aabb.min()->z - ray.origin->z) / ray.direction->z;
-  float tzmax = (aabb.max()->z - ray.origin->z) / ray.direction->z;
-
-  if (tzmin > tzmax) {
-    std::swap(tzmin, tzmax);
-  }
-  if (tzmin > tmin) {
-    tmin = tzmin;
-  }
-  if (tzmax < tmax) {
-    tmax = tzmax;
-  }
-  if (tmax <= tmin) {
-    return std::nullopt;
-  }
-  return std::make_pair(tmin, tmax);
+// The SIMD min/max intrinsics return their second operand when either one is
+// NaN, so the running bound always goes second.
+template <typename TVec3>
+SimdSlabHit<TVec3> intersect(const Ray& ray,
+                             const SimdBoundingBox<TVec3>& aabbs,
+                             const float tEntry, const float tExit) {
+  using float_t = typename TVec3::float_t;
+  float_t entry = tEntry;
+  float_t exit = tExit;
+  for (auto dim = 0U; dim < 3; ++dim) {
+    const float_t origin = ray.origin[dim];
+    const float_t invDirection = ray.invDirection[dim];
+    const auto tNear =
+        (aabbs.bounds[ray.sign[dim]][dim] - origin) * invDirection;
+    const auto tFar =
+        (aabbs.bounds[1 - ray.sign[dim]][dim] - origin) * invDirection;
+    entry = tinyrt::max(tNear, entry);
+    exit = tinyrt::min(tFar, exit);
+  }
+  return {entry <= exit, entry, exit};
 }
+
+/* explicit */ template SimdSlabHit<AVX512Vec3> intersect<AVX512Vec3>(
+    const Ray& ray, const SimdBoundingBox<AVX512Vec3>& aabbs,
+    const float tEntry, const float tExit);
+
+/* explicit */ template SimdSlabHit<AVX2Vec3> intersect<AVX2Vec3>(
+    const Ray& ray, const SimdBoundingBox<AVX2Vec3>& aabbs, const float tEntry,
+    const float tExit);
 }  // namespace tinyrt
@@ -24,16 +24,33 @@
 
 #include "core/bounding_box.h"
 #include "core/ray.h"
+#include "core/simd_bounding_box.h"
 #include "core/simd_triangle.h"
-#include "core/triangle.h"
+#include "core/mesh.h"
 
 namespace tinyrt {
-std::optional<Intersection> intersect(const Ray& ray, const Triangle& triangle);
+std::optional<Hit> intersect(const Ray& ray, const Mesh& mesh,
+                             const uint32_t primitive);
 
+// The closest of the packed triangles hit within [tEntry, tExit].
 template <typename T>
-std::optional<Intersection> intersect(const Ray& ray, const T& triangles,
-                                      const float tEntry, const float tExit);
+std::optional<Hit> intersect(const Ray& ray, const T& triangles,
+                             const float tEntry, const float tExit);
 
 std::optional<std::pair<float, float>> intersect(const Ray& ray,
                                                  const BoundingBox& aabb);
+
+template <typename TVec3>
+struct SimdSlabHit {
+  typename TVec3::bool_t mask;
+  typename TVec3::float_t tEntry;
+  typename TVec3::float_t tExit;
+};
+
+// One ray against kSimdWidth boxes, clipped to [tEntry, tExit], e.g. the
+// triangle groups of a kd-tree leaf.
+template <typename TVec3>
+SimdSlabHit<TVec3> intersect(const Ray& ray,
+                             const SimdBoundingBox<TVec3>& aabbs,
+                             const float tEntry, const float tExit);
 }  // namespace tinyrt
@@ -0,0 +1,179 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Microbenchmark of the SIMD ray/triangle kernel, intersect() on packed
+// triangles: every triangle of a scene against rays from the default camera,
+// in ns per packet, best of several runs. Times the kernel as it was before
+// dot() and cross() were fused into FMA chains next to the current one. Takes
+// the scene as -obj, an absolute path under bazel run.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "core/intersect.h"
+#include "core/obj.h"
+#include "core/random.h"
+#include "core/simd_triangle.h"
+#include "util/arena.h"
+#include "util/capabilities.h"
+#include "util/flag.h"
+
+using namespace tinyrt;
+
+constexpr char kOBJPath[] = "-obj";
+constexpr char kRays[] = "-rays";
+constexpr char kRuns[] = "-runs";
+
+template <typename TVec3>
+typename TVec3::float_t unfusedDot(const TVec3& a, const TVec3& b) {
+  return a->x * b->x + a->y * b->y + a->z * b->z;
+}
+
+template <typename TVec3>
+TVec3 unfusedCross(const TVec3& a, const TVec3& b) {
+  return TVec3(a->y * b->z - a->z * b->y, a->z * b->x - a->x * b->z,
+               a->x * b->y - a->y * b->x);
+}
+
+// intersect() before the FMA change: separate multiplies and adds, statics
+// for the constants and std::abs. Kept out of line like the library kernel,
+// which the loop below calls across translation units.
+template <typename T>
+[[gnu::noinline]] std::optional<Hit> unfusedIntersect(const Ray& ray,
+                                                      const T& triangles,
+                                                      const float tEntry,
+                                                      const float tExit) {
+  using vec3_t = typename T::vec3_t;
+  using float_t = typename vec3_t::float_t;
+  static const float_t EPSILON = 1e-6f;
+  static const float_t ZERO = 0.f;
+  static const float_t ONE = 1.f;
+  vec3_t origin(ray.origin->x, ray.origin->y, ray.origin->z);
+  vec3_t direction(ray.direction->x, ray.direction->y, ray.direction->z);
+  auto ab = triangles.b() - triangles.a();
+  auto ac = triangles.c() - triangles.a();
+  auto h = unfusedCross(direction, ac);
+  auto a = unfusedDot(ab, h);
+  auto pass = std::abs(a) >= EPSILON;
+  if (!pass) {
+    return std::nullopt;
+  }
+  auto f = 1.f / a;
+  auto s = origin - triangles.a();
+  auto u = f * unfusedDot(s, h);
+  pass = pass && (u >= ZERO) && (u <= ONE);
+  if (!pass) {
+    return std::nullopt;
+  }
+  auto q = unfusedCross(s, ab);
+  auto v = f * unfusedDot(direction, q);
+  pass = pass && (v >= ZERO) && (u + v <= ONE);
+  if (!pass) {
+    return std::nullopt;
+  }
+  auto t = f * unfusedDot(ac, q);
+  pass = pass && (t > EPSILON) && (t <= EPSILON + tExit) &&
+         (t + EPSILON >= tEntry);
+  if (!pass) {
+    return std::nullopt;
+  }
+  t = t.retain(pass, std::numeric_limits<float>::max());
+  const auto idx = t.minIndex();
+  if (idx < 0) {
+    return std::nullopt;
+  }
+  return Hit{t.v[idx], u.v[idx], v.v[idx], triangles.primitives[idx]};
+}
+
+// One pass of every ray against every packet, in ns per packet.
+template <typename TKernel, typename TTriangle>
+double nsPerPacket(const TKernel& kernel, const std::vector<Ray>& rays,
+                   const std::span<const TTriangle> triangles,
+                   unsigned& hits) {
+  const auto begin = std::chrono::steady_clock::now();
+  hits = 0;
+  for (const auto& ray : rays) {
+    for (const auto& packet : triangles) {
+      hits += kernel(ray, packet, 0.f, 1e30f).has_value();
+    }
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - begin;
+  return elapsed.count() / (rays.size() * triangles.size());
+}
+
+template <typename TVec3>
+void benchmark(const char* name, const Mesh& mesh, const unsigned numRays,
+               const unsigned runs) {
+  Arena arena;
+  std::vector<uint32_t> primitives(mesh.size());
+  std::iota(primitives.begin(), primitives.end(), 0U);
+  const auto triangles = buildSimdTriangles<TVec3>(mesh, primitives, arena);
+  Random random(0);
+  std::vector<Ray> rays;
+  for (auto i = 0U; i < numRays; ++i) {
+    rays.emplace_back(Vec3(0.f, .8f, 3.93f),
+                      Vec3(random.uniform() - .5f, random.uniform() - .5f,
+                           -1.f));
+  }
+  using triangle_t = SimdTriangle<TVec3>;
+  using kernel_t = std::optional<Hit> (*)(const Ray&, const triangle_t&, float,
+                                          float);
+  // Interleaved so that both kernels see the same machine load.
+  auto unfusedBest = std::numeric_limits<double>::max();
+  auto fusedBest = std::numeric_limits<double>::max();
+  unsigned unfusedHits = 0;
+  unsigned fusedHits = 0;
+  for (auto run = 0U; run < runs; ++run) {
+    unfusedBest = std::min(
+        unfusedBest, nsPerPacket(unfusedIntersect<triangle_t>, rays,
+                                 triangles, unfusedHits));
+    fusedBest = std::min(
+        fusedBest, nsPerPacket(static_cast<kernel_t>(intersect<triangle_t>),
+                               rays, triangles, fusedHits));
+  }
+  std::printf(
+      "%s: unfused %.2f, fused %.2f ns per packet (%.2fx), %zu packets, "
+      "%u/%u hits\n",
+      name, unfusedBest, fusedBest, unfusedBest / fusedBest, triangles.size(),
+      unfusedHits, fusedHits);
+}
+
+int main(const int argc, const char** argv) {
+  initFlags(argc, argv);
+  Flags<String<kOBJPath>, Int<kRays, 4096>, Int<kRuns, 25>> flags;
+  const auto scene = Obj(flags.get<kOBJPath>()).moveToScene();
+  const unsigned numRays = std::max(flags.get<kRays>(), 1);
+  const unsigned runs = std::max(flags.get<kRuns>(), 1);
+  if (supportsAvx2()) {
+    benchmark<AVX2Vec3>("AVX2", scene->mesh(), numRays, runs);
+  }
+  if (supportsAvx512f()) {
+    benchmark<AVX512Vec3>("AVX-512", scene->mesh(), numRays, runs);
+  }
+  return 0;
+}
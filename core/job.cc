@@ -0,0 +1,322 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/job.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+#include "core/camera.h"
+#include "core/checkpoint.h"
+#include "core/image_writer.h"
+#include "core/preview.h"
+#include "core/rasterizer.h"
+#include "core/scene_cache.h"
+#include "util/async.h"
+#include "util/hash.h"
+#include "util/log.h"
+
+namespace tinyrt {
+Job parseJob(const Json& request, const Job& defaults) {
+  if (!request["out"].isString()) {
+    throw std::invalid_argument("Jobs need an \"out\"");
+  }
+  auto job = defaults;
+  if (request["scene"].isString()) {
+    job.scenePath = request["scene"].string();
+  }
+  job.outPath = request["out"].string();
+  const auto count = [&](const char* key, const unsigned fallback) {
+    const auto value = request[key].number(fallback);
+    if (!(value >= 1 && value <= 1 << 20)) {
+      throw std::invalid_argument(std::string("Bad \"") + key + "\"");
+    }
+    return static_cast<unsigned>(value);
+  };
+  job.width = count("width", job.width);
+  job.height = count("height", job.height);
+  job.samples = count("samples", job.samples);
+  job.passSamples = count("pass_samples", job.passSamples);
+  if (const auto& crop = request["crop"]; !crop.isNull()) {
+    if (crop.size() != 4) {
+      throw std::invalid_argument("Bad \"crop\"");
+    }
+    unsigned corners[4];
+    for (auto i = 0UL; i < 4; ++i) {
+      corners[i] = std::clamp(crop[i].number(), 0., double(1 << 30));
+    }
+    job.crop = Block{corners[0], corners[1], corners[2], corners[3]};
+  }
+  const auto seed = request["seed"].number(job.seed);
+  if (!(seed >= 0 && seed < 4294967296.) || seed != std::floor(seed)) {
+    throw std::invalid_argument("Bad \"seed\"");
+  }
+  job.seed = static_cast<uint32_t>(seed);
+  job.meshOptions.quantizePositions =
+      request["quantize_positions"].boolean(
+          job.meshOptions.quantizePositions);
+  job.preview = request["preview"].boolean(job.preview);
+  job.rasterSamples = std::clamp(
+      request["raster_samples"].number(job.rasterSamples), 0., 256.);
+  const auto& camera = request["camera"];
+  const auto vector = [&](const char* key, const Vec3& fallback) {
+    const auto& value = camera[key];
+    if (value.isNull()) {
+      return fallback;
+    }
+    if (value.size() != 3) {
+      throw std::invalid_argument(std::string("Bad camera \"") + key + "\"");
+    }
+    return Vec3(value[0UL].number(), value[1UL].number(),
+                value[2UL].number());
+  };
+  job.position = vector("position", job.position);
+  job.direction = vector("direction", job.direction);
+  job.up = vector("up", job.up);
+  job.fov = camera["fov"].number(job.fov);
+  return job;
+}
+
+std::string jobJson(const Job& job) {
+  const auto number = [](const double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    return std::string(text);
+  };
+  const auto vector = [&](const Vec3& v) {
+    return "[" + number(v->x) + "," + number(v->y) + "," + number(v->z) + "]";
+  };
+  const auto region = job.region();
+  return "{\"scene\":" + quote(job.scenePath) +
+         ",\"out\":" + quote(job.outPath) +
+         ",\"width\":" + std::to_string(job.width) +
+         ",\"height\":" + std::to_string(job.height) + ",\"crop\":[" +
+         std::to_string(region.x0) + "," + std::to_string(region.y0) + "," +
+         std::to_string(region.x1) + "," + std::to_string(region.y1) +
+         "],\"samples\":" + std::to_string(job.samples) +
+         ",\"pass_samples\":" + std::to_string(job.passSamples) +
+         ",\"seed\":" + std::to_string(job.seed) + ",\"quantize_positions\":" +
+         (job.meshOptions.quantizePositions ? "true" : "false") +
+         ",\"raster_samples\":" + std::to_string(job.rasterSamples) +
+         ",\"camera\":{\"position\":" + vector(job.position) +
+         ",\"direction\":" + vector(job.direction) +
+         ",\"up\":" + vector(job.up) + ",\"fov\":" + number(job.fov) + "}}";
+}
+
+void render(const Job& job, const Scene& scene, const Renderer& renderer,
+            Retained* retained) {
+  const auto width = job.width;
+  const auto height = job.height;
+  const auto region = job.region();
+  // Bands of whole tile rows bound memory for huge images; by default the
+  // whole image is one band.
+  const unsigned bandHeight = job.bandRows > 0
+                                  ? job.bandRows * Framebuffer::kTileSize
+                                  : region.y1 - region.y0;
+
+  TraceOptions options{
+      .indirectRays = 1,
+      .shadowRays = 1,
+  };
+  const auto samples = job.samples;
+  const auto passSamples = std::max(job.passSamples, 1U);
+  const auto rayGenerator =
+      Camera(job.position, job.direction, job.up, job.fov).adapt(width, height);
+  const auto seed = job.seed;
+
+  // Passes are cut the same way whether or not the render is resumed, so
+  // their size is part of what a checkpoint must match. So is the scene's
+  // content, lest an edited file be averaged into the saved sums.
+  const auto& checkpointPath = job.checkpointPath;
+  auto inputs = std::to_string(width) + " " + std::to_string(height) + " " +
+                std::to_string(passSamples) + " " +
+                std::to_string(options.indirectRays) + " " +
+                std::to_string(options.shadowRays) + " " +
+                std::to_string(job.meshOptions.quantizePositions) + " " +
+                std::to_string(region.x0) + " " + std::to_string(region.y0) +
+                " " + std::to_string(region.x1) + " " +
+                std::to_string(region.y1) + " " +
+                std::to_string(job.rasterSamples);
+  for (const auto& vector : {job.position, job.direction, job.up}) {
+    for (auto c = 0; c < 3; ++c) {
+      inputs += " " + std::to_string(vector[c]);
+    }
+  }
+  inputs += " " + std::to_string(job.fov);
+  const Checkpoint checkpointed{
+      .key = checkpointPath.empty()
+                 ? 0
+                 : hashBytes(inputs,
+                             SceneCache(job.scenePath, job.meshOptions).key()),
+      .seed = seed,
+  };
+  if (!checkpointPath.empty() && bandHeight < region.y1 - region.y0) {
+    throw std::runtime_error("Checkpoints need the whole image in one band");
+  }
+  const auto retain = retained && checkpointPath.empty() &&
+                      bandHeight >= region.y1 - region.y0;
+  const auto reuse = retain && retained->image;
+
+  LOG(INFO) << "Rendering started.";
+  const auto begin = std::chrono::steady_clock::now();
+  std::unique_ptr<ImageWriter> writer;
+  for (auto y0 = region.y0; y0 < region.y1; y0 += bandHeight) {
+    const Block band{region.x0, y0, region.x1,
+                     std::min(region.y1, y0 + bandHeight)};
+    Framebuffer result(width, height, band);
+    Progress progress(width, height, band);
+    const auto totalBlocks = result.numTiles();
+
+    auto done = 0U;
+    if (job.resume) {
+      const auto saved = loadCheckpoint(checkpointPath, progress);
+      if (saved.key != checkpointed.key || saved.seed != checkpointed.seed) {
+        throw std::runtime_error("Checkpoint " + checkpointPath +
+                                 " is of a different render");
+      }
+      done = saved.samples;
+      for (auto y = band.y0; y < band.y1 && done > 0; ++y) {
+        for (auto x = band.x0; x < band.x1; ++x) {
+          result(x, y) = progress(x, y).sum / progress(x, y).samples;
+        }
+      }
+      LOG(INFO) << "Resuming at " << done << "/" << samples << " samples.";
+    }
+    // Created only now, so that a refused checkpoint leaves the output be.
+    if (!writer) {
+      writer = std::make_unique<ImageWriter>(job.outPath, width, height,
+                                             region);
+    }
+    // The tiles to render; the others are done already.
+    std::vector<unsigned> tiles;
+    std::vector<MaterialMask> touched(totalBlocks);
+    if (reuse) {
+      result.pixels() = retained->image->pixels();
+      for (auto tile = 0U; tile < totalBlocks; ++tile) {
+        if (retained->touched[tile] & retained->stale) {
+          tiles.push_back(tile);
+        } else {
+          touched[tile] = retained->touched[tile];
+          writer->submit(result, result.tile(tile));
+        }
+      }
+      LOG(INFO) << "Rendering " << tiles.size() << "/" << totalBlocks
+                << " tiles that hit edited materials.";
+      if (tiles.empty()) {
+        done = samples;
+      }
+    } else {
+      tiles.resize(totalBlocks);
+      std::iota(tiles.begin(), tiles.end(), 0U);
+    }
+    if (job.preview && done == 0 && !reuse) {
+      preview(scene, renderer, rayGenerator, seed, result, *writer);
+    }
+    std::optional<GBuffer> gbuffer;
+    if (job.rasterSamples > 0 && done < samples) {
+      const auto rasterBegin = std::chrono::steady_clock::now();
+      gbuffer.emplace(width, height, band,
+                      jitteredOffsets(job.rasterSamples, seed));
+      rasterize(scene, rayGenerator, *gbuffer);
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - rasterBegin;
+      LOG(INFO) << "Rasterized " << job.rasterSamples
+                << " primary hits per pixel, " << elapsed.count() << "s.";
+    }
+
+    const unsigned numTiles = tiles.size();
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    if (done >= samples && !reuse) {
+      for (const auto tile : tiles) {
+        writer->submit(result, result.tile(tile));
+      }
+    }
+    while (done < samples) {
+      options.directRays = std::min(passSamples, samples - done);
+      const auto lastPass = done + options.directRays == samples;
+      std::atomic_uint completed = 0;
+      Async::submitN(
+          [&](const unsigned index) {
+            const auto tile = tiles[index];
+            const auto pixels = result.tile(tile);
+            auto tileOptions = options;
+            if (retain) {
+              tileOptions.touchedMaterials = &touched[tile];
+            }
+            if (gbuffer) {
+              renderer.renderRasterizedPass(scene, rayGenerator, tileOptions,
+                                            seed, pixels, *gbuffer, progress,
+                                            result);
+            } else {
+              renderer.renderPass(scene, rayGenerator, tileOptions, seed,
+                                  pixels, progress, result);
+            }
+            // Pixels are final after the last pass; previews show them all.
+            if (lastPass || job.preview) {
+              writer->submit(result, pixels);
+            }
+            const auto completedBlocks = ++completed;
+            if (completedBlocks % std::max(numTiles / 10, 1U) == 0) {
+              LOG(INFO) << "Finished " << completedBlocks << "/" << numTiles;
+            }
+          },
+          numTiles);
+      done += options.directRays;
+      // Passes write into result, which must not change under the writer.
+      if (job.preview) {
+        writer->drain();
+      }
+      LOG(INFO) << "Pass done, rows " << band.y0 << "-" << band.y1 << ", "
+                << done << "/" << samples << " samples.";
+
+      const auto now = std::chrono::steady_clock::now();
+      if (!checkpointPath.empty() &&
+          (lastPass || now - lastCheckpoint >= job.checkpointInterval)) {
+        auto checkpoint = checkpointed;
+        checkpoint.samples = done;
+        saveCheckpoint(checkpointPath, checkpoint, progress);
+        lastCheckpoint = now;
+        LOG(INFO) << "Checkpoint written: " << checkpointPath;
+      }
+    }
+    // The band's buffers go away with this iteration.
+    writer->drain();
+    if (retain) {
+      retained->image = std::make_unique<Framebuffer>(std::move(result));
+      retained->touched = std::move(touched);
+      retained->stale = 0;
+    }
+  }
+  LOG(INFO) << "Rendering finished. Time elapsed="
+            << std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now() - begin)
+                   .count()
+            << "s.";
+  if (scene.textures().size() > 0) {
+    LOG(INFO) << scene.textures();
+  }
+  writer->finish();
+}
+}  // namespace tinyrt
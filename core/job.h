@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/framebuffer.h"
+#include "core/material.h"
+#include "core/mesh.h"
+#include "core/render.h"
+#include "core/scene.h"
+#include "core/vec3.h"
+#include "util/json.h"
+
+namespace tinyrt {
+// One image of a scene: what to render and how. Made from the flags, or per
+// request in serve mode.
+struct Job {
+  std::string scenePath;
+  MeshOptions meshOptions;
+  std::string outPath;
+  // Camera(), as its constructor takes them.
+  Vec3 position{0.f, .8f, 3.93f};
+  Vec3 direction{0.f, 0.f, -1.f};
+  Vec3 up{0.f, 1.f, 0.f};
+  float fov = 32.f;
+  unsigned width;
+  unsigned height;
+  // Pixels of the width x height frame to render, all of them if unset. They
+  // come out as in a render of the whole frame.
+  std::optional<Block> crop;
+  unsigned samples;
+  unsigned passSamples;
+  uint32_t seed;
+  // Rows of tiles per band; 0 for the whole image in one.
+  unsigned bandRows = 0;
+  std::string checkpointPath;
+  std::chrono::seconds checkpointInterval{600};
+  bool resume = false;
+  // Writes coarse-to-fine previews to the output file before the passes,
+  // and every pass after.
+  bool preview = false;
+  // Subpixel offsets to rasterize primary hits at, see rasterize(), instead
+  // of tracing them; 0 traces.
+  unsigned rasterSamples = 0;
+
+  // The pixels to render. Throws std::runtime_error for an empty crop or
+  // one that sticks out of the frame.
+  Block region() const {
+    const auto region = crop.value_or(Block{0, 0, width, height});
+    if (region.x0 >= region.x1 || region.y0 >= region.y1 ||
+        region.x1 > width || region.y1 > height) {
+      throw std::runtime_error("Crop window outside the frame");
+    }
+    return region;
+  }
+};
+
+// A render kept for redoing it after a material edit, see
+// Scene::replaceMaterials(): its image and, per tile, the materials that
+// paths through the tile hit. Tiles that hit none of the stale materials
+// would come out the same, so only the others need rendering again.
+struct Retained {
+  // What was rendered, as jobJson() without the output path.
+  std::string view;
+  std::unique_ptr<Framebuffer> image;
+  std::vector<MaterialMask> touched;
+  // Materials edited since.
+  MaterialMask stale = 0;
+};
+
+// Job from a JSON object that names "out", and may set "scene", "width",
+// "height", "crop" ([x0, y0, x1, y1]), "samples", "pass_samples", "seed",
+// "quantize_positions", "preview", "raster_samples" and a "camera" object
+// of "position", "direction", "up" (3-element arrays) and "fov". Anything
+// left out comes from defaults.
+Job parseJob(const Json& request, const Job& defaults);
+
+// parseJob() line of job, e.g. for workers of a distributed render.
+std::string jobJson(const Job& job);
+
+// Renders job into its output file. Throws std::runtime_error if the job
+// does not fit its checkpoint.
+//
+// Unless job needs bands or a checkpoint, retained, if given, keeps the
+// render. If it holds one already, which must be of the same view, the
+// tiles that no stale material touched are taken from it.
+void render(const Job& job, const Scene& scene, const Renderer& renderer,
+            Retained* retained = nullptr);
+}  // namespace tinyrt
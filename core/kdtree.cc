@@ -30,7 +30,6 @@
 
 namespace tinyrt {
 namespace {
-static constexpr auto kMaxDepth = 15U;
 static constexpr auto kEpsilon = 1e-4f;
 static constexpr auto kTraversal = 1.f;
 
@@ -43,14 +42,15 @@ class DefaultNode final : public KdTree::Node {
               KdTree::NodePtr right)
       : KdTree::Node(split, std::move(left), std::move(right)) {}
 
-  explicit DefaultNode(std::vector<const Triangle*> triangles)
-      : triangles_(std::move(triangles)) {}
+  DefaultNode(const Mesh& mesh, std::span<const uint32_t> primitives,
+              Arena& arena)
+      : mesh_(&mesh), primitives_(copy(primitives, arena)) {}
 
-  std::optional<Intersection> intersect(const Ray& ray, const float tEntry,
-                                        const float tExit) const override {
-    std::optional<Intersection> intersection;
-    for (const auto* triangle : triangles_) {
-      auto candidate = ::tinyrt::intersect(ray, *triangle);
+  std::optional<Hit> intersect(const Ray& ray, const float tEntry,
+                               const float tExit) const override {
+    std::optional<Hit> intersection;
+    for (const auto primitive : primitives_) {
+      auto candidate = ::tinyrt::intersect(ray, *mesh_, primitive);
       if (candidate &&
           (candidate->time >= tEntry - kEpsilon &&
            candidate->time <= tExit + kEpsilon) &&
@@ -62,21 +62,30 @@ class DefaultNode final : public KdTree::Node {
   }
 
  private:
-  const std::vector<const Triangle*> triangles_;
+  static std::span<const uint32_t> copy(std::span<const uint32_t> primitives,
+                                        Arena& arena) {
+    auto* data = arena.allocateArray<uint32_t>(primitives.size());
+    std::copy(primitives.begin(), primitives.end(), data);
+    return {data, primitives.size()};
+  }
+
+  const Mesh* const mesh_ = nullptr;
+  const std::span<const uint32_t> primitives_;
 };
 
 class DefaultNodeFactory final : public KdTree::NodeFactory {
  public:
   KdTree::NodePtr createIntermediate(const std::optional<SplitPlane>& split,
                                      KdTree::NodePtr left,
-                                     KdTree::NodePtr right) const override {
-    return std::make_unique<DefaultNode>(split, std::move(left),
-                                         std::move(right));
+                                     KdTree::NodePtr right,
+                                     Arena& arena) const override {
+    return arena.make<DefaultNode>(split, std::move(left), std::move(right));
   }
 
-  KdTree::NodePtr createLeaf(
-      std::vector<const Triangle*> triangles) const override {
-    return std::make_unique<DefaultNode>(std::move(triangles));
+  KdTree::NodePtr createLeaf(const Mesh& mesh,
+                             std::span<const uint32_t> primitives,
+                             Arena& arena) const override {
+    return arena.make<DefaultNode>(mesh, primitives, arena);
   }
 };
 
@@ -124,43 +133,61 @@ static std::pair<float, PlanarPlacement> SAH(
 
 static bool terminate(int N, float minCv) { return (minCv > kIntersect * N); }
 
-static KdTree::NodePtr build(std::vector<const Triangle*> triangles,
+struct BuildContext {
+  const Mesh& mesh;
+  // Bounds of each primitive, indexed by primitive id.
+  const BoundingBox* boxes;
+  const KdTree::NodeFactory& nodeFactory;
+  // Receives the nodes.
+  Arena& arena;
+  // Per-node primitive lists, released once the subtree is built.
+  Arena& scratch;
+};
+
+static KdTree::NodePtr build(std::span<const uint32_t> primitives,
                              const BoundingBox& aabb, const unsigned depth,
                              const std::optional<SplitPlane>& prevSplit,
-                             const KdTree::NodeFactory& nodeFactory) {
-  if (triangles.empty()) {
+                             const BuildContext& context) {
+  if (primitives.empty()) {
     return nullptr;
   }
-  if (triangles.size() <= 16 || depth >= kMaxDepth) {
-    return nodeFactory.createLeaf(std::move(triangles));
+  if (primitives.size() <= 16 || depth >= KdTree::kMaxDepth) {
+    return context.nodeFactory.createLeaf(context.mesh, primitives,
+                                          context.arena);
   }
   const float maxFloat = std::numeric_limits<float>::max();
   float minCosts[3] = {maxFloat, maxFloat, maxFloat};
   std::pair<float, PlanarPlacement> splits[3];
   Async::submitN(
-      [&triangles, &aabb, &minCosts, &splits](unsigned dim) {
+      [&primitives, &aabb, &context, &minCosts, &splits](unsigned dim) {
         enum Type { ENDING, PLANAR, STARTING };
         using event_t = std::pair<float, Type>;
-        std::vector<event_t> candidates;
-        candidates.reserve(triangles.size() << 1);
-        for (const auto* triangle : triangles) {
-          auto clipped = triangle->aabb();
+        // The dimensions may run on different threads, each with its own
+        // scratch space.
+        static thread_local Arena eventArena;
+        const auto eventMark = eventArena.mark();
+        auto* events =
+            eventArena.allocateArray<event_t>(primitives.size() << 1);
+        auto numEvents = 0UL;
+        for (const auto primitive : primitives) {
+          auto clipped = context.boxes[primitive];
           clipped.clipTo(aabb);
           if (clipped.planar(dim)) {
-            candidates.emplace_back(clipped.min()[dim], PLANAR);
+            events[numEvents++] = {clipped.min()[dim], PLANAR};
           } else {
-            candidates.emplace_back(clipped.min()[dim], STARTING);
-            candidates.emplace_back(clipped.max()[dim], ENDING);
+            events[numEvents++] = {clipped.min()[dim], STARTING};
+            events[numEvents++] = {clipped.max()[dim], ENDING};
           }
         }
-        std::sort(candidates.begin(), candidates.end(), [](auto& a, auto& b) {
+        const std::span<const event_t> candidates(events, numEvents);
+        std::sort(events, events + numEvents, [](auto& a, auto& b) {
           return (a.first < b.first) ||
                  (a.first == b.first && a.second < b.second);
         });
 
         unsigned leftCount = 0U;
         unsigned planarCount = 0U;
-        unsigned rightCount = triangles.size();
+        unsigned rightCount = primitives.size();
         for (auto i = 0U; i < candidates.size(); ++i) {
           const auto& candidate = candidates[i];
           int starting = 0;
@@ -196,6 +223,7 @@ static KdTree::NodePtr build(std::vector<const Triangle*> triangles,
           leftCount += starting + planar;
           planarCount = 0;
         }
+        eventArena.rewind(eventMark);
       },
       3);
 
@@ -206,58 +234,74 @@ static KdTree::NodePtr build(std::vector<const Triangle*> triangles,
       bestDim = dim;
     }
   }
-  if (bestDim == -1 || terminate(triangles.size(), minCosts[bestDim])) {
-    return nodeFactory.createLeaf(std::move(triangles));
+  if (bestDim == -1 || terminate(primitives.size(), minCosts[bestDim])) {
+    return context.nodeFactory.createLeaf(context.mesh, primitives,
+                                          context.arena);
   }
   const auto bestSplit = splits[bestDim];
   const SplitPlane split(bestDim, bestSplit.first);
   if (prevSplit && split == *prevSplit) {
-    return nodeFactory.createLeaf(std::move(triangles));
+    return context.nodeFactory.createLeaf(context.mesh, primitives,
+                                          context.arena);
   }
   const auto aabbs = aabb.cut(bestDim, bestSplit.first);
-  std::vector<const Triangle*> leftTriangles;
-  std::vector<const Triangle*> rightTriangles;
-  for (const auto* triangle : triangles) {
-    const auto aabb = triangle->aabb();
+  auto& scratch = context.scratch;
+  const auto mark = scratch.mark();
+  auto* leftPrimitives = scratch.allocateArray<uint32_t>(primitives.size());
+  auto* rightPrimitives = scratch.allocateArray<uint32_t>(primitives.size());
+  auto leftCount = 0UL;
+  auto rightCount = 0UL;
+  for (const auto primitive : primitives) {
+    const auto& aabb = context.boxes[primitive];
     if (aabb.min()[bestDim] == bestSplit.first &&
         aabb.max()[bestDim] == bestSplit.first) {
       if (bestSplit.second == LEFT) {
-        leftTriangles.push_back(triangle);
+        leftPrimitives[leftCount++] = primitive;
       } else {
-        rightTriangles.push_back(triangle);
+        rightPrimitives[rightCount++] = primitive;
       }
     } else {
       if (aabb.min()[bestDim] <= bestSplit.first) {
-        leftTriangles.push_back(triangle);
+        leftPrimitives[leftCount++] = primitive;
       }
       if (aabb.max()[bestDim] >= bestSplit.first) {
-        rightTriangles.push_back(triangle);
+        rightPrimitives[rightCount++] = primitive;
       }
     }
   }
-  triangles.clear();
-  auto leftChild = build(std::move(leftTriangles), aabbs.first, depth + 1,
-                         split, nodeFactory);
-  auto rightChild = build(std::move(rightTriangles), aabbs.second, depth + 1,
-                          split, nodeFactory);
-  return nodeFactory.createIntermediate(split, std::move(leftChild),
-                                        std::move(rightChild));
+  auto leftChild = build({leftPrimitives, leftCount}, aabbs.first, depth + 1,
+                         split, context);
+  auto rightChild = build({rightPrimitives, rightCount}, aabbs.second,
+                          depth + 1, split, context);
+  scratch.rewind(mark);
+  return context.nodeFactory.createIntermediate(split, std::move(leftChild),
+                                                std::move(rightChild),
+                                                context.arena);
 }
 
 static KdTree::NodePtr build(const Scene& scene,
-                             std::unique_ptr<KdTree::NodeFactory> nodeFactory) {
-  std::vector<const Triangle*> triangles;
-  for (const auto& triangle : scene.triangles()) {
-    triangles.push_back(triangle.get());
+                             std::unique_ptr<KdTree::NodeFactory> nodeFactory,
+                             Arena& arena) {
+  Arena scratch;
+  const auto& mesh = scene.mesh();
+  auto* primitives = scratch.allocateArray<uint32_t>(mesh.size());
+  auto* boxes = scratch.allocateArray<BoundingBox>(mesh.size());
+  for (auto i = 0U; i < mesh.size(); ++i) {
+    primitives[i] = i;
+    boxes[i] = mesh.aabb(i);
   }
-  return build(std::move(triangles), scene.aabb(), 0, std::nullopt,
-               *nodeFactory);
+  const BuildContext context{mesh, boxes, *nodeFactory, arena, scratch};
+  return build({primitives, mesh.size()}, scene.aabb(), 0, std::nullopt,
+               context);
 }
 }  // namespace
 
 KdTree::KdTree(const Scene& scene,
                std::unique_ptr<KdTree::NodeFactory> nodeFactory)
-    : root_(build(scene, nodeFactory ? std::move(nodeFactory)
-                                     : std::make_unique<DefaultNodeFactory>())),
+    : arena_(Arena::kHugePageSize, /*hugePages=*/true),
+      root_(build(scene,
+                  nodeFactory ? std::move(nodeFactory)
+                              : std::make_unique<DefaultNodeFactory>(),
+                  arena_)),
       aabb_(scene.aabb()) {}
 }  // namespace tinyrt
@@ -23,17 +23,22 @@
 #pragma once
 
 #include <optional>
+#include <span>
 
 #include "core/bounding_box.h"
 #include "core/ray.h"
 #include "core/scene.h"
+#include "util/arena.h"
 
 namespace tinyrt {
 class KdTree final {
  public:
   class Node;
   class NodeFactory;
-  using NodePtr = std::unique_ptr<Node>;
+  using NodePtr = arena_ptr<Node>;
+
+  // Leaves are at most this deep, which bounds the traversal stack.
+  static constexpr unsigned kMaxDepth = 15;
 
  public:
   explicit KdTree(const Scene& scene,
@@ -43,6 +48,9 @@ class KdTree final {
   const BoundingBox& aabb() const { return aabb_; }
 
  private:
+  // Holds the nodes and their leaf data, so the tree is freed in one go.
+  // Declared first to outlive root_.
+  Arena arena_;
   NodePtr const root_;
   const BoundingBox aabb_;
 };
@@ -71,9 +79,9 @@ class KdTree::Node {
   const KdTree::NodePtr& left() const { return left_; }
   const KdTree::NodePtr& right() const { return right_; }
 
-  virtual std::optional<Intersection> intersect(const Ray& ray,
-                                                const float tEntry,
-                                                const float tExit) const = 0;
+  // The closest hit with the node's primitives within [tEntry, tExit].
+  virtual std::optional<Hit> intersect(const Ray& ray, const float tEntry,
+                                       const float tExit) const = 0;
 
  private:
   const std::optional<SplitPlane> split_;
@@ -81,13 +89,16 @@ class KdTree::Node {
   const KdTree::NodePtr right_;
 };
 
+// Creates nodes in the tree's arena. Anything a node keeps must live in the
+// arena too.
 class KdTree::NodeFactory {
  public:
   virtual ~NodeFactory() = default;
   virtual KdTree::NodePtr createIntermediate(
       const std::optional<SplitPlane>& split, KdTree::NodePtr left,
-      KdTree::NodePtr right) const = 0;
-  virtual KdTree::NodePtr createLeaf(
-      std::vector<const Triangle*> triangles) const = 0;
+      KdTree::NodePtr right, Arena& arena) const = 0;
+  virtual KdTree::NodePtr createLeaf(const Mesh& mesh,
+                                     std::span<const uint32_t> primitives,
+                                     Arena& arena) const = 0;
 };
 }  // namespace tinyrt
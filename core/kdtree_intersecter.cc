@@ -22,63 +22,82 @@
 
 #include "core/kdtree_intersecter.h"
 
+#include <array>
 #include <exception>
-#include <stack>
 
 #include "core/intersect.h"
+#include "core/simd_kdtree_node.h"
 
 namespace tinyrt {
-
-void KdTreeIntersecter::initialize(const Scene& scene) {
-  kdTree_ = std::make_unique<KdTree>(scene, std::move(nodeFactory_));
-}
-
-std::optional<Intersection> KdTreeIntersecter::intersect(const Ray& ray) const {
-  if (!kdTree_) {
-    throw std::runtime_error("Must initialize with a scene first!");
-  }
-  if (const auto aabbIntersect = ::tinyrt::intersect(ray, kdTree_->aabb())) {
-    return intersectInternal(ray, kdTree_->root(), aabbIntersect->first,
-                             aabbIntersect->second);
+template <typename TNode>
+std::optional<Hit> traverse(const KdTree& kdTree, const Ray& ray) {
+  const auto aabbIntersect = intersect(ray, kdTree.aabb());
+  if (!aabbIntersect) {
+    return std::nullopt;
   }
-  return std::nullopt;
-}
-
-std::optional<Intersection> KdTreeIntersecter::intersectInternal(
-    const Ray& ray, const KdTree::NodePtr& node, const float t0,
-    const float t1) const {
-  using node_visitor_t = std::tuple<KdTree::Node*, float, float>;
-  std::stack<node_visitor_t> stack;
-  stack.emplace(node.get(), t0, t1);
-  while (!stack.empty()) {
-    KdTree::Node* currentNode;
-    float tEntry, tExit;
-    std::tie(currentNode, tEntry, tExit) = stack.top();
-    stack.pop();
+  struct NodeVisitor {
+    const TNode* node;
+    float tEntry;
+    float tExit;
+  };
+  // Each intermediate node on the current path defers at most one child, so
+  // the stack never holds more than one entry per level plus the root.
+  std::array<NodeVisitor, KdTree::kMaxDepth + 1> stack;
+  auto size = 0U;
+  stack[size++] = {static_cast<const TNode*>(kdTree.root().get()),
+                   aabbIntersect->first, aabbIntersect->second};
+  while (size > 0) {
+    auto [currentNode, tEntry, tExit] = stack[--size];
     while (auto& split = currentNode->split()) {
       const auto dim = split->dim;
       const auto pos = split->split;
-      const auto ts = (pos - ray.origin[dim]) / ray.direction[dim];
-      const bool leftFirst = ray.direction[dim] > 0;
-      KdTree::Node* near =
-          leftFirst ? currentNode->left().get() : currentNode->right().get();
-      KdTree::Node* far =
-          leftFirst ? currentNode->right().get() : currentNode->left().get();
-      if (ts > tExit) {
+      const auto ts = (pos - ray.origin[dim]) * ray.invDirection[dim];
+      const bool leftFirst = !ray.sign[dim];
+      const auto* left = static_cast<const TNode*>(currentNode->left().get());
+      const auto* right =
+          static_cast<const TNode*>(currentNode->right().get());
+      const TNode* near = leftFirst ? left : right;
+      const TNode* far = leftFirst ? right : left;
+      // A ray lying in the split plane gives ts = NaN; keep it on the near
+      // side only.
+      if (!(ts <= tExit)) {
         currentNode = near;
       } else if (ts < tEntry) {
         currentNode = far;
       } else {
-        stack.emplace(far, ts, tExit);
+        stack[size++] = {far, ts, tExit};
         currentNode = near;
         tExit = ts;
       }
     }
-    const auto intersection = currentNode->intersect(ray, tEntry, tExit);
-    if (intersection) {
-      return intersection;
+    if (const auto hit = currentNode->intersect(ray, tEntry, tExit)) {
+      return hit;
     }
   }
   return std::nullopt;
 }
+
+/* explicit */ template std::optional<Hit> traverse<KdTree::Node>(
+    const KdTree& kdTree, const Ray& ray);
+
+/* explicit */ template std::optional<Hit> traverse<SimdKdTreeNode<AVX2Vec3>>(
+    const KdTree& kdTree, const Ray& ray);
+
+/* explicit */ template std::optional<Hit>
+traverse<SimdKdTreeNode<AVX512Vec3>>(const KdTree& kdTree, const Ray& ray);
+
+void KdTreeIntersecter::initialize(const Scene& scene) {
+  scene_ = &scene;
+  kdTree_ = std::make_unique<KdTree>(scene, std::move(nodeFactory_));
+}
+
+std::optional<Intersection> KdTreeIntersecter::intersect(const Ray& ray) const {
+  if (!kdTree_) {
+    throw std::runtime_error("Must initialize with a scene first!");
+  }
+  if (const auto hit = traverse<KdTree::Node>(*kdTree_, ray)) {
+    return Intersection(ray, *hit, *scene_);
+  }
+  return std::nullopt;
+}
 }  // namespace tinyrt
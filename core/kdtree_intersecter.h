@@ -26,6 +26,13 @@
 #include "core/kdtree.h"
 
 namespace tinyrt {
+// Finds the nearest hit in kdTree by front-to-back traversal. Nodes are
+// visited as TNode, so when TNode is a final class the leaf tests bind
+// statically and can inline. Every node of the tree must be a TNode. Does not
+// allocate; the caller expands the returned hit if it needs one.
+template <typename TNode>
+std::optional<Hit> traverse(const KdTree& kdTree, const Ray& ray);
+
 class KdTreeIntersecter final : public Intersecter {
  public:
   explicit KdTreeIntersecter(
@@ -35,14 +42,9 @@ class KdTreeIntersecter final : public Intersecter {
   void initialize(const Scene& scene) override;
   std::optional<Intersection> intersect(const Ray& ray) const override;
 
- private:
-  std::optional<Intersection> intersectInternal(const Ray& ray,
-                                                const KdTree::NodePtr& node,
-                                                const float t0,
-                                                const float t1) const;
-
  private:
   std::unique_ptr<KdTree::NodeFactory> nodeFactory_;
+  const Scene* scene_ = nullptr;
   std::unique_ptr<KdTree> kdTree_;
 };
 }  // namespace tinyrt
@@ -22,8 +22,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "core/vec3.h"
@@ -38,6 +40,19 @@ struct Material {
     ALL = (DIFFUSE | SPECULAR | REFLECTION | REFRACTION),
   };
 
+  // Specialized shading code paths, in order of increasing cost. Each one
+  // knows at compile time which parts of the model can be skipped, so hits
+  // can be binned by kernel and shaded without testing the model per hit.
+  enum class Kernel {
+    EMISSIVE,  // Light sources; emission only.
+    DIFFUSE,   // Lambertian, with non-zero diffuse.
+    GLOSSY,    // DIFFUSE plus a specular lobe.
+    MIRROR,    // Adds perfect reflection.
+    GLASS,     // Adds refraction. Also covers any unusual model.
+  };
+  static constexpr unsigned kNumKernels =
+      static_cast<unsigned>(Kernel::GLASS) + 1;
+
   Vec3 ambient;
   Vec3 diffuse;
   Vec3 specular;
@@ -48,7 +63,64 @@ struct Material {
   float sharpness{60.f};
   float specularExponent{10.f};
   float refractionIndex{1.f};
+  // Index into Scene::textures() of the map_Kd texture, which scales diffuse,
+  // or -1 for none.
+  int32_t diffuseTexture{-1};
+  // Set by Scene from selectKernel().
+  Kernel kernel{Kernel::GLASS};
 
   inline bool light() const { return !emittance.zero(); }
+
+  bool operator==(const Material& other) const = default;
+
+  // Returns the cheapest kernel that gives the same result as the full model.
+  inline Kernel selectKernel() const {
+    if (illuminationModel & REFRACTION) {
+      return Kernel::GLASS;
+    }
+    if (illuminationModel & REFLECTION) {
+      return light() ? Kernel::GLASS : Kernel::MIRROR;
+    }
+    if (light()) {
+      return Kernel::EMISSIVE;
+    }
+    if (!(illuminationModel & DIFFUSE) || diffuse.small()) {
+      return Kernel::GLASS;
+    }
+    if ((illuminationModel & SPECULAR) && !specular.small()) {
+      return Kernel::GLOSSY;
+    }
+    return Kernel::DIFFUSE;
+  }
 };
+
+// Set of materials as bits of their index modulo 64, e.g. those that the
+// paths through a tile hit. Materials that share a bit cannot be told apart,
+// so a test against a mask may give false positives but never misses one.
+using MaterialMask = uint64_t;
+
+inline MaterialMask materialBit(const uint32_t materialId) {
+  return MaterialMask{1} << materialId % 64;
+}
+
+// Calls function with std::integral_constant<Material::Kernel, kernel>, so
+// that it can specialize on the kernel at compile time, and returns its
+// result.
+template <typename TFunction>
+inline auto dispatchKernel(const Material::Kernel kernel,
+                           TFunction&& function) {
+  using K = Material::Kernel;
+  switch (kernel) {
+    case K::EMISSIVE:
+      return function(std::integral_constant<K, K::EMISSIVE>());
+    case K::DIFFUSE:
+      return function(std::integral_constant<K, K::DIFFUSE>());
+    case K::GLOSSY:
+      return function(std::integral_constant<K, K::GLOSSY>());
+    case K::MIRROR:
+      return function(std::integral_constant<K, K::MIRROR>());
+    default:
+      return function(std::integral_constant<K, K::GLASS>());
+  }
+}
 }  // namespace tinyrt
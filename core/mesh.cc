@@ -0,0 +1,147 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "util/half.h"
+
+namespace tinyrt {
+namespace {
+static constexpr auto kSnormMax = 32767.f;
+static constexpr auto kQuantizedMax = 65535.f;
+
+static float signNotZero(const float value) { return value >= 0 ? 1.f : -1.f; }
+
+static int16_t toSnorm(const float value) {
+  return static_cast<int16_t>(
+      std::round(std::clamp(value, -1.f, 1.f) * kSnormMax));
+}
+}  // namespace
+
+void Mesh::addVertex(const Vec3& position, const Vec3& normal,
+                     const Vec3* texcoord) {
+  positions.push_back(position);
+  normals.push_back(encodeNormal(normal));
+  if (texcoord) {
+    texcoords.resize(normals.size() - 1);
+    texcoords.push_back(
+        {floatToHalf((*texcoord)->x), floatToHalf((*texcoord)->y)});
+  } else if (!texcoords.empty()) {
+    texcoords.push_back({0, 0});
+  }
+}
+
+void Mesh::computeNormals() {
+  std::vector<Vec3> sums(positions.size());
+  for (auto primitive = 0U; primitive < size(); ++primitive) {
+    const auto* corners = &indices[primitive * 3];
+    const auto& a = positions[corners[0]];
+    // Unnormalized, so larger faces weigh more.
+    const auto normal =
+        (positions[corners[1]] - a).cross(positions[corners[2]] - a);
+    for (auto corner = 0U; corner < 3; ++corner) {
+      sums[corners[corner]] += normal;
+    }
+  }
+  normals.clear();
+  normals.reserve(sums.size());
+  for (const auto& sum : sums) {
+    normals.push_back(encodeNormal(sum));
+  }
+}
+
+void Mesh::quantizePositions() {
+  if (positions.empty()) {
+    return;
+  }
+  BoundingBox bounds;
+  for (const auto& position : positions) {
+    bounds.add(position);
+  }
+  quantizationOrigin = bounds.min();
+  quantizationScale = bounds.size() / kQuantizedMax;
+  quantizedPositions.reserve(positions.size());
+  for (const auto& position : positions) {
+    std::array<uint16_t, 3> quantized;
+    for (auto dim = 0U; dim < 3; ++dim) {
+      const auto extent = bounds.size()[dim];
+      quantized[dim] =
+          extent > 0 ? static_cast<uint16_t>(std::round(
+                           (position[dim] - quantizationOrigin[dim]) /
+                           extent * kQuantizedMax))
+                     : 0;
+    }
+    quantizedPositions.push_back(quantized);
+  }
+  positions.clear();
+  positions.shrink_to_fit();
+}
+
+std::array<float, 2> Mesh::texcoord(const uint32_t primitive,
+                                    const unsigned corner) const {
+  if (texcoords.empty()) {
+    return {0.f, 0.f};
+  }
+  const auto& encoded = texcoords[indices[primitive * 3 + corner]];
+  return {halfToFloat(encoded[0]), halfToFloat(encoded[1])};
+}
+
+BoundingBox Mesh::aabb(const uint32_t primitive) const {
+  BoundingBox aabb;
+  for (auto i = 0U; i < 3; ++i) {
+    aabb.add(position(primitive, i));
+  }
+  return aabb;
+}
+
+uint32_t Mesh::encodeNormal(const Vec3& normal) {
+  const auto l1 =
+      std::abs(normal->x) + std::abs(normal->y) + std::abs(normal->z);
+  if (l1 == 0) {
+    return 0;
+  }
+  auto x = normal->x / l1;
+  auto y = normal->y / l1;
+  if (normal->z < 0) {
+    const auto folded = (1 - std::abs(y)) * signNotZero(x);
+    y = (1 - std::abs(x)) * signNotZero(y);
+    x = folded;
+  }
+  return static_cast<uint16_t>(toSnorm(x)) |
+         (static_cast<uint32_t>(static_cast<uint16_t>(toSnorm(y))) << 16);
+}
+
+Vec3 Mesh::decodeNormal(const uint32_t encoded) {
+  auto x = static_cast<int16_t>(encoded & 0xffff) / kSnormMax;
+  auto y = static_cast<int16_t>(encoded >> 16) / kSnormMax;
+  const auto z = 1 - std::abs(x) - std::abs(y);
+  if (z < 0) {
+    const auto unfolded = (1 - std::abs(y)) * signNotZero(x);
+    y = (1 - std::abs(x)) * signNotZero(y);
+    x = unfolded;
+  }
+  return Vec3(x, y, z).normalize();
+}
+}  // namespace tinyrt
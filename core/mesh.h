@@ -0,0 +1,101 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "core/bounding_box.h"
+#include "core/vec3.h"
+
+namespace tinyrt {
+struct MeshOptions {
+  // Runs optimizeMesh() on the loaded mesh.
+  bool optimize = true;
+  // Stores positions as 16-bit fixed point within the mesh bounds. Halves
+  // their size at the cost of snapping vertices to a 1/65535 grid.
+  bool quantizePositions = false;
+};
+
+// Indexed triangle mesh stored as a structure of arrays. Triangle t is made of
+// vertices indices[3t], indices[3t + 1] and indices[3t + 2], and uses material
+// materialIds[t]. Triangles are addressed by their index t, the primitive id.
+//
+// Vertex attributes are stored compressed and decoded on access: normals in
+// 32-bit octahedral form, texcoords as half floats, and positions either as
+// floats or, after quantizePositions(), as 16-bit offsets in the mesh bounds.
+struct Mesh final {
+  // Empty once quantized.
+  std::vector<Vec3> positions;
+  std::vector<std::array<uint16_t, 3>> quantizedPositions;
+  Vec3 quantizationOrigin;
+  Vec3 quantizationScale;
+  std::vector<uint32_t> normals;
+  // Empty when no face has texture coordinates; zero for vertices without.
+  std::vector<std::array<uint16_t, 2>> texcoords;
+  std::vector<uint32_t> indices;
+  // Index into Scene::materials() per triangle.
+  std::vector<uint32_t> materialIds;
+
+  size_t size() const { return materialIds.size(); }
+  size_t numVertices() const { return normals.size(); }
+
+  // Appends a vertex. texcoord may be null; only its x and y are kept.
+  void addVertex(const Vec3& position, const Vec3& normal,
+                 const Vec3* texcoord);
+  // Fills normals with area-weighted averages of the face normals around each
+  // vertex, for inputs that come without normals. Needs full precision
+  // positions and the indices.
+  void computeNormals();
+  // Switches positions to the quantized form. Call once all vertices are in.
+  void quantizePositions();
+
+  Vec3 vertexPosition(const uint32_t vertex) const {
+    if (!positions.empty()) {
+      return positions[vertex];
+    }
+    const auto& q = quantizedPositions[vertex];
+    return quantizationOrigin +
+           quantizationScale * Vec3(float(q[0]), float(q[1]), float(q[2]));
+  }
+
+  // corner is 0, 1 or 2.
+  Vec3 position(const uint32_t primitive, const unsigned corner) const {
+    return vertexPosition(indices[primitive * 3 + corner]);
+  }
+
+  Vec3 normal(const uint32_t primitive, const unsigned corner) const {
+    return decodeNormal(normals[indices[primitive * 3 + corner]]);
+  }
+
+  std::array<float, 2> texcoord(const uint32_t primitive,
+                                const unsigned corner) const;
+
+  BoundingBox aabb(const uint32_t primitive) const;
+
+  // Octahedral mapping of a unit vector onto two 16-bit snorms.
+  static uint32_t encodeNormal(const Vec3& normal);
+  static Vec3 decodeNormal(const uint32_t encoded);
+};
+}  // namespace tinyrt
@@ -0,0 +1,195 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace tinyrt {
+namespace {
+using triangle_t = std::array<uint32_t, 3>;
+
+struct VertexKey {
+  std::array<uint32_t, 3> position;
+  uint32_t normal;
+  uint32_t texcoord;
+
+  bool operator==(const VertexKey& other) const = default;
+};
+
+static size_t combine(size_t hash, const uint32_t value) {
+  return hash * 31 + std::hash<uint32_t>()(value);
+}
+
+struct VertexKeyHash {
+  size_t operator()(const VertexKey& key) const {
+    size_t hash = 0;
+    for (const auto value : key.position) {
+      hash = combine(hash, value);
+    }
+    return combine(combine(hash, key.normal), key.texcoord);
+  }
+};
+
+struct TriangleHash {
+  size_t operator()(const triangle_t& triangle) const {
+    size_t hash = 0;
+    for (const auto value : triangle) {
+      hash = combine(hash, value);
+    }
+    return hash;
+  }
+};
+
+static VertexKey makeKey(const Mesh& mesh, const uint32_t vertex) {
+  const auto position = mesh.vertexPosition(vertex);
+  uint32_t texcoord = 0;
+  if (!mesh.texcoords.empty()) {
+    texcoord = mesh.texcoords[vertex][0] |
+               (static_cast<uint32_t>(mesh.texcoords[vertex][1]) << 16);
+  }
+  // +0.f folds -0 into 0.
+  return {{std::bit_cast<uint32_t>(position->x + 0.f),
+           std::bit_cast<uint32_t>(position->y + 0.f),
+           std::bit_cast<uint32_t>(position->z + 0.f)},
+          mesh.normals[vertex],
+          texcoord};
+}
+
+// Spreads the low 10 bits of value to every third bit.
+static uint32_t expandBits(uint32_t value) {
+  value = (value * 0x00010001U) & 0xFF0000FFU;
+  value = (value * 0x00000101U) & 0x0F00F00FU;
+  value = (value * 0x00000011U) & 0xC30C30C3U;
+  value = (value * 0x00000005U) & 0x49249249U;
+  return value;
+}
+
+static uint32_t morton(const Vec3& point, const BoundingBox& bounds) {
+  uint32_t code = 0;
+  for (auto dim = 0U; dim < 3; ++dim) {
+    const auto extent = bounds.size()[dim];
+    const auto normalized =
+        extent > 0 ? (point[dim] - bounds.min()[dim]) / extent : 0.f;
+    const auto cell = static_cast<uint32_t>(
+        std::clamp(normalized * 1024.f, 0.f, 1023.f));
+    code |= expandBits(cell) << (2 - dim);
+  }
+  return code;
+}
+
+template <typename T>
+static void gather(std::vector<T>& values,
+                   const std::vector<uint32_t>& order) {
+  if (values.empty()) {
+    return;
+  }
+  std::vector<T> gathered;
+  gathered.reserve(order.size());
+  for (const auto index : order) {
+    gathered.push_back(values[index]);
+  }
+  values = std::move(gathered);
+}
+}  // namespace
+
+MeshOptimization optimizeMesh(Mesh& mesh) {
+  MeshOptimization stats;
+  stats.before = {mesh.numVertices(), mesh.size()};
+
+  // Point every vertex at the first one with the same attributes.
+  std::vector<uint32_t> welded(mesh.numVertices());
+  std::unordered_map<VertexKey, uint32_t, VertexKeyHash> canonical;
+  canonical.reserve(mesh.numVertices());
+  for (auto vertex = 0U; vertex < mesh.numVertices(); ++vertex) {
+    welded[vertex] =
+        canonical.try_emplace(makeKey(mesh, vertex), vertex).first->second;
+  }
+
+  std::vector<triangle_t> triangles;
+  std::vector<uint32_t> materialIds;
+  std::vector<uint32_t> codes;
+  std::unordered_set<triangle_t, TriangleHash> seen;
+  BoundingBox bounds;
+  for (auto vertex = 0U; vertex < mesh.numVertices(); ++vertex) {
+    bounds.add(mesh.vertexPosition(vertex));
+  }
+  for (auto primitive = 0U; primitive < mesh.size(); ++primitive) {
+    triangle_t triangle;
+    for (auto corner = 0U; corner < 3; ++corner) {
+      triangle[corner] = welded[mesh.indices[primitive * 3 + corner]];
+    }
+    const auto a = mesh.vertexPosition(triangle[0]);
+    const auto b = mesh.vertexPosition(triangle[1]);
+    const auto c = mesh.vertexPosition(triangle[2]);
+    if ((b - a).cross(c - a).norm2() == 0) {
+      continue;
+    }
+    // The same vertices in any order cover the same surface, since
+    // intersection tests are two-sided.
+    auto sorted = triangle;
+    std::sort(sorted.begin(), sorted.end());
+    if (!seen.insert(sorted).second) {
+      continue;
+    }
+    triangles.push_back(triangle);
+    materialIds.push_back(mesh.materialIds[primitive]);
+    codes.push_back(morton((a + b + c) / 3.f, bounds));
+  }
+
+  std::vector<uint32_t> order(triangles.size());
+  std::iota(order.begin(), order.end(), 0U);
+  std::stable_sort(order.begin(), order.end(), [&codes](auto lhs, auto rhs) {
+    return codes[lhs] < codes[rhs];
+  });
+
+  // Renumber the surviving vertices in the order the sorted triangles first
+  // use them, dropping the rest.
+  constexpr auto kUnused = ~0U;
+  std::vector<uint32_t> renumbered(mesh.numVertices(), kUnused);
+  std::vector<uint32_t> vertexOrder;
+  mesh.indices.clear();
+  mesh.materialIds.clear();
+  for (const auto t : order) {
+    for (const auto vertex : triangles[t]) {
+      if (renumbered[vertex] == kUnused) {
+        renumbered[vertex] = vertexOrder.size();
+        vertexOrder.push_back(vertex);
+      }
+      mesh.indices.push_back(renumbered[vertex]);
+    }
+    mesh.materialIds.push_back(materialIds[t]);
+  }
+  gather(mesh.positions, vertexOrder);
+  gather(mesh.quantizedPositions, vertexOrder);
+  gather(mesh.normals, vertexOrder);
+  gather(mesh.texcoords, vertexOrder);
+
+  stats.after = {mesh.numVertices(), mesh.size()};
+  return stats;
+}
+}  // namespace tinyrt
@@ -0,0 +1,46 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+
+#include "core/mesh.h"
+
+namespace tinyrt {
+struct MeshStats {
+  size_t vertices = 0;
+  size_t triangles = 0;
+};
+
+struct MeshOptimization {
+  MeshStats before;
+  MeshStats after;
+};
+
+// Cleans up a freshly loaded mesh in place: welds vertices whose attributes
+// are bit-identical, drops zero-area and duplicate triangles, sorts the
+// triangles along a Morton curve of their centroids and renumbers vertices by
+// first use, so that spatially close triangles and their vertices sit close
+// in memory.
+MeshOptimization optimizeMesh(Mesh& mesh);
+}  // namespace tinyrt
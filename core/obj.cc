@@ -22,34 +22,71 @@
 
 #include "core/obj.h"
 
+#include <algorithm>
+#include <exception>
 #include <filesystem>
-#include <fstream>
-#include <sstream>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 
+#include "util/async.h"
+#include "util/mapped_file.h"
+#include "util/text.h"
+
 namespace tinyrt {
 namespace {
-static auto loadMtl(const std::string& path, std::vector<Material>& materials) {
-  std::unordered_map<std::string, uint32_t> matIndexMap;
-  std::ifstream file(path);
-  if (!file.is_open()) {
-    throw std::runtime_error("Failed to open file");
+// Files are split into chunks of at least this size, parsed in parallel.
+static constexpr size_t kMinChunkSize = 1 << 20;
+// An index component the face leaves out, e.g. the texcoord of "1//2".
+static constexpr int32_t kMissing = std::numeric_limits<int32_t>::min();
+
+// The i-th character of op, or '\0' past its end.
+static char opAt(const std::string_view op, const size_t i) {
+  return i < op.size() ? op[i] : '\0';
+}
+
+// Reads up to n components of a vector; missing ones stay zero.
+static Vec3 parseVec3(std::string_view& line, const unsigned n) {
+  Vec3 vec;
+  for (auto i = 0U; i < n; ++i) {
+    const auto token = nextToken(line);
+    if (token.empty()) {
+      break;
+    }
+    vec[i] = parseNumber<float>(token);
   }
-  std::string line;
+  return vec;
+}
+
+// Texture paths are resolved against the library's directory and appended to
+// textures unless already there.
+static auto loadMtl(const std::filesystem::path& path,
+                    std::vector<Material>& materials,
+                    std::vector<std::string>& textures) {
+  std::unordered_map<std::string, uint32_t> matIndexMap;
+  const MappedFile file(path);
+  auto text = file.contents();
   Material* material = nullptr;
-  while (std::getline(file, line)) {
-    std::istringstream lineStream(line);
-    std::string op;
-    if (!(lineStream >> op)) {
+  const auto current = [&material]() -> Material& {
+    if (!material) {
+      throw std::runtime_error("No current material!");
+    }
+    return *material;
+  };
+  while (!text.empty()) {
+    auto line = nextLine(text);
+    const auto op = nextToken(line);
+    if (op.empty()) {
       continue;
     }
     switch (op[0]) {
       case '#':
         break;
       case 'n': {
-        std::string matName;
-        lineStream >> matName;
+        const std::string matName(nextToken(line));
         if (matIndexMap.find(matName) != matIndexMap.end()) {
           throw std::runtime_error("Duplicate material name");
         }
@@ -58,63 +95,50 @@ static auto loadMtl(const std::string& path, std::vector<Material>& materials) {
       } break;
       case 'T':
       case 'K': {
-        if (!material) {
-          throw std::runtime_error("No current material!");
-        }
-        Vec3 value;
-        lineStream >> value->x >> value->y >> value->z;
-        switch (op[1]) {
+        auto& target = current();
+        const auto value = parseVec3(line, 3);
+        switch (opAt(op, 1)) {
           case 'a':
-            material->ambient = value;
+            target.ambient = value;
             break;
           case 'd':
-            material->diffuse = value;
+            target.diffuse = value;
             break;
           case 's':
-            material->specular = value;
+            target.specular = value;
             break;
           case 'e':
-            material->emittance = value;
+            target.emittance = value;
             break;
           case 'f':
-            material->transmission = value;
+            target.transmission = value;
             break;
           default:
             break;
         }
       } break;
       case 'd': {
-        if (!material) {
-          throw std::runtime_error("No current material!");
-        }
-        std::string next;
-        lineStream >> next;
-        float dissolve;
+        auto& target = current();
+        auto next = nextToken(line);
         if (next == "-halo") {
-          lineStream >> dissolve;
-        } else {
-          dissolve = std::stof(next);
+          next = nextToken(line);
         }
-        material->dissolve = dissolve;
+        target.dissolve = parseNumber<float>(next);
       } break;
       case 'i': {
-        if (!material) {
-          throw std::runtime_error("No current material!");
-        }
-        int illum;
-        lineStream >> illum;
-        switch (illum) {
+        auto& target = current();
+        switch (parseNumber<int>(nextToken(line))) {
           case 0:
           case 1:
-            material->illuminationModel = Material::DIFFUSE;
+            target.illuminationModel = Material::DIFFUSE;
             break;
           case 2:
-            material->illuminationModel =
+            target.illuminationModel =
                 static_cast<Material::IlluminationModel>(Material::DIFFUSE |
                                                          Material::SPECULAR);
             break;
           case 5:
-            material->illuminationModel =
+            target.illuminationModel =
                 static_cast<Material::IlluminationModel>(Material::DIFFUSE |
                                                          Material::SPECULAR |
                                                          Material::REFLECTION);
@@ -123,22 +147,37 @@ static auto loadMtl(const std::string& path, std::vector<Material>& materials) {
             break;
         }
       } break;
+      case 'm': {
+        if (op != "map_Kd") {
+          break;
+        }
+        auto& target = current();
+        // Options such as "-bm 1" come first; the file name is last.
+        std::string_view name;
+        for (auto token = nextToken(line); !token.empty();
+             token = nextToken(line)) {
+          name = token;
+        }
+        const auto texture = (path.parent_path() / name).string();
+        const auto found = std::find(textures.begin(), textures.end(), texture);
+        target.diffuseTexture = found - textures.begin();
+        if (found == textures.end()) {
+          textures.push_back(texture);
+        }
+      } break;
       case 's':
       case 'N': {
-        if (!material) {
-          throw std::runtime_error("No current material!");
-        }
-        float value;
-        lineStream >> value;
-        switch (op[1]) {
+        auto& target = current();
+        const auto value = parseNumber<float>(nextToken(line));
+        switch (opAt(op, 1)) {
           case 's':
-            material->specularExponent = value;
+            target.specularExponent = value;
             break;
           case 'i':
-            material->refractionIndex = value;
+            target.refractionIndex = value;
             break;
           case 'h':
-            material->sharpness = value;
+            target.sharpness = value;
             break;
           default:
             break;
@@ -151,141 +190,373 @@ static auto loadMtl(const std::string& path, std::vector<Material>& materials) {
   return matIndexMap;
 }
 
-static auto loadObj(const std::string& path) {
-  std::vector<Vec3> vectors[3];
-  std::vector<Obj::face_indices_t> faces;
-  std::vector<Material> materials;
-  std::unordered_map<std::string, uint32_t> matIndexMap;
-  std::vector<light_t> lights;
+// One face corner as written in the file. Relative (negative) indices are
+// stored relative to the chunk start and flagged, since the chunk does not
+// know how many vectors come before it.
+struct Corner {
+  std::array<int32_t, 3> index{kMissing, kMissing, kMissing};
+  uint8_t relative = 0;
+};
 
-  // Fallback material.
-  materials.emplace_back();
+// mtllib and usemtl lines, replayed in file order once all chunks are parsed.
+struct Directive {
+  bool library;
+  std::string name;
+};
+
+// Material and light faces use, as of some point in the file.
+struct MaterialState {
   uint32_t material = 0;
-  bool light = false;
+  // Index into the lights, or -1 when the material does not emit.
+  int32_t light = -1;
+};
 
-  std::ifstream file(path);
-  const std::filesystem::path fsPath(path);
-  if (!file.is_open()) {
-    throw std::runtime_error("Failed to open file");
+struct ChunkFace {
+  uint32_t firstCorner;
+  uint32_t numCorners;
+  // The chunk's last usemtl before the face, or -1 to use the state the
+  // previous chunk ended with.
+  int32_t directive;
+};
+
+struct Chunk {
+  std::vector<Vec3> vectors[3];
+  std::vector<Corner> corners;
+  std::vector<ChunkFace> faces;
+  std::vector<Directive> directives;
+  int32_t lastUse = -1;
+  size_t numTriangles = 0;
+  size_t numGeneratedNormals = 0;
+
+  // Filled in between parsing and fixing up.
+  MaterialState start;
+  std::vector<MaterialState> states;
+  size_t base[3];
+  size_t triangleBase;
+  size_t generatedNormalBase;
+};
+
+static void parseFace(std::string_view line, Chunk& chunk) {
+  ChunkFace face{static_cast<uint32_t>(chunk.corners.size()), 0,
+                 chunk.lastUse};
+  for (auto token = nextToken(line); !token.empty(); token = nextToken(line)) {
+    auto& corner = chunk.corners.emplace_back();
+    for (auto idx = 0U; idx < 3 && !token.empty(); ++idx) {
+      const auto slash = token.find('/');
+      const auto component = token.substr(0, slash);
+      token.remove_prefix(slash == std::string_view::npos ? token.size()
+                                                          : slash + 1);
+      if (component.empty()) {
+        continue;
+      }
+      const auto value = parseNumber<int32_t>(component);
+      if (value == 0) {
+        throw std::out_of_range("Face index out-of-range!");
+      } else if (value < 0) {
+        corner.index[idx] = chunk.vectors[idx].size() + value;
+        corner.relative |= 1 << idx;
+      } else {
+        corner.index[idx] = value - 1;
+      }
+    }
+    ++face.numCorners;
+  }
+  if (face.numCorners < 3) {
+    throw std::length_error("A face must have at least 3 vertices!");
+  }
+  // Faces are fanned around their first corner; each triangle missing a
+  // normal gets a flat one.
+  const auto* corners = &chunk.corners[face.firstCorner];
+  for (auto i = 1U; i + 1 < face.numCorners; ++i) {
+    if (corners[0].index[NORMAL] == kMissing ||
+        corners[i].index[NORMAL] == kMissing ||
+        corners[i + 1].index[NORMAL] == kMissing) {
+      ++chunk.numGeneratedNormals;
+    }
   }
-  std::string line;
-  while (std::getline(file, line)) {
-    std::istringstream lineStream(line);
-    std::string op;
-    if (!(lineStream >> op)) {
+  chunk.numTriangles += face.numCorners - 2;
+  chunk.faces.push_back(face);
+}
+
+static void parseChunk(std::string_view text, Chunk& chunk) {
+  while (!text.empty()) {
+    auto line = nextLine(text);
+    const auto op = nextToken(line);
+    if (op.empty()) {
       continue;
     }
     switch (op[0]) {
-      case '#':
-        break;
-      case 'v': {
-        Vec3 vec;
-        lineStream >> vec->x >> vec->y;
+      case 'v':
         if (op.size() == 1) {
-          lineStream >> vec->z;
-          vectors[VERTEX].push_back(vec);
+          chunk.vectors[VERTEX].push_back(parseVec3(line, 3));
         } else if (op[1] == 'n') {
-          lineStream >> vec->z;
-          vectors[NORMAL].push_back(vec.normalize());
+          chunk.vectors[NORMAL].push_back(parseVec3(line, 3).normalize());
         } else if (op[1] == 't') {
-          vectors[TEXCOORD].push_back(vec);
+          chunk.vectors[TEXCOORD].push_back(parseVec3(line, 2));
         }
-      } break;
-      case 'f': {
-        auto& face = faces.emplace_back();
-        face.second = material;
-        std::string v;
-        while (lineStream >> v) {
-          std::istringstream vertexStream(v);
-          size_t idx = 0;
-          std::string component;
-          auto& vertex = *face.first.insert(face.first.cend(), {-1, -1, -1});
-          while (std::getline(vertexStream, component, '/')) {
-            if (!component.empty()) {
-              int value = std::stoi(component);
-              if (value < 0) {
-                value = vectors[idx].size() + value;
-              } else {
-                --value;
-              }
-              if (value < 0 || value >= vectors[idx].size()) {
-                throw std::out_of_range("Face index out-of-range!");
-              }
-              vertex[idx] = value;
-              if (idx == VERTEX && light) {
-                lights.back().first.add(vectors[idx][value]);
-              }
-            }
-            ++idx;
-          }
-        }
-      } break;
-      case 'm': {
-        std::string mtl;
-        lineStream >> mtl;
-        matIndexMap = loadMtl(fsPath.parent_path() / mtl, materials);
-      } break;
-      case 'u': {
-        std::string mtl;
-        lineStream >> mtl;
-        material =
-            matIndexMap.find(mtl) != matIndexMap.end() ? matIndexMap[mtl] : 0;
-        light = materials[material].light();
-        if (light) {
-          lights.emplace_back(BoundingBox(), material);
-        }
-      } break;
+        break;
+      case 'f':
+        parseFace(line, chunk);
+        break;
+      case 'm':
+        chunk.directives.push_back({true, std::string(nextToken(line))});
+        break;
+      case 'u':
+        chunk.directives.push_back({false, std::string(nextToken(line))});
+        chunk.lastUse = chunk.directives.size() - 1;
+        break;
       default:
         break;
     }
   }
-  return std::make_tuple(vectors[VERTEX], vectors[TEXCOORD], vectors[NORMAL],
-                         materials, faces, lights);
 }
 
-static std::unique_ptr<Scene> createScene(
-    std::vector<Vec3> vertices, std::vector<Vec3> texcoords,
-    std::vector<Vec3> normals, std::vector<Material> materials,
-    std::vector<Obj::face_indices_t> faces, std::vector<light_t> lights) {
-  std::vector<triangle_indices_t> triangles;
-  for (auto& face : faces) {
-    if (face.first.size() < 3) {
-      throw std::length_error("A face must have at least 3 vertices!");
-    } else {
-      const auto& v0 = vertices[face.first[0][VERTEX]];
-      for (auto i = 1; i < face.first.size() - 1; ++i) {
-        if (face.first[0][NORMAL] < 0 || face.first[i][NORMAL] < 0 ||
-            face.first[i + 1][NORMAL] < 0) {
-          const auto& vi = vertices[face.first[i][VERTEX]];
-          const auto& vi1 = vertices[face.first[i + 1][VERTEX]];
-          normals.emplace_back((vi - v0).cross(vi1 - v0).normalize());
-          face.first[0][NORMAL] = face.first[i][NORMAL] =
-              face.first[i + 1][NORMAL] = normals.size() - 1;
+// Splits text into about n pieces that end on line boundaries.
+static std::vector<std::string_view> split(const std::string_view text,
+                                           const size_t n) {
+  std::vector<std::string_view> pieces;
+  size_t begin = 0;
+  for (auto i = 1UL; i <= n && begin < text.size(); ++i) {
+    auto end = std::max(begin, text.size() * i / n);
+    if (end < text.size()) {
+      const auto newline = text.find('\n', end);
+      end = newline == std::string_view::npos ? text.size() : newline + 1;
+    }
+    pieces.push_back(text.substr(begin, end - begin));
+    begin = end;
+  }
+  return pieces;
+}
+
+// Async::submitN that passes on the first exception a task throws, instead
+// of losing it on a pool thread.
+static void parallelFor(const std::function<void(unsigned)>& function,
+                        const unsigned n) {
+  if (n == 0) {
+    return;
+  }
+  std::vector<std::exception_ptr> errors(n);
+  Async::submitN(
+      [&function, &errors](const unsigned i) {
+        try {
+          function(i);
+        } catch (...) {
+          errors[i] = std::current_exception();
         }
-        triangles.push_back(
-            {{face.first[0], face.first[i], face.first[i + 1]}, face.second});
+      },
+      n);
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Resolves a corner to absolute indices, -1 for a missing texcoord or normal.
+static std::array<int32_t, 3> resolve(const Corner& corner, const Chunk& chunk,
+                                      const size_t (&counts)[3]) {
+  std::array<int32_t, 3> resolved{-1, -1, -1};
+  for (auto idx = 0U; idx < 3; ++idx) {
+    if (corner.index[idx] == kMissing) {
+      if (idx == VERTEX) {
+        throw std::out_of_range("Face index out-of-range!");
       }
+      continue;
     }
+    const int64_t value = (corner.relative & (1 << idx))
+                              ? int64_t(chunk.base[idx]) + corner.index[idx]
+                              : corner.index[idx];
+    if (value < 0 || value >= int64_t(counts[idx])) {
+      throw std::out_of_range("Face index out-of-range!");
+    }
+    resolved[idx] = value;
   }
-  return std::make_unique<Scene>(std::move(vertices), std::move(texcoords),
-                                 std::move(normals), std::move(materials),
-                                 std::move(triangles), std::move(lights));
+  return resolved;
+}
+
+static auto loadObj(const std::string& path) {
+  const MappedFile file(path);
+  const auto maxChunks = std::max(1U, std::thread::hardware_concurrency()) * 4;
+  const auto pieces = split(
+      file.contents(),
+      std::clamp<size_t>(file.contents().size() / kMinChunkSize, 1, maxChunks));
+  std::vector<Chunk> chunks(pieces.size());
+  parallelFor([&](const unsigned i) { parseChunk(pieces[i], chunks[i]); },
+              chunks.size());
+
+  // Replay the material directives in file order; this loads the libraries
+  // and tells each chunk which material its faces start with.
+  std::vector<Material> materials;
+  // Fallback material.
+  materials.emplace_back();
+  std::unordered_map<std::string, uint32_t> matIndexMap;
+  std::vector<std::string> textures;
+  std::vector<light_t> lights;
+  const std::filesystem::path fsPath(path);
+  MaterialState state;
+  for (auto& chunk : chunks) {
+    chunk.start = state;
+    for (const auto& directive : chunk.directives) {
+      if (directive.library) {
+        matIndexMap = loadMtl(fsPath.parent_path() / directive.name,
+                              materials, textures);
+      } else {
+        const auto found = matIndexMap.find(directive.name);
+        state.material = found != matIndexMap.end() ? found->second : 0;
+        state.light = -1;
+        if (materials[state.material].light()) {
+          lights.emplace_back(BoundingBox(), state.material);
+          state.light = lights.size() - 1;
+        }
+      }
+      chunk.states.push_back(state);
+    }
+  }
+
+  size_t counts[3] = {};
+  size_t numTriangles = 0;
+  for (auto& chunk : chunks) {
+    for (auto idx = 0U; idx < 3; ++idx) {
+      chunk.base[idx] = counts[idx];
+      counts[idx] += chunk.vectors[idx].size();
+    }
+    chunk.triangleBase = numTriangles;
+    numTriangles += chunk.numTriangles;
+  }
+  // Generated normals go after all the parsed ones.
+  auto numNormals = counts[NORMAL];
+  for (auto& chunk : chunks) {
+    chunk.generatedNormalBase = numNormals;
+    numNormals += chunk.numGeneratedNormals;
+  }
+
+  std::vector<Vec3> vectors[3];
+  vectors[VERTEX].resize(counts[VERTEX]);
+  vectors[TEXCOORD].resize(counts[TEXCOORD]);
+  vectors[NORMAL].resize(numNormals);
+  parallelFor(
+      [&](const unsigned i) {
+        for (auto idx = 0U; idx < 3; ++idx) {
+          auto& source = chunks[i].vectors[idx];
+          std::copy(source.begin(), source.end(),
+                    vectors[idx].begin() + chunks[i].base[idx]);
+          source = {};
+        }
+      },
+      chunks.size());
+
+  std::vector<triangle_indices_t> triangles(numTriangles);
+  // Light bounds per chunk, merged below.
+  std::vector<std::unordered_map<int32_t, BoundingBox>> lightBounds(
+      chunks.size());
+  parallelFor(
+      [&](const unsigned i) {
+        const auto& chunk = chunks[i];
+        auto* triangle = &triangles[chunk.triangleBase];
+        auto generatedNormal = chunk.generatedNormalBase;
+        for (const auto& face : chunk.faces) {
+          const auto& faceState =
+              face.directive < 0 ? chunk.start : chunk.states[face.directive];
+          const auto* corners = &chunk.corners[face.firstCorner];
+          const auto first = resolve(corners[0], chunk, counts);
+          auto previous = resolve(corners[1], chunk, counts);
+          auto* bounds = faceState.light >= 0
+                             ? &lightBounds[i][faceState.light]
+                             : nullptr;
+          if (bounds) {
+            bounds->add(vectors[VERTEX][first[VERTEX]]);
+            bounds->add(vectors[VERTEX][previous[VERTEX]]);
+          }
+          for (auto j = 2U; j < face.numCorners; ++j) {
+            const auto next = resolve(corners[j], chunk, counts);
+            if (bounds) {
+              bounds->add(vectors[VERTEX][next[VERTEX]]);
+            }
+            triangle->first = {first, previous, next};
+            triangle->second = faceState.material;
+            auto& triangleCorners = triangle->first;
+            if (first[NORMAL] < 0 || previous[NORMAL] < 0 || next[NORMAL] < 0) {
+              const auto& v0 = vectors[VERTEX][first[VERTEX]];
+              const auto& v1 = vectors[VERTEX][previous[VERTEX]];
+              const auto& v2 = vectors[VERTEX][next[VERTEX]];
+              vectors[NORMAL][generatedNormal] =
+                  (v1 - v0).cross(v2 - v0).normalize();
+              for (auto& corner : triangleCorners) {
+                corner[NORMAL] = generatedNormal;
+              }
+              ++generatedNormal;
+            }
+            ++triangle;
+            previous = next;
+          }
+        }
+      },
+      chunks.size());
+  for (const auto& chunkBounds : lightBounds) {
+    for (const auto& [light, bounds] : chunkBounds) {
+      lights[light].first.add(bounds.min());
+      lights[light].first.add(bounds.max());
+    }
+  }
+  return std::make_tuple(std::move(vectors[VERTEX]),
+                         std::move(vectors[TEXCOORD]),
+                         std::move(vectors[NORMAL]), std::move(materials),
+                         std::move(textures), std::move(triangles),
+                         std::move(lights));
 }
 }  // namespace
 
 Obj::Obj(const std::string& path) {
-  std::tie(vertices_, texcoords_, normals_, materials_, faces_, lights_) =
-      loadObj(path);
+  std::tie(vertices_, texcoords_, normals_, materials_, textures_, triangles_,
+           lights_) = loadObj(path);
+}
+
+std::vector<std::filesystem::path> Obj::materialLibraries(
+    const std::string& path) {
+  constexpr std::string_view kMtllib = "mtllib";
+  const MappedFile file(path);
+  const auto contents = file.contents();
+  std::vector<std::filesystem::path> libraries;
+  for (auto pos = contents.find(kMtllib); pos != std::string_view::npos;
+       pos = contents.find(kMtllib, pos + 1)) {
+    if (pos > 0 && contents[pos - 1] != '\n') {
+      continue;
+    }
+    auto line = contents.substr(pos);
+    line = nextLine(line);
+    nextToken(line);
+    libraries.push_back(std::filesystem::path(path).parent_path() /
+                        nextToken(line));
+  }
+  return libraries;
+}
+
+std::vector<Material> Obj::loadMaterials(
+    const std::vector<std::filesystem::path>& libraries,
+    std::vector<std::string>& textures) {
+  // Fallback material, as in loadObj().
+  std::vector<Material> materials(1);
+  for (const auto& library : libraries) {
+    loadMtl(library, materials, textures);
+  }
+  return materials;
 }
 
-std::unique_ptr<Scene> Obj::toScene() const& {
-  return createScene(vertices_, texcoords_, normals_, materials_, faces_,
-                     lights_);
+std::unique_ptr<Scene> Obj::toScene(const MeshOptions& meshOptions) const& {
+  return std::make_unique<Scene>(vertices_, texcoords_, normals_, materials_,
+                                 textures_, triangles_, lights_, meshOptions);
 }
 
-std::unique_ptr<Scene> Obj::moveToScene() && {
-  return createScene(std::move(vertices_), std::move(texcoords_),
-                     std::move(normals_), std::move(materials_),
-                     std::move(faces_), std::move(lights_));
+std::unique_ptr<Scene> Obj::moveToScene(const MeshOptions& meshOptions) && {
+  auto scene = std::make_unique<Scene>(vertices_, texcoords_, normals_,
+                                       std::move(materials_), textures_,
+                                       triangles_, lights_, meshOptions);
+  // The scene keeps its own compact copy of everything.
+  vertices_ = {};
+  texcoords_ = {};
+  normals_ = {};
+  triangles_ = {};
+  lights_ = {};
+  return scene;
 }
 }  // namespace tinyrt
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <vector>
@@ -36,21 +37,32 @@ class Obj final {
   Obj(const Obj&) = delete;
   Obj& operator=(const Obj&) = delete;
 
-  std::unique_ptr<Scene> toScene() const&;
-  std::unique_ptr<Scene> moveToScene() &&;
+  std::unique_ptr<Scene> toScene(const MeshOptions& meshOptions = {}) const&;
+  std::unique_ptr<Scene> moveToScene(const MeshOptions& meshOptions = {}) &&;
 
-  friend std::ostream& operator<<(std::ostream& os, const Obj& obj);
+  // The material libraries the OBJ file at path loads, in order, e.g. to
+  // watch them for edits.
+  static std::vector<std::filesystem::path> materialLibraries(
+      const std::string& path);
+  // The materials that an OBJ file loading libraries gets, numbered as in
+  // its Scene, e.g. for Scene::replaceMaterials(). The texture files they
+  // index go to textures.
+  static std::vector<Material> loadMaterials(
+      const std::vector<std::filesystem::path>& libraries,
+      std::vector<std::string>& textures);
 
- public:
-  using face_indices_t =
-      std::pair<std::vector<std::array<int32_t, 3>>, uint32_t>;
+  friend std::ostream& operator<<(std::ostream& os, const Obj& obj);
 
  private:
   std::vector<Vec3> vertices_;
   std::vector<Vec3> texcoords_;
+  // Includes flat normals generated for faces that have none.
   std::vector<Vec3> normals_;
   std::vector<Material> materials_;
-  std::vector<face_indices_t> faces_;
+  // Texture file paths, indexed by Material::diffuseTexture.
+  std::vector<std::string> textures_;
+  // Faces fanned into triangles.
+  std::vector<triangle_indices_t> triangles_;
   std::vector<light_t> lights_;
 };
 }  // namespace tinyrt
@@ -22,24 +22,53 @@
 
 #include "core/path_tracer.h"
 
-#include <random>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#include "core/phong_shader.h"
+#include "core/render.h"
+#include "core/sampling.h"
+#include "core/simd_kdtree_intersecter.h"
+#include "core/simd_phong_shader.h"
 
 namespace tinyrt {
 namespace {
 static constexpr auto kMaxDepth = 5U;
 
-static Vec3 cosineSampledHemisphere(const Vec3& nx, const Vec3& ny,
-                                    const Vec3& nz) {
-  static thread_local std::mt19937 generator(std::random_device{}());
-  std::uniform_real_distribution gen(0.f, 1.f);
-  const float u1 = gen(generator);
-  const float u2 = gen(generator);
+// The SIMD type of a pipeline: that of its intersecter, which the renderer
+// was picked for, or Vec3 for scalar ones.
+template <typename TIntersecter>
+struct PipelineVec3 {
+  using type = Vec3;
+};
+
+template <typename TVec3>
+struct PipelineVec3<SimdKdTreeIntersecter<TVec3>> {
+  using type = TVec3;
+};
+
+// The first hit of raySampler's next primary ray, from the sampler itself
+// if it knows it already, e.g. RasterSampler, or else traced.
+template <typename TRaySampler, typename TIntersecter>
+static std::optional<Intersection> primaryHit(const TRaySampler& raySampler,
+                                              const TIntersecter& intersecter,
+                                              const Scene& scene) {
+  if constexpr (requires { raySampler.hit(scene); }) {
+    return raySampler.hit(scene);
+  } else {
+    return intersecter.intersect(raySampler());
+  }
+}
+
+static Vec3 cosineSampledHemisphere(Random& random) {
+  const float u1 = random.uniform();
+  const float u2 = random.uniform();
   const float r = ::sqrtf(u1);
   const float theta = 2 * M_PI * u2;
   const float x = r * ::cosf(theta);
   const float y = r * ::sinf(theta);
-  const Vec3 localSpaceVec(x, ::sqrtf(std::max(0.f, 1.f - u1)), y);
-  return nx * localSpaceVec->x + ny * localSpaceVec->y + nz * localSpaceVec->z;
+  return Vec3(x, ::sqrtf(std::max(0.f, 1.f - u1)), y);
 }
 
 static std::pair<Vec3, float> fresnel(const Vec3& incoming, Vec3 normal,
@@ -66,23 +95,94 @@ static std::pair<Vec3, float> fresnel(const Vec3& incoming, Vec3 normal,
 }
 }  // namespace
 
-Color PathTracer::trace(const RaySampler& raySampler,
+Color PathTracer::trace(const RaySampler& raySampler, Random& random,
                         const Intersecter& intersecter, const Scene& scene,
                         const Shader& shader,
                         const TraceOptions& options) const {
+  static thread_local Arena scratch;
+  const auto color = traceStatic(raySampler, random, intersecter, scene,
+                                 shader, options, scratch);
+  scratch.reset();
+  return color;
+}
+
+template <typename TRaySampler, typename TIntersecter, typename TShader>
+Color PathTracer::traceStatic(const TRaySampler& raySampler, Random& random,
+                              const TIntersecter& intersecter,
+                              const Scene& scene, const TShader& shader,
+                              const TraceOptions& options,
+                              Arena& scratch) const {
   if (options.directRays == 0) {
     return Color();
   }
-  Color illumination;
-  for (auto i = 0U; i < options.directRays; ++i) {
-    illumination +=
-        traceInternal(raySampler(), intersecter, scene, shader, options, 0);
+  // Primary hits of all samples are shaded and sampled in batches, binned by
+  // material kernel; deeper bounces handle one hit at a time.
+  // The shader interface takes vectors, so those two stay thread_local.
+  static thread_local ShadingBatch batch;
+  static thread_local std::vector<Color> localIlluminations;
+  const std::span intersections(
+      scratch.allocateArray<std::optional<Intersection>>(options.directRays),
+      options.directRays);
+  std::array<unsigned, Material::kNumKernels + 1> bins{};
+  for (auto& intersection : intersections) {
+    intersection = primaryHit(raySampler, intersecter, scene);
+    if (intersection) {
+      touch(options, scene, *intersection);
+      ++bins[static_cast<unsigned>(intersection->material->kernel) + 1];
+    }
+  }
+  for (auto kernel = 0U; kernel < Material::kNumKernels; ++kernel) {
+    bins[kernel + 1] += bins[kernel];
+  }
+  const auto numHits = bins.back();
+  batch.clear();
+  for (auto kernel = 0U; kernel < Material::kNumKernels; ++kernel) {
+    for (const auto& intersection : intersections) {
+      if (intersection &&
+          static_cast<unsigned>(intersection->material->kernel) == kernel) {
+        batch.add(*intersection);
+      }
+    }
+  }
+  shader.shadeBatch(batch, scene.lights(), localIlluminations);
+
+  using vec3_t = typename PipelineVec3<TIntersecter>::type;
+  const auto lightStride = numHits * options.shadowRays;
+  auto* lightSamples =
+      scratch.allocateArray<Vec3>(lightStride * scene.lights().size());
+  for (auto j = 0U; j < scene.lights().size(); ++j) {
+    sampleBox<vec3_t>(random, random.reserve(lightStride), lightStride,
+                      scene.lights()[j]->aabb, lightSamples + j * lightStride);
+  }
+  const auto hemisphereCount = numHits * options.indirectRays;
+  auto* hemisphereSamples = scratch.allocateArray<Vec3>(hemisphereCount);
+  sampleHemisphere<vec3_t>(random, random.reserve(hemisphereCount),
+                           hemisphereCount, hemisphereSamples);
+
+  Color illumination = options.background * (options.directRays - numHits);
+  for (auto kernel = 0U; kernel < Material::kNumKernels; ++kernel) {
+    dispatchKernel(static_cast<Material::Kernel>(kernel), [&](auto k) {
+      for (auto h = bins[kernel]; h < bins[kernel + 1]; ++h) {
+        const Batched batched{
+            .localIlluminations =
+                localIlluminations.data() + h * scene.lights().size(),
+            .lightSamples = lightSamples + h * options.shadowRays,
+            .lightStride = lightStride,
+            .hemisphereSamples = hemisphereSamples + h * options.indirectRays,
+        };
+        illumination += shadeInternal<decltype(k)::value>(
+            batch[h].ray, batch[h], &batched, random, intersecter, scene,
+            shader, options, 0);
+      }
+    });
   }
   return illumination / options.directRays;
 }
 
-Color PathTracer::traceInternal(const Ray& ray, const Intersecter& intersecter,
-                                const Scene& scene, const Shader& shader,
+template <typename TIntersecter, typename TShader>
+Color PathTracer::traceInternal(const Ray& ray, Random& random,
+                                const TIntersecter& intersecter,
+                                const Scene& scene, const TShader& shader,
                                 const TraceOptions& options,
                                 unsigned depth) const {
   if (depth >= kMaxDepth) {
@@ -92,20 +192,55 @@ Color PathTracer::traceInternal(const Ray& ray, const Intersecter& intersecter,
   if (!intersection) {
     return options.background;
   }
+  touch(options, scene, *intersection);
+  return dispatchKernel(intersection->material->kernel, [&](auto kernel) {
+    return shadeInternal<decltype(kernel)::value>(ray, *intersection, nullptr,
+                                                  random, intersecter, scene,
+                                                  shader, options, depth);
+  });
+}
+
+template <Material::Kernel kKernel, typename TIntersecter, typename TShader>
+Color PathTracer::shadeInternal(const Ray& ray,
+                                const Intersection& intersection,
+                                const Batched* batched, Random& random,
+                                const TIntersecter& intersecter,
+                                const Scene& scene, const TShader& shader,
+                                const TraceOptions& options,
+                                unsigned depth) const {
+  // The branches below that depend only on kKernel fold away; see
+  // Material::selectKernel for what each kernel guarantees.
+  const auto* material = intersection.material;
   const auto nextRayOrigin =
-      intersection->position + intersection->normal() * 1e-4f;
+      intersection.position + intersection.normal() * 1e-4f;
 
   Color directIllumination;
-  for (const auto& light : scene.lights()) {
-    Vec3 localIllumination = shader.shade(*intersection, *light);
+  for (auto j = 0U; j < scene.lights().size(); ++j) {
+    const auto& light = scene.lights()[j];
+    Vec3 localIllumination;
+    if (batched) {
+      localIllumination = batched->localIlluminations[j];
+    } else if constexpr (std::is_base_of_v<PhongShader, TShader>) {
+      localIllumination = shader.template shadeKernel<kKernel>(intersection,
+                                                               *light);
+    } else {
+      localIllumination = shader.shade(intersection, *light);
+    }
     const unsigned shadowSamples = options.shadowRays;
-    if (shadowSamples > 0 && !intersection->material->light() &&
+    if (kKernel != Material::Kernel::EMISSIVE && shadowSamples > 0 &&
+        (kKernel != Material::Kernel::GLASS || !material->light()) &&
         !localIllumination.zero()) {
       unsigned occlusion = 0U;
       for (auto i = 0U; i < shadowSamples; ++i) {
-        const auto lightVec = light->aabb.random() - intersection->position;
+        const auto lightVec =
+            (batched ? batched->lightSamples[j * batched->lightStride + i]
+                     : light->aabb.random(random)) -
+            intersection.position;
         const Ray shadowRay(nextRayOrigin, lightVec);
         const auto shadowCheck = intersecter.intersect(shadowRay);
+        if (shadowCheck) {
+          touch(options, scene, *shadowCheck);
+        }
         if (shadowCheck && shadowCheck->time < lightVec.norm() - 1e-3f) {
           occlusion++;
         }
@@ -116,54 +251,141 @@ Color PathTracer::traceInternal(const Ray& ray, const Intersecter& intersecter,
   }
 
   Color refractedIllumination;
-  Vec3 reflectance = intersection->material->specular;
-  if (intersection->material->illuminationModel & Material::REFRACTION) {
-    const auto fres = fresnel(ray.direction, intersection->normal(),
-                              intersection->material->refractionIndex);
+  Vec3 reflectance = material->specular;
+  if (kKernel == Material::Kernel::GLASS &&
+      (material->illuminationModel & Material::REFRACTION)) {
+    const auto fres = fresnel(ray.direction, intersection.normal(),
+                              material->refractionIndex);
     reflectance = Vec3(fres.second, fres.second, fres.second);
     if (fres.second < 1) {
       const Ray refractedRay(
-          intersection->normal().dot(ray.direction) > 0
+          intersection.normal().dot(ray.direction) > 0
               ? nextRayOrigin
-              : intersection->position - intersection->normal() * 1e-4f,
-          fres.first);
-      refractedIllumination = traceInternal(refractedRay, intersecter, scene,
-                                            shader, options, depth + 1) *
+              : intersection.position - intersection.normal() * 1e-4f,
+          fres.first, ray.coneWidthAt(intersection.time), ray.coneSpread);
+      refractedIllumination = traceInternal(refractedRay, random, intersecter,
+                                            scene, shader, options, depth + 1) *
                               (1.f - fres.second);
     }
   }
 
   Color reflectedIllumination;
-  if ((intersection->material->illuminationModel & Material::REFLECTION) &&
+  if (kKernel >= Material::Kernel::MIRROR &&
+      (material->illuminationModel & Material::REFLECTION) &&
       !reflectance.small()) {
     const Ray reflectedRay(nextRayOrigin,
-                           -ray.direction.reflect(intersection->normal()));
-    reflectedIllumination = traceInternal(reflectedRay, intersecter, scene,
-                                          shader, options, depth + 1) *
+                           -ray.direction.reflect(intersection.normal()),
+                           ray.coneWidthAt(intersection.time), ray.coneSpread);
+    reflectedIllumination = traceInternal(reflectedRay, random, intersecter,
+                                          scene, shader, options, depth + 1) *
                             reflectance;
   }
 
   Color indirectIllumination;
-  if (options.indirectRays > 0 && !intersection->material->diffuse.small()) {
-    const auto basis = intersection->normal().basis();
+  if (options.indirectRays > 0 &&
+      (kKernel == Material::Kernel::DIFFUSE ||
+       kKernel == Material::Kernel::GLOSSY || !material->diffuse.small())) {
+    const auto basis = intersection.normal().basis();
     auto indirectOptions = options;
     indirectOptions.indirectRays = options.indirectRays;  // / 2;
     indirectOptions.shadowRays = 1;
+    // Each cosine-sampled bounce stands for its share of the hemisphere,
+    // 2 pi / indirectRays steradians, so its cone widens about as much. The
+    // pixel-sized cone that mirrors and refraction keep would read textures
+    // at full resolution from every bounce.
+    const auto indirectSpread = std::max(
+        ray.coneSpread, 2.f * std::sqrt(2.f / options.indirectRays));
 
     for (auto i = 0U; i < options.indirectRays; ++i) {
-      Ray indirectRay(nextRayOrigin, cosineSampledHemisphere(
-                                         std::get<0>(basis), std::get<1>(basis),
-                                         std::get<2>(basis)));
+      const auto local = batched ? batched->hemisphereSamples[i]
+                                 : cosineSampledHemisphere(random);
+      Ray indirectRay(nextRayOrigin,
+                      std::get<0>(basis) * local->x +
+                          std::get<1>(basis) * local->y +
+                          std::get<2>(basis) * local->z,
+                      ray.coneWidthAt(intersection.time), indirectSpread);
       indirectIllumination +=
-          traceInternal(indirectRay, intersecter, scene, shader,
+          traceInternal(indirectRay, random, intersecter, scene, shader,
                         indirectOptions, depth + 1) *
-          indirectRay.direction.dot(intersection->normal());
+          indirectRay.direction.dot(intersection.normal());
     }
-    const Color brdf = intersection->material->diffuse;
+    const Color brdf = intersection.diffuse();
     indirectIllumination =
         indirectIllumination * brdf * 2.f / options.indirectRays;
   }
   return directIllumination / M_PI + reflectedIllumination +
          refractedIllumination + indirectIllumination;
 }
+
+/* explicit */ template Color
+PathTracer::traceStatic<PixelSampler, KdTreeIntersecter, PhongShader>(
+    const PixelSampler& raySampler, Random& random,
+    const KdTreeIntersecter& intersecter, const Scene& scene,
+    const PhongShader& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color PathTracer::traceStatic<
+    PixelSampler, SimdKdTreeIntersecter<AVX2Vec3>, PhongShader>(
+    const PixelSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX2Vec3>& intersecter, const Scene& scene,
+    const PhongShader& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color PathTracer::traceStatic<
+    PixelSampler, SimdKdTreeIntersecter<AVX2Vec3>, SimdPhongShader<AVX2Vec3>>(
+    const PixelSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX2Vec3>& intersecter, const Scene& scene,
+    const SimdPhongShader<AVX2Vec3>& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color PathTracer::traceStatic<
+    PixelSampler, SimdKdTreeIntersecter<AVX512Vec3>, PhongShader>(
+    const PixelSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX512Vec3>& intersecter, const Scene& scene,
+    const PhongShader& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color
+PathTracer::traceStatic<PixelSampler, SimdKdTreeIntersecter<AVX512Vec3>,
+                        SimdPhongShader<AVX512Vec3>>(
+    const PixelSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX512Vec3>& intersecter, const Scene& scene,
+    const SimdPhongShader<AVX512Vec3>& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color
+PathTracer::traceStatic<RasterSampler, KdTreeIntersecter, PhongShader>(
+    const RasterSampler& raySampler, Random& random,
+    const KdTreeIntersecter& intersecter, const Scene& scene,
+    const PhongShader& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color PathTracer::traceStatic<
+    RasterSampler, SimdKdTreeIntersecter<AVX2Vec3>, PhongShader>(
+    const RasterSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX2Vec3>& intersecter, const Scene& scene,
+    const PhongShader& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color PathTracer::traceStatic<
+    RasterSampler, SimdKdTreeIntersecter<AVX2Vec3>, SimdPhongShader<AVX2Vec3>>(
+    const RasterSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX2Vec3>& intersecter, const Scene& scene,
+    const SimdPhongShader<AVX2Vec3>& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color PathTracer::traceStatic<
+    RasterSampler, SimdKdTreeIntersecter<AVX512Vec3>, PhongShader>(
+    const RasterSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX512Vec3>& intersecter, const Scene& scene,
+    const PhongShader& shader, const TraceOptions& options,
+    Arena& scratch) const;
+
+/* explicit */ template Color
+PathTracer::traceStatic<RasterSampler, SimdKdTreeIntersecter<AVX512Vec3>,
+                        SimdPhongShader<AVX512Vec3>>(
+    const RasterSampler& raySampler, Random& random,
+    const SimdKdTreeIntersecter<AVX512Vec3>& intersecter, const Scene& scene,
+    const SimdPhongShader<AVX512Vec3>& shader, const TraceOptions& options,
+    Arena& scratch) const;
 }  // namespace tinyrt
@@ -23,17 +23,52 @@
 #pragma once
 
 #include "core/tracer.h"
+#include "util/arena.h"
 
 namespace tinyrt {
 class PathTracer final : public Tracer {
  public:
-  Color trace(const RaySampler& raySampler, const Intersecter& intersecter,
-              const Scene& scene, const Shader& shader,
+  Color trace(const RaySampler& raySampler, Random& random,
+              const Intersecter& intersecter, const Scene& scene,
+              const Shader& shader,
               const TraceOptions& options) const override;
 
+  // trace() with the concrete sampler, intersecter and shader types known at
+  // compile time, so that the per-sample calls bind statically. Per-sample
+  // buffers come from scratch, which the caller resets when convenient, e.g.
+  // after each tile. Instantiated in path_tracer.cc for the pipelines in
+  // core/render.h.
+  template <typename TRaySampler, typename TIntersecter, typename TShader>
+  Color traceStatic(const TRaySampler& raySampler, Random& random,
+                    const TIntersecter& intersecter, const Scene& scene,
+                    const TShader& shader, const TraceOptions& options,
+                    Arena& scratch) const;
+
  private:
-  Color traceInternal(const Ray& ray, const Intersecter& intersecter,
-                      const Scene& scene, const Shader& shader,
-                      const TraceOptions& options, unsigned depth) const;
+  // Per-hit inputs that trace() computes in batch for primary hits.
+  struct Batched {
+    // Shader result per light.
+    const Color* localIlluminations;
+    // Shadow ray targets, shadowRays per light; light j starts at
+    // lightSamples[j * lightStride].
+    const Vec3* lightSamples;
+    size_t lightStride;
+    // Local-space indirect directions, indirectRays of them.
+    const Vec3* hemisphereSamples;
+  };
+
+  template <typename TIntersecter, typename TShader>
+  Color traceInternal(const Ray& ray, Random& random,
+                      const TIntersecter& intersecter, const Scene& scene,
+                      const TShader& shader, const TraceOptions& options,
+                      unsigned depth) const;
+  // Shades a hit whose material uses kKernel, taking inputs from batched
+  // when the caller has already computed them.
+  template <Material::Kernel kKernel, typename TIntersecter, typename TShader>
+  Color shadeInternal(const Ray& ray, const Intersection& intersection,
+                      const Batched* batched, Random& random,
+                      const TIntersecter& intersecter, const Scene& scene,
+                      const TShader& shader, const TraceOptions& options,
+                      unsigned depth) const;
 };
 }  // namespace tinyrt
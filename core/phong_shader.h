@@ -27,20 +27,35 @@
 namespace tinyrt {
 class PhongShader : public Shader {
  public:
+  // Final so that callers holding a PhongShader, including the SIMD
+  // variants, call it directly.
   Color shade(const Intersection& intersection,
-              const Light& light) const override {
+              const Light& light) const final {
+    return dispatchKernel(intersection.material->kernel, [&](auto kernel) {
+      return shadeKernel<decltype(kernel)::value>(intersection, light);
+    });
+  }
+
+  // shade() for a hit whose material uses kKernel.
+  template <Material::Kernel kKernel>
+  Color shadeKernel(const Intersection& intersection,
+                    const Light& light) const {
     const auto* material = intersection.material;
-    if (material->light()) {
+    if (kKernel == Material::Kernel::EMISSIVE ||
+        (kKernel == Material::Kernel::GLASS && material->light())) {
       return material->ambient * M_PI;
     }
     const auto l = (light.aabb.center() - intersection.position).normalize();
     Color lumination;
-    if (material->illuminationModel & Material::DIFFUSE) {
-      lumination += light.material.emittance * material->diffuse *
+    if (kKernel <= Material::Kernel::GLOSSY ||
+        (material->illuminationModel & Material::DIFFUSE)) {
+      lumination += light.material.emittance * intersection.diffuse() *
                     std::max(l.dot(intersection.normal()), 0.f);
     }
-    if ((material->illuminationModel & Material::SPECULAR) &&
-        !material->specular.small()) {
+    if (kKernel == Material::Kernel::GLOSSY ||
+        (kKernel >= Material::Kernel::MIRROR &&
+         (material->illuminationModel & Material::SPECULAR) &&
+         !material->specular.small())) {
       const auto r = l.reflect(intersection.normal());
       const auto v = -intersection.ray.direction;
       const auto base = r.dot(v);
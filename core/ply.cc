@@ -0,0 +1,335 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/ply.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#include "util/half.h"
+#include "util/text.h"
+
+namespace tinyrt {
+namespace {
+static_assert(std::endian::native == std::endian::little,
+              "Binary PLY records are read in place");
+
+using Type = Ply::Type;
+
+// What a vertex property feeds; the rest are skipped.
+enum Role { X, Y, Z, NX, NY, NZ, U, V, kNumRoles, NONE = kNumRoles };
+
+static Type parseType(const std::string_view name) {
+  static constexpr std::pair<std::string_view, Type> kTypes[] = {
+      {"char", Type::INT8},     {"int8", Type::INT8},
+      {"uchar", Type::UINT8},   {"uint8", Type::UINT8},
+      {"short", Type::INT16},   {"int16", Type::INT16},
+      {"ushort", Type::UINT16}, {"uint16", Type::UINT16},
+      {"int", Type::INT32},     {"int32", Type::INT32},
+      {"uint", Type::UINT32},   {"uint32", Type::UINT32},
+      {"float", Type::FLOAT},   {"float32", Type::FLOAT},
+      {"double", Type::DOUBLE}, {"float64", Type::DOUBLE},
+  };
+  for (const auto& [typeName, type] : kTypes) {
+    if (typeName == name) {
+      return type;
+    }
+  }
+  throw std::runtime_error("Unknown PLY property type: " + std::string(name));
+}
+
+static size_t sizeOf(const Type type) {
+  switch (type) {
+    case Type::INT8:
+    case Type::UINT8:
+      return 1;
+    case Type::INT16:
+    case Type::UINT16:
+      return 2;
+    case Type::INT32:
+    case Type::UINT32:
+    case Type::FLOAT:
+      return 4;
+    case Type::DOUBLE:
+      return 8;
+  }
+  return 0;
+}
+
+template <typename T>
+static T load(const char* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+static double read(const char* data, const Type type) {
+  switch (type) {
+    case Type::INT8:
+      return load<int8_t>(data);
+    case Type::UINT8:
+      return load<uint8_t>(data);
+    case Type::INT16:
+      return load<int16_t>(data);
+    case Type::UINT16:
+      return load<uint16_t>(data);
+    case Type::INT32:
+      return load<int32_t>(data);
+    case Type::UINT32:
+      return load<uint32_t>(data);
+    case Type::FLOAT:
+      return load<float>(data);
+    case Type::DOUBLE:
+      return load<double>(data);
+  }
+  return 0;
+}
+
+static Role roleOf(const std::string_view name) {
+  static constexpr std::pair<std::string_view, Role> kRoles[] = {
+      {"x", X},          {"y", Y},          {"z", Z},
+      {"nx", NX},        {"ny", NY},        {"nz", NZ},
+      {"u", U},          {"v", V},          {"s", U},
+      {"t", V},          {"texture_u", U},  {"texture_v", V},
+      {"texture_s", U},  {"texture_t", V},
+  };
+  for (const auto& [roleName, role] : kRoles) {
+    if (roleName == name) {
+      return role;
+    }
+  }
+  return NONE;
+}
+
+// Bounds checked cursor over the records.
+class Reader final {
+ public:
+  Reader(const std::string_view data, const size_t offset)
+      : data_(data), offset_(offset) {}
+
+  const char* take(const size_t size) {
+    if (size > data_.size() - offset_) {
+      throw std::runtime_error("Truncated PLY file");
+    }
+    const auto* data = data_.data() + offset_;
+    offset_ += size;
+    return data;
+  }
+
+  // count records of size bytes each. Counts come from the file, so one
+  // that cannot fit is refused before count * size can wrap around.
+  const char* take(const size_t count, const size_t size) {
+    if (size > 0 && count > (data_.size() - offset_) / size) {
+      throw std::runtime_error("Truncated PLY file");
+    }
+    return take(count * size);
+  }
+
+  double next(const Type type) { return read(take(sizeOf(type)), type); }
+
+  // The item count of a list property.
+  size_t count(const Type type) {
+    const auto value = next(type);
+    if (!(value >= 0 && value <= data_.size())) {
+      throw std::runtime_error("Bad PLY list count");
+    }
+    return static_cast<size_t>(value);
+  }
+
+  void skip(const Ply::Property& property) {
+    if (property.list) {
+      take(count(property.countType), sizeOf(property.type));
+    } else {
+      take(sizeOf(property.type));
+    }
+  }
+
+ private:
+  const std::string_view data_;
+  size_t offset_;
+};
+
+static void readVertices(const Ply::Element& element, Reader& reader,
+                         Mesh& mesh, bool& hasNormals) {
+  // Vertex records are normally fixed size, so each role sits at a fixed
+  // offset into the record.
+  size_t stride = 0;
+  std::array<size_t, kNumRoles> offsets;
+  std::array<Type, kNumRoles> types;
+  std::array<bool, kNumRoles> present{};
+  for (const auto& property : element.properties) {
+    if (property.list) {
+      throw std::runtime_error("PLY vertex lists are not supported");
+    }
+    const auto role = roleOf(property.name);
+    if (role != NONE) {
+      offsets[role] = stride;
+      types[role] = property.type;
+      present[role] = true;
+    }
+    stride += sizeOf(property.type);
+  }
+  if (!present[X] || !present[Y] || !present[Z]) {
+    throw std::runtime_error("PLY vertices need x, y and z");
+  }
+  hasNormals = present[NX] && present[NY] && present[NZ];
+  const auto hasTexcoords = present[U] && present[V];
+  const auto* records = reader.take(element.count, stride);
+  const auto component = [&](const char* record, const Role role) {
+    return static_cast<float>(read(record + offsets[role], types[role]));
+  };
+  mesh.positions.reserve(element.count);
+  for (auto i = 0UL; i < element.count; ++i) {
+    const auto* record = records + i * stride;
+    mesh.positions.emplace_back(component(record, X), component(record, Y),
+                                component(record, Z));
+    if (hasNormals) {
+      mesh.normals.push_back(Mesh::encodeNormal(Vec3(
+          component(record, NX), component(record, NY),
+          component(record, NZ))));
+    }
+    if (hasTexcoords) {
+      mesh.texcoords.push_back({floatToHalf(component(record, U)),
+                                floatToHalf(component(record, V))});
+    }
+  }
+}
+
+// Throws std::out_of_range for indices outside the numVertices vertices,
+// which computeNormals() would otherwise follow before Scene checks them.
+static void readFaces(const Ply::Element& element, Reader& reader,
+                      const size_t numVertices, Mesh& mesh) {
+  const Ply::Property* indexList = nullptr;
+  for (const auto& property : element.properties) {
+    if (property.list && (property.name == "vertex_indices" ||
+                          property.name == "vertex_index")) {
+      indexList = &property;
+    }
+  }
+  if (!indexList) {
+    throw std::runtime_error("PLY faces need vertex_indices");
+  }
+  const auto indexSize = sizeOf(indexList->type);
+  for (auto i = 0UL; i < element.count; ++i) {
+    for (const auto& property : element.properties) {
+      if (&property != indexList) {
+        reader.skip(property);
+        continue;
+      }
+      const auto count = reader.count(property.countType);
+      if (count < 3) {
+        throw std::length_error("A face must have at least 3 vertices!");
+      }
+      const auto* items = reader.take(count, indexSize);
+      const auto index = [&](const size_t j) {
+        const auto value = read(items + j * indexSize, property.type);
+        if (!(value >= 0 && value < numVertices)) {
+          throw std::out_of_range("Face index out-of-range!");
+        }
+        return static_cast<uint32_t>(value);
+      };
+      const auto first = index(0);
+      for (auto j = 1UL; j + 1 < count; ++j) {
+        mesh.indices.insert(mesh.indices.end(),
+                            {first, index(j), index(j + 1)});
+        mesh.materialIds.push_back(0);
+      }
+    }
+  }
+}
+}  // namespace
+
+Ply::Ply(const std::string& path) : file_(path) {
+  auto text = file_.contents();
+  if (nextLine(text).substr(0, 3) != "ply") {
+    throw std::runtime_error("Not a PLY file");
+  }
+  while (true) {
+    if (text.empty()) {
+      throw std::runtime_error("PLY header has no end_header");
+    }
+    auto line = nextLine(text);
+    const auto keyword = nextToken(line);
+    if (keyword == "format") {
+      if (nextToken(line) != "binary_little_endian") {
+        throw std::runtime_error("Only binary_little_endian PLY is supported");
+      }
+    } else if (keyword == "element") {
+      auto& element = elements_.emplace_back();
+      element.name = nextToken(line);
+      element.count = parseNumber<size_t>(nextToken(line));
+    } else if (keyword == "property") {
+      if (elements_.empty()) {
+        throw std::runtime_error("PLY property outside of an element");
+      }
+      auto& property = elements_.back().properties.emplace_back();
+      auto type = nextToken(line);
+      if (type == "list") {
+        property.list = true;
+        property.countType = parseType(nextToken(line));
+        type = nextToken(line);
+      }
+      property.type = parseType(type);
+      property.name = nextToken(line);
+    } else if (keyword == "end_header") {
+      break;
+    }
+  }
+  dataOffset_ = file_.contents().size() - text.size();
+}
+
+std::unique_ptr<Scene> Ply::toScene(const MeshOptions& meshOptions) const {
+  Mesh mesh;
+  bool hasNormals = false;
+  size_t numVertices = 0;
+  for (const auto& element : elements_) {
+    if (element.name == "vertex") {
+      numVertices += element.count;
+    }
+  }
+  Reader reader(file_.contents(), dataOffset_);
+  for (const auto& element : elements_) {
+    if (element.name == "vertex") {
+      readVertices(element, reader, mesh, hasNormals);
+    } else if (element.name == "face") {
+      readFaces(element, reader, numVertices, mesh);
+    } else if (!element.properties.empty()) {
+      for (auto i = 0UL; i < element.count; ++i) {
+        for (const auto& property : element.properties) {
+          reader.skip(property);
+        }
+      }
+    }
+  }
+  if (!hasNormals) {
+    mesh.computeNormals();
+  }
+  Material material;
+  material.diffuse = Vec3(.8f, .8f, .8f);
+  material.illuminationModel = Material::DIFFUSE;
+  return std::make_unique<Scene>(std::move(mesh),
+                                 std::vector<Material>{material}, meshOptions);
+}
+}  // namespace tinyrt
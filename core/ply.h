@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/scene.h"
+#include "util/mapped_file.h"
+
+namespace tinyrt {
+// A binary little-endian PLY file, e.g. from a scanner. Only the header is
+// parsed up front; toScene() reads the vertex and face records straight from
+// the mapped file into the scene's mesh. Reads positions, and normals and
+// texture coordinates where present; faces are fanned into triangles. All
+// faces use one neutral diffuse material.
+class Ply final {
+ public:
+  explicit Ply(const std::string& path);
+  Ply(const Ply&) = delete;
+  Ply& operator=(const Ply&) = delete;
+
+  std::unique_ptr<Scene> toScene(const MeshOptions& meshOptions = {}) const;
+
+  friend std::ostream& operator<<(std::ostream& os, const Ply& ply);
+
+ public:
+  enum class Type { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT, DOUBLE };
+
+  struct Property {
+    std::string name;
+    Type type;
+    // List properties start with a count of type countType, followed by
+    // that many items of type.
+    bool list = false;
+    Type countType = Type::UINT8;
+  };
+
+  struct Element {
+    std::string name;
+    size_t count;
+    std::vector<Property> properties;
+  };
+
+ private:
+  MappedFile file_;
+  std::vector<Element> elements_;
+  // Where the records start, just past the header.
+  size_t dataOffset_ = 0;
+};
+}  // namespace tinyrt
@@ -0,0 +1,66 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/preview.h"
+
+#include <algorithm>
+
+#include "util/async.h"
+#include "util/log.h"
+
+namespace tinyrt {
+void preview(const Scene& scene, const Renderer& renderer,
+             const Camera::RayGenerator& rayGenerator, const uint32_t seed,
+             Framebuffer& image, ImageWriter& writer) {
+  const TraceOptions options{
+      .directRays = 1,
+      .indirectRays = 1,
+      .shadowRays = 1,
+  };
+  for (auto size = Framebuffer::kTileSize; size >= 2; size /= 2) {
+    Async::submitN(
+        [&](const unsigned tile) {
+          const auto pixels = image.tile(tile);
+          for (auto y0 = pixels.y0; y0 < pixels.y1; y0 += size) {
+            for (auto x0 = pixels.x0; x0 < pixels.x1; x0 += size) {
+              const auto x1 = std::min(x0 + size, pixels.x1);
+              const auto y1 = std::min(y0 + size, pixels.y1);
+              const auto x = (x0 + x1) / 2;
+              const auto y = (y0 + y1) / 2;
+              renderer.render(scene, rayGenerator, options, seed,
+                              {x, y, x + 1, y + 1}, image);
+              const auto color = image(x, y);
+              for (auto py = y0; py < y1; ++py) {
+                for (auto px = x0; px < x1; ++px) {
+                  image(px, py) = color;
+                }
+              }
+            }
+          }
+          writer.submit(image, pixels);
+        },
+        image.numTiles());
+    writer.drain();
+    LOG(INFO) << "Preview written at 1/" << size << " resolution.";
+  }
+}
+}  // namespace tinyrt
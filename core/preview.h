@@ -0,0 +1,42 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+#include "core/camera.h"
+#include "core/framebuffer.h"
+#include "core/image_writer.h"
+#include "core/render.h"
+#include "core/scene.h"
+
+namespace tinyrt {
+// Fills image, written through writer, at a fraction of a sample per pixel:
+// one sample for each kTileSize-wide square, i.e. at 1/kTileSize of the
+// resolution, then for each square half as wide, down to 2 pixels. Each
+// level is written out before the next starts, so a first image is there
+// almost at once.
+void preview(const Scene& scene, const Renderer& renderer,
+             const Camera::RayGenerator& rayGenerator, uint32_t seed,
+             Framebuffer& image, ImageWriter& writer);
+}  // namespace tinyrt
@@ -0,0 +1,170 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/random.h"
+
+#include <immintrin.h>
+
+namespace tinyrt {
+namespace {
+static constexpr uint32_t kMultiplier0 = 0xD2511F53;
+static constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+static constexpr uint32_t kWeyl0 = 0x9E3779B9;
+static constexpr uint32_t kWeyl1 = 0xBB67AE85;
+static constexpr auto kRounds = 10U;
+static constexpr auto kUniformScale = 1.f / (1U << 24);
+
+template <typename TFloat>
+struct Lanes;
+
+template <>
+struct Lanes<AVX2Float> {
+  using int_t = __m256i;
+  static constexpr auto kWidth = 8U;
+
+  static int_t set1(const uint32_t value) { return _mm256_set1_epi32(value); }
+  static int_t load(const uint32_t* source) {
+    return _mm256_load_si256(reinterpret_cast<const int_t*>(source));
+  }
+  static int_t bitXor(const int_t a, const int_t b) {
+    return _mm256_xor_si256(a, b);
+  }
+  static void mulhilo(const int_t a, const uint32_t b, int_t& hi, int_t& lo) {
+    const auto multiplier = set1(b);
+    lo = _mm256_mullo_epi32(a, multiplier);
+    const auto even = _mm256_mul_epu32(a, multiplier);
+    const auto odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), multiplier);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+  }
+  static AVX2Float uniform(const int_t bits) {
+    return AVX2Float(_mm256_cvtepi32_ps(_mm256_srli_epi32(bits, 8))) *
+           kUniformScale;
+  }
+};
+
+template <>
+struct Lanes<AVX512Float> {
+  using int_t = __m512i;
+  static constexpr auto kWidth = 16U;
+
+  static int_t set1(const uint32_t value) { return _mm512_set1_epi32(value); }
+  static int_t load(const uint32_t* source) {
+    return _mm512_load_si512(source);
+  }
+  static int_t bitXor(const int_t a, const int_t b) {
+    return _mm512_xor_si512(a, b);
+  }
+  static void mulhilo(const int_t a, const uint32_t b, int_t& hi, int_t& lo) {
+    const auto multiplier = set1(b);
+    lo = _mm512_mullo_epi32(a, multiplier);
+    const auto even = _mm512_mul_epu32(a, multiplier);
+    const auto odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), multiplier);
+    hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+  }
+  static AVX512Float uniform(const int_t bits) {
+    return AVX512Float(_mm512_cvtepi32_ps(_mm512_srli_epi32(bits, 8))) *
+           kUniformScale;
+  }
+};
+
+static std::array<uint32_t, 4> philox(std::array<uint32_t, 4> counter,
+                                      std::array<uint32_t, 2> key) {
+  for (auto round = 0U; round < kRounds; ++round) {
+    const uint64_t product0 = uint64_t(kMultiplier0) * counter[0];
+    const uint64_t product1 = uint64_t(kMultiplier1) * counter[2];
+    counter = {uint32_t(product1 >> 32) ^ counter[1] ^ key[0],
+               uint32_t(product1),
+               uint32_t(product0 >> 32) ^ counter[3] ^ key[1],
+               uint32_t(product0)};
+    key[0] += kWeyl0;
+    key[1] += kWeyl1;
+  }
+  return counter;
+}
+}  // namespace
+
+Random::Random(const uint64_t stream, const uint32_t seed)
+    : stream_(stream), seed_(seed) {}
+
+float Random::uniform() {
+  if (buffered_ == 0) {
+    buffer_ = uniforms(counter_++);
+    buffered_ = buffer_.size();
+  }
+  return buffer_[buffer_.size() - buffered_--];
+}
+
+uint64_t Random::reserve(const uint64_t n) {
+  const auto block = counter_;
+  counter_ += n;
+  return block;
+}
+
+std::array<float, 4> Random::uniforms(const uint64_t block) const {
+  const auto bits = philox(
+      {uint32_t(block), uint32_t(block >> 32), uint32_t(stream_),
+       uint32_t(stream_ >> 32)},
+      {seed_, 0});
+  std::array<float, 4> ret;
+  for (auto i = 0U; i < ret.size(); ++i) {
+    ret[i] = (bits[i] >> 8) * kUniformScale;
+  }
+  return ret;
+}
+
+template <typename TFloat>
+std::array<TFloat, 4> Random::uniforms(const uint64_t block) const {
+  using lanes_t = Lanes<TFloat>;
+  using int_t = typename lanes_t::int_t;
+  alignas(64) uint32_t low[lanes_t::kWidth];
+  alignas(64) uint32_t high[lanes_t::kWidth];
+  for (auto i = 0U; i < lanes_t::kWidth; ++i) {
+    low[i] = uint32_t(block + i);
+    high[i] = uint32_t((block + i) >> 32);
+  }
+  int_t counter[4] = {lanes_t::load(low), lanes_t::load(high),
+                      lanes_t::set1(uint32_t(stream_)),
+                      lanes_t::set1(uint32_t(stream_ >> 32))};
+  uint32_t key[2] = {seed_, 0};
+  for (auto round = 0U; round < kRounds; ++round) {
+    int_t hi0, lo0, hi1, lo1;
+    lanes_t::mulhilo(counter[0], kMultiplier0, hi0, lo0);
+    lanes_t::mulhilo(counter[2], kMultiplier1, hi1, lo1);
+    counter[0] = lanes_t::bitXor(lanes_t::bitXor(hi1, counter[1]),
+                                 lanes_t::set1(key[0]));
+    counter[1] = lo1;
+    counter[2] = lanes_t::bitXor(lanes_t::bitXor(hi0, counter[3]),
+                                 lanes_t::set1(key[1]));
+    counter[3] = lo0;
+    key[0] += kWeyl0;
+    key[1] += kWeyl1;
+  }
+  return {lanes_t::uniform(counter[0]), lanes_t::uniform(counter[1]),
+          lanes_t::uniform(counter[2]), lanes_t::uniform(counter[3])};
+}
+
+/* explicit */ template std::array<AVX2Float, 4> Random::uniforms<AVX2Float>(
+    const uint64_t block) const;
+
+/* explicit */ template std::array<AVX512Float, 4>
+Random::uniforms<AVX512Float>(const uint64_t block) const;
+}  // namespace tinyrt
@@ -0,0 +1,70 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "core/avx2float.h"
+#include "core/avx512float.h"
+
+namespace tinyrt {
+// Counter-based random numbers (Philox4x32-10). Every block index of a
+// (seed, stream) pair maps to four independent uniforms without any shared
+// state, so giving each pixel its own stream makes renders reproducible no
+// matter which thread draws the numbers.
+class Random final {
+ public:
+  explicit Random(const uint64_t stream, const uint32_t seed = 0);
+
+  // Next uniform float in [0, 1).
+  float uniform();
+
+  // Reserves n blocks for batch sampling and returns the first block index.
+  uint64_t reserve(const uint64_t n);
+
+  // The next unused block, for continuing the stream later with seek(), e.g.
+  // from a checkpoint. Uniforms left over from a partly used block are
+  // skipped on resuming.
+  uint64_t position() const { return counter_; }
+  void seek(const uint64_t block) {
+    counter_ = block;
+    buffered_ = 0;
+  }
+
+  // The four uniforms of a block.
+  std::array<float, 4> uniforms(const uint64_t block) const;
+
+  // Lane i holds the uniforms of block + i, so a batch reads the same numbers
+  // whatever its SIMD width is.
+  template <typename TFloat>
+  std::array<TFloat, 4> uniforms(const uint64_t block) const;
+
+ private:
+  const uint64_t stream_;
+  const uint32_t seed_;
+  uint64_t counter_ = 0;
+  std::array<float, 4> buffer_;
+  unsigned buffered_ = 0;
+};
+}  // namespace tinyrt
@@ -0,0 +1,325 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/rasterizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "core/intersect.h"
+#include "core/random.h"
+#include "util/async.h"
+
+namespace tinyrt {
+namespace {
+// Side of the screen squares triangles are binned by, in pixels. A whole
+// number of tiles, so that bins never write to the same tile.
+constexpr unsigned kBinSize = 4 * Framebuffer::kTileSize;
+// Triangles set up per task.
+constexpr unsigned kChunkSize = 4096;
+
+using dvec3 = std::array<double, 3>;
+
+static dvec3 toDouble(const Vec3& v) { return {v->x, v->y, v->z}; }
+
+static dvec3 cross(const dvec3& a, const dvec3& b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+          a[0] * b[1] - a[1] * b[0]};
+}
+
+static double dot(const dvec3& a, const dvec3& b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Maps points to homogeneous pixel coordinates (a, b, c): the ray of pixel
+// coordinates (a / c, b / c) passes through the point, which is c times as
+// far along it as the image plane, so c > 0 in front of the camera.
+class Projection final {
+ public:
+  explicit Projection(const Camera::RayGenerator& rayGenerator)
+      : position_(toDouble(rayGenerator.position)) {
+    // Inverts the matrix of columns xbasis, ybasis and the direction to the
+    // top left corner.
+    const auto x = toDouble(rayGenerator.xbasis);
+    const auto y = toDouble(rayGenerator.ybasis);
+    const auto corner = toDouble(rayGenerator.topLeft - rayGenerator.position);
+    const auto det = dot(x, cross(y, corner));
+    rows_ = {cross(y, corner), cross(corner, x), cross(x, y)};
+    for (auto& row : rows_) {
+      for (auto& value : row) {
+        value /= det;
+      }
+    }
+  }
+
+  dvec3 operator()(const Vec3& point) const {
+    const auto p = toDouble(point);
+    const dvec3 d{p[0] - position_[0], p[1] - position_[1],
+                  p[2] - position_[2]};
+    return {dot(rows_[0], d), dot(rows_[1], d), dot(rows_[2], d)};
+  }
+
+ private:
+  dvec3 position_;
+  std::array<dvec3, 3> rows_;
+};
+
+// A triangle ready for scan conversion. At sample (x, y), the edge
+// functions edges[i][0] * x + edges[i][1] * y + edges[i][2] are the
+// barycentric coordinates of the ray's hit up to a common factor, so the
+// sample is covered if they are all non-negative with a positive sum. The
+// hit is scale / sum along the ray generator's unnormalized direction.
+struct Setup {
+  std::array<std::array<float, 3>, 3> edges;
+  float scale;
+  // Pixels the triangle may cover.
+  Block bounds;
+  uint32_t primitive;
+};
+
+// Setups of a run of triangles, grouped by bin: bin b's are
+// setups[binned[binStarts[b]]] up to binStarts[b + 1].
+struct Chunk {
+  std::vector<Setup> setups;
+  std::vector<uint32_t> binStarts;
+  std::vector<uint32_t> binned;
+};
+
+// False for triangles that can't cover a sample of region.
+static bool setUp(const Projection& project, const Mesh& mesh,
+                  const uint32_t primitive, const Block& region,
+                  Setup& setup) {
+  const std::array<dvec3, 3> corners{project(mesh.position(primitive, 0)),
+                                     project(mesh.position(primitive, 1)),
+                                     project(mesh.position(primitive, 2))};
+  if (corners[0][2] <= 0 && corners[1][2] <= 0 && corners[2][2] <= 0) {
+    return false;
+  }
+  const auto det = dot(corners[0], cross(corners[1], corners[2]));
+  // Seen edge on, or degenerate.
+  if (!(det != 0)) {
+    return false;
+  }
+  // Rows of the inverse of the corners' matrix, scaled by det. A shared
+  // edge gives its two triangles exactly opposite edge functions.
+  const double sign = det > 0 ? 1 : -1;
+  for (auto i = 0U; i < 3; ++i) {
+    const auto edge = cross(corners[(i + 1) % 3], corners[(i + 2) % 3]);
+    for (auto j = 0U; j < 3; ++j) {
+      setup.edges[i][j] = sign * edge[j];
+    }
+  }
+  setup.scale = std::abs(det);
+  setup.primitive = primitive;
+  setup.bounds = region;
+  // A triangle reaching behind the camera may cover anything.
+  if (corners[0][2] > 0 && corners[1][2] > 0 && corners[2][2] > 0) {
+    double x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+    for (const auto& corner : corners) {
+      x0 = std::min(x0, corner[0] / corner[2]);
+      x1 = std::max(x1, corner[0] / corner[2]);
+      y0 = std::min(y0, corner[1] / corner[2]);
+      y1 = std::max(y1, corner[1] / corner[2]);
+    }
+    // Samples lie in [x, x + 1) of pixel x.
+    const auto clamp = [](const double value, const unsigned low,
+                          const unsigned high) {
+      return static_cast<unsigned>(std::clamp(value, double(low),
+                                              double(high)));
+    };
+    setup.bounds = {
+        .x0 = clamp(std::floor(x0), region.x0, region.x1),
+        .y0 = clamp(std::floor(y0), region.y0, region.y1),
+        .x1 = clamp(std::floor(x1) + 1, region.x0, region.x1),
+        .y1 = clamp(std::floor(y1) + 1, region.y0, region.y1),
+    };
+  }
+  return setup.bounds.x0 < setup.bounds.x1 && setup.bounds.y0 < setup.bounds.y1;
+}
+
+// Hits of the samples of pixels in block that setup covers closer than
+// what layer holds, with the distance in scale / sum units for now.
+static void scanConvert(const Setup& setup, const Block& block,
+                        const std::pair<float, float>& offset,
+                        TiledImage<Hit>& layer) {
+  const auto& [e0, e1, e2] = setup.edges;
+  for (auto y = block.y0; y < block.y1; ++y) {
+    const float sy = y + offset.second;
+    for (auto x = block.x0; x < block.x1; ++x) {
+      const float sx = x + offset.first;
+      const auto w0 = e0[0] * sx + e0[1] * sy + e0[2];
+      const auto w1 = e1[0] * sx + e1[1] * sy + e1[2];
+      const auto w2 = e2[0] * sx + e2[1] * sy + e2[2];
+      if (w0 < 0 || w1 < 0 || w2 < 0) {
+        continue;
+      }
+      const auto sum = w0 + w1 + w2;
+      if (!(sum > 0)) {
+        continue;
+      }
+      const auto distance = setup.scale / sum;
+      auto& hit = layer(x, y);
+      if (distance < hit.time) {
+        hit = {distance, w1 / sum, w2 / sum, setup.primitive};
+      }
+    }
+  }
+}
+}  // namespace
+
+GBuffer::GBuffer(const unsigned width, const unsigned height,
+                 const Block& region,
+                 std::vector<std::pair<float, float>> offsets)
+    : offsets(std::move(offsets)) {
+  layers.reserve(this->offsets.size());
+  for (auto i = 0U; i < this->offsets.size(); ++i) {
+    layers.emplace_back(width, height, region);
+  }
+}
+
+std::vector<std::pair<float, float>> jitteredOffsets(const unsigned n,
+                                                     const uint32_t seed) {
+  const auto columns = static_cast<unsigned>(std::ceil(std::sqrt(n)));
+  const auto rows = (n + columns - 1) / columns;
+  Random random(0, seed);
+  std::vector<std::pair<float, float>> offsets;
+  for (auto i = 0U; i < n; ++i) {
+    const auto dx = (i % columns + random.uniform()) / columns;
+    const auto dy = (i / columns + random.uniform()) / rows;
+    offsets.emplace_back(dx, dy);
+  }
+  return offsets;
+}
+
+void rasterize(const Scene& scene, const Camera::RayGenerator& rayGenerator,
+               GBuffer& gbuffer) {
+  if (gbuffer.layers.empty()) {
+    return;
+  }
+  const auto& region = gbuffer.layers.front().region();
+  const auto binsX = (region.x1 - region.x0 + kBinSize - 1) / kBinSize;
+  const auto binsY = (region.y1 - region.y0 + kBinSize - 1) / kBinSize;
+  const auto numBins = binsX * binsY;
+  const auto& mesh = scene.mesh();
+  const Projection project(rayGenerator);
+
+  // Set up and bin the triangles, a chunk per task. Chunks don't depend on
+  // the thread count, nor then does the order of triangles within a bin.
+  std::vector<Chunk> chunks((mesh.size() + kChunkSize - 1) / kChunkSize);
+  const auto setUpChunk = [&](const unsigned index) {
+    auto& chunk = chunks[index];
+    const auto begin = index * kChunkSize;
+    const auto end = std::min<size_t>(begin + kChunkSize, mesh.size());
+    chunk.binStarts.assign(numBins + 1, 0);
+    Setup setup;
+    for (auto primitive = begin; primitive < end; ++primitive) {
+      if (!setUp(project, mesh, primitive, region, setup)) {
+        continue;
+      }
+      chunk.setups.push_back(setup);
+    }
+    // Counting sort of the setups by bin.
+    const auto forEachBin = [&](const Setup& setup, auto&& function) {
+      const auto& bounds = setup.bounds;
+      for (auto by = (bounds.y0 - region.y0) / kBinSize;
+           by <= (bounds.y1 - 1 - region.y0) / kBinSize; ++by) {
+        for (auto bx = (bounds.x0 - region.x0) / kBinSize;
+             bx <= (bounds.x1 - 1 - region.x0) / kBinSize; ++bx) {
+          function(by * binsX + bx);
+        }
+      }
+    };
+    for (const auto& setup : chunk.setups) {
+      forEachBin(setup,
+                 [&](const unsigned bin) { ++chunk.binStarts[bin + 1]; });
+    }
+    for (auto bin = 0U; bin < numBins; ++bin) {
+      chunk.binStarts[bin + 1] += chunk.binStarts[bin];
+    }
+    chunk.binned.resize(chunk.binStarts.back());
+    auto next = chunk.binStarts;
+    for (auto i = 0U; i < chunk.setups.size(); ++i) {
+      forEachBin(chunk.setups[i],
+                 [&](const unsigned bin) { chunk.binned[next[bin]++] = i; });
+    }
+  };
+  if (!chunks.empty()) {
+    Async::submitN(setUpChunk, chunks.size());
+  }
+
+  Async::submitN(
+      [&](const unsigned bin) {
+        const auto x0 = region.x0 + bin % binsX * kBinSize;
+        const auto y0 = region.y0 + bin / binsX * kBinSize;
+        const Block pixels{x0, y0, std::min(region.x1, x0 + kBinSize),
+                           std::min(region.y1, y0 + kBinSize)};
+        for (auto index = 0U; index < gbuffer.layers.size(); ++index) {
+          auto& layer = gbuffer.layers[index];
+          const auto& offset = gbuffer.offsets[index];
+          for (auto y = pixels.y0; y < pixels.y1; ++y) {
+            for (auto x = pixels.x0; x < pixels.x1; ++x) {
+              layer(x, y) = {INFINITY, 0, 0, GBuffer::kMiss};
+            }
+          }
+          for (const auto& chunk : chunks) {
+            for (auto i = chunk.binStarts[bin]; i < chunk.binStarts[bin + 1];
+                 ++i) {
+              const auto& setup = chunk.setups[chunk.binned[i]];
+              const Block covered{
+                  std::max(pixels.x0, setup.bounds.x0),
+                  std::max(pixels.y0, setup.bounds.y0),
+                  std::min(pixels.x1, setup.bounds.x1),
+                  std::min(pixels.y1, setup.bounds.y1),
+              };
+              scanConvert(setup, covered, offset, layer);
+            }
+          }
+          // Coverage in single precision is exact enough to pick the
+          // triangle, but not to place the hit on it at grazing angles, so
+          // the hit is taken again from the ray test that tracing uses.
+          for (auto y = pixels.y0; y < pixels.y1; ++y) {
+            for (auto x = pixels.x0; x < pixels.x1; ++x) {
+              auto& hit = layer(x, y);
+              if (hit.primitive == GBuffer::kMiss) {
+                continue;
+              }
+              const float sx = x + offset.first;
+              const float sy = y + offset.second;
+              if (const auto exact =
+                      intersect(rayGenerator(sx, sy), mesh, hit.primitive)) {
+                hit = *exact;
+              } else {
+                // The ray test rounds an edge the other way; keep the
+                // estimate, scaled to the normalized direction.
+                hit.time *= (rayGenerator.topLeft - rayGenerator.position +
+                             rayGenerator.xbasis * sx +
+                             rayGenerator.ybasis * sy)
+                                .norm();
+              }
+            }
+          }
+        }
+      },
+      numBins);
+}
+}  // namespace tinyrt
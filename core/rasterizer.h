@@ -0,0 +1,63 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "core/camera.h"
+#include "core/framebuffer.h"
+
+namespace tinyrt {
+// Primary hits of an image at a few subpixel offsets, one layer per offset:
+// for each pixel (x, y), the first hit of rayGenerator(x + dx, y + dy), as
+// intersecters report it.
+struct GBuffer {
+  // Primitive of samples whose ray escapes.
+  static constexpr uint32_t kMiss = std::numeric_limits<uint32_t>::max();
+
+  // Layers for the pixels of region of a width x height frame.
+  GBuffer(unsigned width, unsigned height, const Block& region,
+          std::vector<std::pair<float, float>> offsets);
+
+  // (dx, dy) in [0, 1)^2 per layer.
+  std::vector<std::pair<float, float>> offsets;
+  std::vector<TiledImage<Hit>> layers;
+};
+
+// n subpixel offsets stratified over the pixel: one random point in each
+// cell of a grid as near square as n allows.
+std::vector<std::pair<float, float>> jitteredOffsets(unsigned n,
+                                                     uint32_t seed);
+
+// Fills gbuffer with the scene as rayGenerator sees it by rasterizing its
+// triangles, on all threads, rather than tracing a ray per sample.
+// Triangles are binned by the screen areas they may cover, then each bin
+// is scan converted on its own. Coverage is tested with homogeneous edge
+// functions, which need no clipping for triangles reaching behind the
+// camera and leave no cracks between triangles that share an edge.
+void rasterize(const Scene& scene, const Camera::RayGenerator& rayGenerator,
+               GBuffer& gbuffer);
+}  // namespace tinyrt
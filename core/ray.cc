@@ -0,0 +1,54 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/ray.h"
+
+namespace tinyrt {
+Vec3 Intersection::sampleDiffuseTexture() const {
+  std::array<float, 2> texcoords[3];
+  for (auto corner = 0U; corner < 3; ++corner) {
+    texcoords[corner] = mesh->texcoord(primitive, corner);
+  }
+  const auto w = 1 - uv->x - uv->y;
+  const auto s = texcoords[0][0] * w + texcoords[1][0] * uv->x +
+                 texcoords[2][0] * uv->y;
+  const auto t = texcoords[0][1] * w + texcoords[1][1] * uv->x +
+                 texcoords[2][1] * uv->y;
+  // Texture space per world space length on this triangle, from the ratio
+  // of its areas, and the cone width stretched by the incidence angle.
+  const auto p0 = mesh->position(primitive, 0);
+  const auto worldArea = (mesh->position(primitive, 1) - p0)
+                             .cross(mesh->position(primitive, 2) - p0)
+                             .norm();
+  const auto textureArea =
+      std::abs((texcoords[1][0] - texcoords[0][0]) *
+                   (texcoords[2][1] - texcoords[0][1]) -
+               (texcoords[2][0] - texcoords[0][0]) *
+                   (texcoords[1][1] - texcoords[0][1]));
+  const auto cosine = std::abs(normal().dot(ray.direction));
+  const auto footprint =
+      worldArea > 0.f && cosine > 1e-3f
+          ? ray.coneWidthAt(time) * std::sqrt(textureArea / worldArea) / cosine
+          : 0.f;
+  return textures->sample(material->diffuseTexture, s, t, footprint);
+}
+}  // namespace tinyrt
@@ -22,6 +22,9 @@
 
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <optional>
 
 #include "core/scene.h"
@@ -30,9 +33,42 @@ namespace tinyrt {
 struct Ray {
   Vec3 origin;
   Vec3 direction;
+  // Precomputed for slab tests and kd-tree traversal. Zero direction
+  // components become signed infinities, and the sign comes from the sign bit
+  // so that -0 counts as negative.
+  Vec3 invDirection;
+  std::array<unsigned, 3> sign;
+  // Ray cone for texture filtering: the footprint is coneWidth wide at the
+  // origin and grows by coneSpread per unit of distance. Zero for rays that
+  // don't look up textures, e.g. shadow rays.
+  float coneWidth;
+  float coneSpread;
 
-  Ray(const Vec3& origin, const Vec3& direction)
-      : origin(origin), direction(direction.normalize()) {}
+  Ray(const Vec3& origin, const Vec3& direction, const float coneWidth = 0.f,
+      const float coneSpread = 0.f)
+      : origin(origin),
+        direction(direction.normalize()),
+        invDirection(1.f / this->direction->x, 1.f / this->direction->y,
+                     1.f / this->direction->z),
+        sign{std::signbit(this->direction->x),
+             std::signbit(this->direction->y),
+             std::signbit(this->direction->z)},
+        coneWidth(coneWidth),
+        coneSpread(coneSpread) {}
+
+  float coneWidthAt(const float time) const {
+    return coneWidth + coneSpread * time;
+  }
+};
+
+// What traversal and the leaf tests pass around: barycentric coordinates of
+// the hit on the mesh triangle primitive, at time along the ray. Only the
+// closest one gets expanded into an Intersection.
+struct Hit {
+  float time;
+  float u;
+  float v;
+  uint32_t primitive;
 };
 
 struct Intersection {
@@ -40,28 +76,47 @@ struct Intersection {
   float time;
   Vec3 position;
   Vec3 uv;
-  const Triangle* triangle;
+  const Mesh* mesh;
+  uint32_t primitive;
   const Material* material;
+  const TextureCache* textures;
 
-  Intersection(const Ray& ray, const float time, const Vec3& uv,
-               const Triangle& triangle, const Material& material)
+  Intersection(const Ray& ray, const Hit& hit, const Scene& scene)
       : ray(ray),
-        time(time),
-        position(ray.origin + ray.direction * time),
-        uv(uv),
-        triangle(&triangle),
-        material(&material) {}
+        time(hit.time),
+        position(ray.origin + ray.direction * hit.time),
+        uv(hit.u, hit.v, 0.f),
+        mesh(&scene.mesh()),
+        primitive(hit.primitive),
+        material(&scene.material(hit.primitive)),
+        textures(&scene.textures()) {}
 
   const Vec3& normal() const {
     if (!normal_) {
-      normal_ = triangle->a().normal * (1 - uv->x - uv->y) +
-                triangle->b().normal * uv->x + triangle->c().normal * uv->y;
+      normal_ = mesh->normal(primitive, 0) * (1 - uv->x - uv->y) +
+                mesh->normal(primitive, 1) * uv->x +
+                mesh->normal(primitive, 2) * uv->y;
     }
     return *normal_;
   }
 
+  // The material's diffuse color, scaled by its texture if it has one.
+  Vec3 diffuse() const {
+    if (material->diffuseTexture < 0) {
+      return material->diffuse;
+    }
+    if (!diffuse_) {
+      diffuse_ = material->diffuse * sampleDiffuseTexture();
+    }
+    return *diffuse_;
+  }
+
  private:
+  // Filtered over the ray cone's footprint on the triangle.
+  Vec3 sampleDiffuseTexture() const;
+
   // Computed on-demand.
   mutable std::optional<Vec3> normal_;
+  mutable std::optional<Vec3> diffuse_;
 };
 }  // namespace tinyrt
@@ -23,13 +23,14 @@
 #include "core/ray_tracer.h"
 
 namespace tinyrt {
-Color RayTracer::trace(const RaySampler& raySampler,
+Color RayTracer::trace(const RaySampler& raySampler, Random&,
                        const Intersecter& intersecter, const Scene& scene,
                        const Shader& shader,
                        const TraceOptions& options) const {
   Color illumination;
   const auto intersection = intersecter.intersect(raySampler());
   if (intersection) {
+    touch(options, scene, *intersection);
     for (const auto& light : scene.lights()) {
       Vec3 illum = shader.shade(*intersection, *light);
       if (!illum.small()) {
@@ -37,6 +38,9 @@ Color RayTracer::trace(const RaySampler& raySampler,
         const Ray shadowRay(
             intersection->position + intersection->normal() * 1e-4f, lightVec);
         const auto shadowCheck = intersecter.intersect(shadowRay);
+        if (shadowCheck) {
+          touch(options, scene, *shadowCheck);
+        }
         if (shadowCheck && shadowCheck->time < lightVec.norm() - 1e-3f) {
           illum = Vec3();
         }
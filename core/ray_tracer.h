@@ -27,8 +27,9 @@
 namespace tinyrt {
 class RayTracer final : public Tracer {
  public:
-  Color trace(const RaySampler& raySampler, const Intersecter& intersecter,
-              const Scene& scene, const Shader& shader,
+  Color trace(const RaySampler& raySampler, Random& random,
+              const Intersecter& intersecter, const Scene& scene,
+              const Shader& shader,
               const TraceOptions& options) const override;
 };
 }  // namespace tinyrt
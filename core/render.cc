@@ -0,0 +1,182 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/render.h"
+
+#include <algorithm>
+
+#include "core/kdtree_intersecter.h"
+#include "core/path_tracer.h"
+#include "core/phong_shader.h"
+#include "core/simd_kdtree_intersecter.h"
+#include "core/simd_phong_shader.h"
+#include "util/arena.h"
+
+namespace tinyrt {
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::initialize(
+    const Scene& scene) {
+  intersecter_.initialize(scene);
+}
+
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::render(
+    const Scene& scene, const Camera::RayGenerator& rayGenerator,
+    const TraceOptions& options, const uint32_t seed, const Block& block,
+    Framebuffer& image) const {
+  // Per-sample buffers of the whole block, released together at its end.
+  static thread_local Arena scratch;
+  for (auto y = block.y0; y < block.y1; ++y) {
+    for (auto x = block.x0; x < block.x1; ++x) {
+      Random random(uint64_t{y} * image.width() + x, seed);
+      const PixelSampler raySampler{rayGenerator, x, y, random};
+      image(x, y) = tracer_.traceStatic(
+          raySampler, random, intersecter_, scene, shader_, options, scratch);
+    }
+  }
+  scratch.reset();
+}
+
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::renderPass(
+    const Scene& scene, const Camera::RayGenerator& rayGenerator,
+    const TraceOptions& options, const uint32_t seed, const Block& block,
+    Progress& progress, Framebuffer& image) const {
+  pass(scene, rayGenerator, options, seed, block, nullptr, nullptr, progress,
+       image);
+}
+
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::renderAdaptivePass(
+    const Scene& scene, const Camera::RayGenerator& rayGenerator,
+    const TraceOptions& options, const uint32_t seed, const Block& block,
+    const SampleTargets& targets, Progress& progress,
+    Framebuffer& image) const {
+  pass(scene, rayGenerator, options, seed, block, &targets, nullptr, progress,
+       image);
+}
+
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::renderRasterizedPass(
+    const Scene& scene, const Camera::RayGenerator& rayGenerator,
+    const TraceOptions& options, const uint32_t seed, const Block& block,
+    const GBuffer& gbuffer, Progress& progress, Framebuffer& image) const {
+  pass(scene, rayGenerator, options, seed, block, nullptr, &gbuffer, progress,
+       image);
+}
+
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::renderSurfaces(
+    const Scene&, const Camera::RayGenerator& rayGenerator, const Block& block,
+    SurfaceBuffer& surfaces) const {
+  for (auto y = block.y0; y < block.y1; ++y) {
+    for (auto x = block.x0; x < block.x1; ++x) {
+      auto& surface = surfaces(x, y);
+      const auto hit = intersecter_.intersect(rayGenerator(x + .5f, y + .5f));
+      if (!hit) {
+        surface = {};
+        continue;
+      }
+      const auto kernel = hit->material->kernel;
+      surface = {
+          .position = hit->position,
+          .primitive = hit->primitive,
+          .specular = kernel != Material::Kernel::DIFFUSE &&
+                      kernel != Material::Kernel::EMISSIVE,
+      };
+    }
+  }
+}
+
+template <typename TTracer, typename TIntersecter, typename TShader>
+void StaticRenderer<TTracer, TIntersecter, TShader>::pass(
+    const Scene& scene, const Camera::RayGenerator& rayGenerator,
+    const TraceOptions& options, const uint32_t seed, const Block& block,
+    const SampleTargets* targets, const GBuffer* gbuffer, Progress& progress,
+    Framebuffer& image) const {
+  static thread_local Arena scratch;
+  auto pixelOptions = options;
+  for (auto y = block.y0; y < block.y1; ++y) {
+    for (auto x = block.x0; x < block.x1; ++x) {
+      auto& pixel = progress(x, y);
+      if (targets) {
+        const auto target = (*targets)(x, y);
+        if (pixel.samples >= target) {
+          continue;
+        }
+        pixelOptions.directRays =
+            std::min(options.directRays, target - pixel.samples);
+      }
+      Random random(uint64_t{y} * image.width() + x, seed);
+      random.seek(pixel.random);
+      Color color;
+      if (gbuffer) {
+        auto layer = pixel.samples;
+        const RasterSampler raySampler{rayGenerator, *gbuffer, x, y, layer};
+        color = tracer_.traceStatic(raySampler, random, intersecter_, scene,
+                                    shader_, pixelOptions, scratch);
+      } else {
+        const PixelSampler raySampler{rayGenerator, x, y, random};
+        color = tracer_.traceStatic(raySampler, random, intersecter_, scene,
+                                    shader_, pixelOptions, scratch);
+      }
+      pixel.sum += color * pixelOptions.directRays;
+      pixel.samples += pixelOptions.directRays;
+      pixel.random = random.position();
+      image(x, y) = pixel.sum / pixel.samples;
+    }
+  }
+  scratch.reset();
+}
+
+/* explicit */ template class StaticRenderer<PathTracer, KdTreeIntersecter,
+                                             PhongShader>;
+
+/* explicit */ template class StaticRenderer<
+    PathTracer, SimdKdTreeIntersecter<AVX2Vec3>, PhongShader>;
+
+/* explicit */ template class StaticRenderer<
+    PathTracer, SimdKdTreeIntersecter<AVX2Vec3>, SimdPhongShader<AVX2Vec3>>;
+
+/* explicit */ template class StaticRenderer<
+    PathTracer, SimdKdTreeIntersecter<AVX512Vec3>, PhongShader>;
+
+/* explicit */ template class StaticRenderer<PathTracer,
+                                             SimdKdTreeIntersecter<AVX512Vec3>,
+                                             SimdPhongShader<AVX512Vec3>>;
+
+std::unique_ptr<Renderer> createRenderer(const int avx) {
+  switch (avx) {
+    case 512:
+      return std::make_unique<
+          StaticRenderer<PathTracer, SimdKdTreeIntersecter<AVX512Vec3>,
+                         SimdPhongShader<AVX512Vec3>>>();
+    case 2:
+      return std::make_unique<
+          StaticRenderer<PathTracer, SimdKdTreeIntersecter<AVX2Vec3>,
+                         SimdPhongShader<AVX2Vec3>>>();
+    default:
+      return std::make_unique<
+          StaticRenderer<PathTracer, KdTreeIntersecter, PhongShader>>();
+  }
+}
+}  // namespace tinyrt
@@ -0,0 +1,179 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <memory>
+
+#include "core/camera.h"
+#include "core/checkpoint.h"
+#include "core/framebuffer.h"
+#include "core/random.h"
+#include "core/rasterizer.h"
+#include "core/reprojection.h"
+#include "core/tracer.h"
+
+namespace tinyrt {
+// Jittered primary rays through pixel (x, y), drawing the jitter from random.
+struct PixelSampler {
+  const Camera::RayGenerator& rayGenerator;
+  const unsigned x;
+  const unsigned y;
+  Random& random;
+
+  Ray operator()() const {
+    return rayGenerator(x + random.uniform(), y + random.uniform());
+  }
+};
+
+// Primary hits of pixel (x, y) read from a GBuffer instead of traced: each
+// call takes the next layer, counting from layer.
+struct RasterSampler {
+  const Camera::RayGenerator& rayGenerator;
+  const GBuffer& gbuffer;
+  const unsigned x;
+  const unsigned y;
+  unsigned& layer;
+
+  std::optional<Intersection> hit(const Scene& scene) const {
+    const auto index = layer++ % gbuffer.layers.size();
+    const auto& hit = gbuffer.layers[index](x, y);
+    if (hit.primitive == GBuffer::kMiss) {
+      return std::nullopt;
+    }
+    const auto& [dx, dy] = gbuffer.offsets[index];
+    return Intersection(rayGenerator(x + dx, y + dy), hit, scene);
+  }
+};
+
+// Renders blocks of an image with a tracer, intersecter and shader chosen
+// when the renderer is created. Dispatch is virtual once per block; see
+// StaticRenderer for what happens inside.
+class Renderer {
+ public:
+  virtual ~Renderer() = default;
+
+  virtual void initialize(const Scene& scene) = 0;
+
+  // Traces every pixel of block into image. Pixel (x, y) samples stream
+  // y * width + x of seed, so the result does not depend on how the image is
+  // split into blocks.
+  virtual void render(const Scene& scene,
+                      const Camera::RayGenerator& rayGenerator,
+                      const TraceOptions& options, const uint32_t seed,
+                      const Block& block, Framebuffer& image) const = 0;
+
+  // Adds options.directRays samples to every pixel of block in progress,
+  // continuing each pixel's random stream where the previous pass left it,
+  // and writes the running averages into image. Splitting samples into
+  // passes thus gives the same result whether or not the render is stopped
+  // and resumed between them.
+  virtual void renderPass(const Scene& scene,
+                          const Camera::RayGenerator& rayGenerator,
+                          const TraceOptions& options, const uint32_t seed,
+                          const Block& block, Progress& progress,
+                          Framebuffer& image) const = 0;
+
+  // renderPass() that stops each pixel at targets(x, y) samples: pixels
+  // short of it get up to options.directRays more, the others are skipped.
+  virtual void renderAdaptivePass(const Scene& scene,
+                                  const Camera::RayGenerator& rayGenerator,
+                                  const TraceOptions& options,
+                                  const uint32_t seed, const Block& block,
+                                  const SampleTargets& targets,
+                                  Progress& progress,
+                                  Framebuffer& image) const = 0;
+
+  // renderPass() with the primary hits of pixels taken from gbuffer, made
+  // for rayGenerator, rather than traced. A pixel's samples go through the
+  // layers in turn, across passes too.
+  virtual void renderRasterizedPass(const Scene& scene,
+                                    const Camera::RayGenerator& rayGenerator,
+                                    const TraceOptions& options,
+                                    const uint32_t seed, const Block& block,
+                                    const GBuffer& gbuffer, Progress& progress,
+                                    Framebuffer& image) const = 0;
+
+  // Traces the ray through the center of every pixel of block into
+  // surfaces.
+  virtual void renderSurfaces(const Scene& scene,
+                              const Camera::RayGenerator& rayGenerator,
+                              const Block& block,
+                              SurfaceBuffer& surfaces) const = 0;
+};
+
+// A Renderer whose per-sample calls are all resolved at compile time: the
+// tracer is called through TTracer::traceStatic with concrete intersecter
+// and shader types, and rays come from PixelSampler rather than a
+// std::function. Explicitly instantiated in render.cc for the supported
+// pipelines.
+template <typename TTracer, typename TIntersecter, typename TShader>
+class StaticRenderer final : public Renderer {
+ public:
+  void initialize(const Scene& scene) override;
+
+  void render(const Scene& scene, const Camera::RayGenerator& rayGenerator,
+              const TraceOptions& options, const uint32_t seed,
+              const Block& block, Framebuffer& image) const override;
+
+  void renderPass(const Scene& scene, const Camera::RayGenerator& rayGenerator,
+                  const TraceOptions& options, const uint32_t seed,
+                  const Block& block, Progress& progress,
+                  Framebuffer& image) const override;
+
+  void renderAdaptivePass(const Scene& scene,
+                          const Camera::RayGenerator& rayGenerator,
+                          const TraceOptions& options, const uint32_t seed,
+                          const Block& block, const SampleTargets& targets,
+                          Progress& progress,
+                          Framebuffer& image) const override;
+
+  void renderRasterizedPass(const Scene& scene,
+                            const Camera::RayGenerator& rayGenerator,
+                            const TraceOptions& options, const uint32_t seed,
+                            const Block& block, const GBuffer& gbuffer,
+                            Progress& progress,
+                            Framebuffer& image) const override;
+
+  void renderSurfaces(const Scene& scene,
+                      const Camera::RayGenerator& rayGenerator,
+                      const Block& block,
+                      SurfaceBuffer& surfaces) const override;
+
+ private:
+  // renderPass(), with targets as in renderAdaptivePass() and gbuffer as in
+  // renderRasterizedPass() if not null.
+  void pass(const Scene& scene, const Camera::RayGenerator& rayGenerator,
+            const TraceOptions& options, const uint32_t seed,
+            const Block& block, const SampleTargets* targets,
+            const GBuffer* gbuffer, Progress& progress,
+            Framebuffer& image) const;
+
+  TTracer tracer_;
+  TIntersecter intersecter_;
+  TShader shader_;
+};
+
+// The StaticRenderer of the kernels for AVX version avx: 512, 2, or
+// otherwise the scalar ones.
+std::unique_ptr<Renderer> createRenderer(int avx);
+}  // namespace tinyrt
@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/reprojection.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tinyrt {
+namespace {
+// Largest difference between the depths of matching hits, as seen from the
+// previous camera, relative to that depth. Neighbouring pixels on a surface
+// at a grazing angle differ by more than their 3D distance would suggest,
+// so depth is what's compared.
+constexpr float kMatchTolerance = 2e-2f;
+
+// The pixel of previous whose center ray sees point, if any.
+static const SurfaceSample* previousSurface(const Frame& previous,
+                                            const Vec3& point,
+                                            unsigned& x, unsigned& y) {
+  const auto projected = previous.rayGenerator.project(point);
+  if (!projected) {
+    return nullptr;
+  }
+  const auto px = std::floor(projected->first);
+  const auto py = std::floor(projected->second);
+  const auto& region = previous.surfaces.region();
+  if (!(px >= region.x0 && px < region.x1 && py >= region.y0 &&
+        py < region.y1)) {
+    return nullptr;
+  }
+  x = px;
+  y = py;
+  return &previous.surfaces(x, y);
+}
+}  // namespace
+
+unsigned reproject(const Frame* previous, const SurfaceBuffer& surfaces,
+                   const Block& block, const ReuseOptions& options,
+                   Progress& progress, SampleTargets& targets) {
+  auto reused = 0U;
+  for (auto y = block.y0; y < block.y1; ++y) {
+    for (auto x = block.x0; x < block.x1; ++x) {
+      auto& pixel = progress(x, y);
+      pixel = {};
+      targets(x, y) = options.samples;
+      const auto& surface = surfaces(x, y);
+      if (!previous || surface.primitive == SurfaceSample::kMiss ||
+          surface.specular) {
+        continue;
+      }
+      unsigned px, py;
+      const auto* seen = previousSurface(*previous, surface.position, px, py);
+      if (!seen || seen->primitive == SurfaceSample::kMiss || seen->specular) {
+        continue;
+      }
+      // Disoccluded: the previous view saw something else in front.
+      const auto& eye = previous->rayGenerator.position;
+      const auto depth = (surface.position - eye).norm();
+      if (std::abs((seen->position - eye).norm() - depth) >
+          kMatchTolerance * depth) {
+        continue;
+      }
+      const auto& history = previous->progress(px, py);
+      if (history.samples == 0) {
+        continue;
+      }
+      const auto weight = std::min(history.samples, options.maxHistory);
+      // Nothing to carry over, e.g. as reuseSamples leaves no history.
+      if (weight == 0) {
+        continue;
+      }
+      pixel.sum = history.sum * (float(weight) / history.samples);
+      pixel.samples = weight;
+      targets(x, y) = weight + options.reuseSamples;
+      ++reused;
+    }
+  }
+  return reused;
+}
+}  // namespace tinyrt
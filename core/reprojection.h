@@ -0,0 +1,77 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include "core/camera.h"
+#include "core/checkpoint.h"
+#include "core/framebuffer.h"
+
+namespace tinyrt {
+// What the ray through a pixel's center hits first.
+struct SurfaceSample {
+  static constexpr uint32_t kMiss = std::numeric_limits<uint32_t>::max();
+
+  Vec3 position;
+  // kMiss if the ray escapes.
+  uint32_t primitive = kMiss;
+  // The surface's shading depends on the view direction, e.g. glossy,
+  // mirror or glass, so its radiance can't be carried to another view.
+  bool specular = false;
+};
+
+using SurfaceBuffer = TiledImage<SurfaceSample>;
+// Samples a pixel should end up with.
+using SampleTargets = TiledImage<uint32_t>;
+
+// A frame of a camera sequence, as the next one reuses it.
+struct Frame {
+  Camera::RayGenerator rayGenerator;
+  SurfaceBuffer surfaces;
+  Progress progress;
+};
+
+struct ReuseOptions {
+  // New samples for pixels that reuse the previous frame, and for the others.
+  unsigned reuseSamples;
+  unsigned samples;
+  // Most samples the reused radiance counts for. Keeping this at samples -
+  // reuseSamples makes reuse an exponential moving average that keeps the
+  // noise of a samples-sample render and forgets old frames at the rate of
+  // reuseSamples / samples.
+  unsigned maxHistory;
+};
+
+// Starts progress for the pixels of block in a new frame whose primary hits
+// are surfaces; previous is null for the first frame. A pixel whose hit the
+// previous frame saw at the same place, on a surface that isn't specular,
+// starts from the previous frame's average there, weighted as up to
+// maxHistory samples, and is given a target of reuseSamples more.
+// Disoccluded, specular and background pixels, and all of them if maxHistory
+// is 0, start empty with a target of samples. Returns how many pixels reuse.
+unsigned reproject(const Frame* previous, const SurfaceBuffer& surfaces,
+                   const Block& block, const ReuseOptions& options,
+                   Progress& progress, SampleTargets& targets);
+}  // namespace tinyrt
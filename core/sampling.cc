@@ -0,0 +1,110 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/sampling.h"
+
+#include <algorithm>
+
+#include "core/simd_math.h"
+#include "core/simd_vec3.h"
+
+namespace tinyrt {
+namespace {
+template <typename TVec3>
+void store(const TVec3& samples, const size_t lanes, Vec3* out) {
+  for (auto k = 0UL; k < lanes; ++k) {
+    out[k] = Vec3(samples->x.v[k], samples->y.v[k], samples->z.v[k]);
+  }
+}
+}  // namespace
+
+template <typename TVec3>
+void sampleHemisphere(const Random& random, const uint64_t block,
+                      const size_t n, Vec3* out) {
+  using float_t = typename TVec3::float_t;
+  static constexpr auto kWidth = kSimdWidth<TVec3>;
+  static const float_t kZero = 0.f;
+  static const float_t kOne = 1.f;
+  for (auto i = 0UL; i < n; i += kWidth) {
+    const auto u = random.uniforms<float_t>(block + i);
+    const auto r = std::sqrt(u[0]);
+    const auto sinCos = sinCos2PiApprox(u[1]);
+    const TVec3 samples(r * sinCos.second,
+                        std::sqrt(tinyrt::max(kOne - u[0], kZero)),
+                        r * sinCos.first);
+    store(samples, std::min(kWidth, n - i), out + i);
+  }
+}
+
+template <>
+void sampleHemisphere<Vec3>(const Random& random, const uint64_t block,
+                            const size_t n, Vec3* out) {
+  for (auto k = 0UL; k < n; ++k) {
+    const auto u = random.uniforms(block + k);
+    const auto r = ::sqrtf(u[0]);
+    const auto theta = 2 * M_PI * u[1];
+    out[k] = Vec3(r * ::cosf(theta), ::sqrtf(std::max(0.f, 1.f - u[0])),
+                  r * ::sinf(theta));
+  }
+}
+
+template <typename TVec3>
+void sampleBox(const Random& random, const uint64_t block, const size_t n,
+               const BoundingBox& aabb, Vec3* out) {
+  static constexpr auto kWidth = kSimdWidth<TVec3>;
+  const auto& min = aabb.min();
+  const auto& size = aabb.size();
+  for (auto i = 0UL; i < n; i += kWidth) {
+    const auto u = random.uniforms<typename TVec3::float_t>(block + i);
+    const TVec3 samples(u[0] * size->x + min->x, u[1] * size->y + min->y,
+                        u[2] * size->z + min->z);
+    store(samples, std::min(kWidth, n - i), out + i);
+  }
+}
+
+template <>
+void sampleBox<Vec3>(const Random& random, const uint64_t block,
+                     const size_t n, const BoundingBox& aabb, Vec3* out) {
+  for (auto k = 0UL; k < n; ++k) {
+    const auto u = random.uniforms(block + k);
+    out[k] = aabb.min() + aabb.size() * Vec3(u[0], u[1], u[2]);
+  }
+}
+
+/* explicit */ template void sampleHemisphere<AVX2Vec3>(
+    const Random& random, const uint64_t block, const size_t n, Vec3* out);
+
+/* explicit */ template void sampleHemisphere<AVX512Vec3>(
+    const Random& random, const uint64_t block, const size_t n, Vec3* out);
+
+/* explicit */ template void sampleBox<AVX2Vec3>(const Random& random,
+                                                 const uint64_t block,
+                                                 const size_t n,
+                                                 const BoundingBox& aabb,
+                                                 Vec3* out);
+
+/* explicit */ template void sampleBox<AVX512Vec3>(const Random& random,
+                                                   const uint64_t block,
+                                                   const size_t n,
+                                                   const BoundingBox& aabb,
+                                                   Vec3* out);
+}  // namespace tinyrt
@@ -22,42 +22,29 @@
 
 #pragma once
 
-#include <array>
-#include <iostream>
-
 #include "core/bounding_box.h"
-#include "core/material.h"
+#include "core/random.h"
 #include "core/vec3.h"
 
 namespace tinyrt {
-struct Vertex final {
-  const Vec3& coord;
-  const Vec3* texcoord;
-  const Vec3& normal;
-
-  Vertex(const Vec3& coord, const Vec3* texcoord, const Vec3& normal)
-      : coord(coord), texcoord(texcoord), normal(normal) {}
-
-  friend std::ostream& operator<<(std::ostream& os, const Vertex& vertex);
-};
-
-class Triangle final {
- public:
-  Triangle(const std::array<Vertex, 3>& vertices, const Material& material);
-  Triangle(const Triangle&) = delete;
-  Triangle& operator=(const Triangle&) = delete;
-
-  inline const Vertex& a() const { return vertices_[0]; }
-  inline const Vertex& b() const { return vertices_[1]; }
-  inline const Vertex& c() const { return vertices_[2]; }
-  inline const std::array<Vertex, 3>& vertices() const { return vertices_; }
-  inline const Material& material() const { return material_; }
-  BoundingBox aabb() const;
-
-  friend std::ostream& operator<<(std::ostream& os, const Triangle& triangle);
-
- private:
-  const std::array<Vertex, 3> vertices_;
-  const Material& material_;
-};
+// Batch sampling kernels, vectorized with TVec3, the SIMD type of the render
+// pipeline, or scalar for Vec3. Sample k of a batch reads block + k of the
+// random stream, so the results do not depend on the SIMD width.
+
+// Writes n cosine-weighted directions of the hemisphere around +y to out.
+template <typename TVec3>
+void sampleHemisphere(const Random& random, const uint64_t block,
+                      const size_t n, Vec3* out);
+template <>
+void sampleHemisphere<Vec3>(const Random& random, const uint64_t block,
+                            const size_t n, Vec3* out);
+
+// Writes n uniformly distributed points of aabb, e.g. of an area light, to
+// out.
+template <typename TVec3>
+void sampleBox(const Random& random, const uint64_t block, const size_t n,
+               const BoundingBox& aabb, Vec3* out);
+template <>
+void sampleBox<Vec3>(const Random& random, const uint64_t block,
+                     const size_t n, const BoundingBox& aabb, Vec3* out);
 }  // namespace tinyrt
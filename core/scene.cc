@@ -24,36 +24,114 @@
 
 #include <algorithm>
 #include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "util/log.h"
 
 namespace tinyrt {
 namespace {
-static Vertex makeVertex(const std::vector<Vec3>& vertices,
-                         const std::vector<Vec3>& texcoords,
-                         const std::vector<Vec3>& normals,
-                         const std::array<int32_t, 3>& indices) {
-  return Vertex(
-      vertices[indices[VERTEX]],
-      indices[TEXCOORD] >= 0 ? &texcoords[indices[TEXCOORD]] : nullptr,
-      normals[indices[NORMAL]]);
+struct CornerHash {
+  size_t operator()(const std::array<int32_t, 3>& corner) const {
+    size_t hash = 0;
+    for (const auto index : corner) {
+      hash = hash * 31 + std::hash<int32_t>()(index);
+    }
+    return hash;
+  }
+};
+
+// Turns OBJ style corners, which index each attribute separately, into one
+// index per distinct (vertex, texcoord, normal) combination.
+static Mesh makeMesh(const std::vector<Vec3>& vertices,
+                     const std::vector<Vec3>& texcoords,
+                     const std::vector<Vec3>& normals,
+                     const std::vector<triangle_indices_t>& triangles) {
+  Mesh mesh;
+  mesh.indices.reserve(triangles.size() * 3);
+  mesh.materialIds.reserve(triangles.size());
+  std::unordered_map<std::array<int32_t, 3>, uint32_t, CornerHash> remap;
+  for (const auto& triangle : triangles) {
+    for (const auto& corner : triangle.first) {
+      const auto [it, inserted] =
+          remap.try_emplace(corner, mesh.numVertices());
+      if (inserted) {
+        mesh.addVertex(
+            vertices[corner[VERTEX]], normals[corner[NORMAL]],
+            corner[TEXCOORD] >= 0 ? &texcoords[corner[TEXCOORD]] : nullptr);
+      }
+      mesh.indices.push_back(it->second);
+    }
+    mesh.materialIds.push_back(triangle.second);
+  }
+  return mesh;
 }
 
-static std::vector<std::unique_ptr<Triangle>> makeTriangles(
-    const std::vector<Vec3>& vertices, const std::vector<Vec3>& texcoords,
-    const std::vector<Vec3>& normals, const std::vector<Material>& materials,
-    const std::vector<triangle_indices_t>& triangles) {
-  std::vector<std::unique_ptr<Triangle>> out;
-  std::transform(
-      triangles.begin(), triangles.end(), std::back_inserter(out),
-      [&](const triangle_indices_t& indices) {
-        std::array<Vertex, 3> triangleVertices{
-            makeVertex(vertices, texcoords, normals, indices.first[0]),
-            makeVertex(vertices, texcoords, normals, indices.first[1]),
-            makeVertex(vertices, texcoords, normals, indices.first[2]),
-        };
-        return std::make_unique<Triangle>(triangleVertices,
-                                          materials[indices.second]);
-      });
-  return out;
+// Throws unless mesh is well formed.
+static Mesh validateMesh(Mesh mesh, const size_t numMaterials) {
+  const auto numPositions = mesh.positions.empty()
+                                ? mesh.quantizedPositions.size()
+                                : mesh.positions.size();
+  if (mesh.indices.size() != mesh.size() * 3 ||
+      numPositions != mesh.numVertices() ||
+      (!mesh.texcoords.empty() &&
+       mesh.texcoords.size() != mesh.numVertices())) {
+    throw std::invalid_argument("Inconsistent mesh buffers!");
+  }
+  for (const auto index : mesh.indices) {
+    if (index >= mesh.numVertices()) {
+      throw std::out_of_range("Vertex index out-of-range!");
+    }
+  }
+  for (const auto materialId : mesh.materialIds) {
+    if (materialId >= numMaterials) {
+      throw std::out_of_range("Material index out-of-range!");
+    }
+  }
+  return mesh;
+}
+
+// Validates mesh, then optimizes and quantizes it as options ask.
+static Mesh finishMesh(Mesh mesh, const size_t numMaterials,
+                       const MeshOptions& options,
+                       MeshOptimization& optimization) {
+  if (!mesh.quantizedPositions.empty()) {
+    throw std::invalid_argument("Mesh is already quantized!");
+  }
+  mesh = validateMesh(std::move(mesh), numMaterials);
+  if (options.optimize) {
+    optimization = optimizeMesh(mesh);
+  } else {
+    optimization.before = optimization.after = {mesh.numVertices(),
+                                                 mesh.size()};
+  }
+  // Quantize last, so that welding sees the exact positions.
+  if (options.quantizePositions) {
+    mesh.quantizePositions();
+  }
+  return mesh;
+}
+
+// One light per emissive material, bounding all of its triangles.
+static std::vector<light_t> emissiveLights(
+    const Mesh& mesh, const std::vector<Material>& materials) {
+  std::vector<light_t> lights;
+  std::vector<int32_t> lightOf(materials.size(), -1);
+  for (auto primitive = 0U; primitive < mesh.size(); ++primitive) {
+    const auto materialId = mesh.materialIds[primitive];
+    if (!materials[materialId].light()) {
+      continue;
+    }
+    if (lightOf[materialId] < 0) {
+      lightOf[materialId] = lights.size();
+      lights.emplace_back(BoundingBox(), materialId);
+    }
+    auto& bounds = lights[lightOf[materialId]].first;
+    for (auto corner = 0U; corner < 3; ++corner) {
+      bounds.add(mesh.position(primitive, corner));
+    }
+  }
+  return lights;
 }
 
 static std::vector<std::unique_ptr<Light>> makeLights(
@@ -63,43 +141,156 @@ static std::vector<std::unique_ptr<Light>> makeLights(
   std::transform(lights.begin(), lights.end(), std::back_inserter(out),
                  [&](const light_t& light) {
                    return std::make_unique<Light>(light.first,
-                                                  materials[light.second]);
+                                                  materials.at(light.second));
                  });
   return out;
 }
 
-static BoundingBox computeAABB(
-    const std::vector<std::unique_ptr<Triangle>>& triangles) {
-  BoundingBox aabb;
-  for (const auto& triangle : triangles) {
-    for (const auto& vertex : triangle->vertices()) {
-      aabb.add(vertex.coord);
+static std::vector<Material> selectKernels(std::vector<Material> materials) {
+  for (auto& material : materials) {
+    material.kernel = material.selectKernel();
+  }
+  return materials;
+}
+
+// Adds path to textures, or returns -1 with a warning if it cannot be read,
+// e.g. a missing file or an unsupported format, so that the scene renders
+// without it.
+static int32_t addTexture(const std::string& path, TextureCache& textures) {
+  try {
+    return textures.add(path);
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Ignoring texture " << path << ": " << e.what();
+    return -1;
+  }
+}
+
+// Adds the textures that materials index, which are then made to index
+// textures instead.
+static void addTextures(std::vector<Material>& materials,
+                        const std::vector<std::string>& paths,
+                        TextureCache& textures) {
+  for (const auto& material : materials) {
+    if (material.diffuseTexture >= int32_t(paths.size())) {
+      throw std::out_of_range("Texture index out-of-range!");
+    }
+  }
+  std::vector<int32_t> ids;
+  ids.reserve(paths.size());
+  for (const auto& path : paths) {
+    ids.push_back(addTexture(path, textures));
+  }
+  for (auto& material : materials) {
+    if (material.diffuseTexture >= 0) {
+      material.diffuseTexture = ids[material.diffuseTexture];
     }
   }
+}
+
+static BoundingBox computeAABB(const Mesh& mesh) {
+  BoundingBox aabb;
+  for (const auto index : mesh.indices) {
+    aabb.add(mesh.vertexPosition(index));
+  }
   return aabb;
 }
 }  // namespace
 
-Scene::Scene(std::vector<Vec3> vertices, std::vector<Vec3> texcoords,
-             std::vector<Vec3> normals, std::vector<Material> materials,
+Scene::Scene(const std::vector<Vec3>& vertices,
+             const std::vector<Vec3>& texcoords,
+             const std::vector<Vec3>& normals, std::vector<Material> materials,
+             const std::vector<std::string>& textures,
              const std::vector<triangle_indices_t>& triangles,
-             const std::vector<light_t>& lights)
-    : vertices_(std::move(vertices)),
-      texcoords_(std::move(texcoords)),
-      normals_(std::move(normals)),
-      materials_(std::move(materials)),
-      triangles_(makeTriangles(vertices_, texcoords_, normals_, materials_,
-                               triangles)),
+             const std::vector<light_t>& lights,
+             const MeshOptions& meshOptions)
+    : materials_(selectKernels(std::move(materials))),
+      mesh_(finishMesh(makeMesh(vertices, texcoords, normals, triangles),
+                       materials_.size(), meshOptions, meshOptimization_)),
       lights_(makeLights(materials_, lights)),
-      aabb_(computeAABB(triangles_)) {}
+      aabb_(computeAABB(mesh_)) {
+  addTextures(materials_, textures, textures_);
+}
+
+Scene::Scene(Mesh mesh, std::vector<Material> materials,
+             const MeshOptions& meshOptions)
+    : materials_(selectKernels(std::move(materials))),
+      mesh_(finishMesh(std::move(mesh), materials_.size(), meshOptions,
+                       meshOptimization_)),
+      lights_(makeLights(materials_, emissiveLights(mesh_, materials_))),
+      aabb_(computeAABB(mesh_)) {}
 
-const std::vector<std::unique_ptr<Triangle>>& Scene::triangles() const {
-  return triangles_;
+Scene::Scene(Mesh mesh, std::vector<Material> materials,
+             const std::vector<std::string>& textures,
+             const std::vector<light_t>& lights,
+             const MeshOptimization& meshOptimization)
+    : materials_(selectKernels(std::move(materials))),
+      meshOptimization_(meshOptimization),
+      mesh_(validateMesh(std::move(mesh), materials_.size())),
+      lights_(makeLights(materials_, lights)),
+      aabb_(computeAABB(mesh_)) {
+  addTextures(materials_, textures, textures_);
 }
 
+MaterialMask Scene::replaceMaterials(std::vector<Material> materials,
+                                     const std::vector<std::string>& textures) {
+  if (materials.size() != materials_.size()) {
+    throw std::invalid_argument("Material count changed!");
+  }
+  for (auto id = 0U; id < materials.size(); ++id) {
+    const auto& material = materials[id];
+    if (material.diffuseTexture >= int32_t(textures.size())) {
+      throw std::out_of_range("Texture index out-of-range!");
+    }
+    // Lights are grouped as the loader made them, e.g. one per OBJ usemtl
+    // block, which the scene does not keep.
+    if (material.light() != materials_[id].light()) {
+      throw std::invalid_argument("Emissive materials changed!");
+    }
+  }
+  // Nothing below throws, so the scene is either left as it was or fully
+  // updated.
+  for (auto& material : materials) {
+    if (material.diffuseTexture >= 0) {
+      const auto& path = textures[material.diffuseTexture];
+      const auto& known = textures_.paths();
+      const auto found = std::find(known.begin(), known.end(), path);
+      material.diffuseTexture = found != known.end()
+                                    ? found - known.begin()
+                                    : addTexture(path, textures_);
+    }
+  }
+  materials = selectKernels(std::move(materials));
+  MaterialMask changed = 0;
+  auto lightsChanged = false;
+  for (auto id = 0U; id < materials.size(); ++id) {
+    const auto& material = materials[id];
+    if (material == materials_[id]) {
+      continue;
+    }
+    changed |= materialBit(id);
+    // Lights read their material's emission as they go, so they need no
+    // rebuilding.
+    lightsChanged |= material.light();
+    materials_[id] = material;
+  }
+  return lightsChanged ? ~MaterialMask{0} : changed;
+}
+
+const Mesh& Scene::mesh() const { return mesh_; }
+
+const std::vector<Material>& Scene::materials() const { return materials_; }
+
 const std::vector<std::unique_ptr<Light>>& Scene::lights() const {
   return lights_;
 }
 
 const BoundingBox& Scene::aabb() const { return aabb_; }
+
+const MeshOptimization& Scene::meshOptimization() const {
+  return meshOptimization_;
+}
+
+TextureCache& Scene::textures() { return textures_; }
+
+const TextureCache& Scene::textures() const { return textures_; }
 }  // namespace tinyrt
@@ -23,11 +23,15 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "core/bounding_box.h"
 #include "core/light.h"
-#include "core/triangle.h"
+#include "core/material.h"
+#include "core/mesh.h"
+#include "core/mesh_optimizer.h"
+#include "core/texture_cache.h"
 #include "core/vec3.h"
 
 namespace tinyrt {
@@ -39,26 +43,67 @@ enum Index { VERTEX, TEXCOORD, NORMAL };
 
 class Scene final {
  public:
-  Scene(std::vector<Vec3> vertices, std::vector<Vec3> texcoords,
-        std::vector<Vec3> normals, std::vector<Material> materials,
+  // Only reads the vertex arrays; the mesh keeps its own compact copy.
+  // textures are the files Material::diffuseTexture indexes. Those that
+  // cannot be read are left out with a warning, along with their maps.
+  Scene(const std::vector<Vec3>& vertices, const std::vector<Vec3>& texcoords,
+        const std::vector<Vec3>& normals, std::vector<Material> materials,
+        const std::vector<std::string>& textures,
         const std::vector<triangle_indices_t>& triangles,
-        const std::vector<light_t>& lights);
+        const std::vector<light_t>& lights,
+        const MeshOptions& meshOptions = {});
+  // Takes a mesh that is already indexed, e.g. read from a binary format.
+  // Lights are made from the triangles of emissive materials, one per
+  // material.
+  Scene(Mesh mesh, std::vector<Material> materials,
+        const MeshOptions& meshOptions = {});
+  // Takes a mesh that is already optimized and quantized as wanted, e.g. from
+  // SceneCache, along with its lights; the mesh is only validated.
+  Scene(Mesh mesh, std::vector<Material> materials,
+        const std::vector<std::string>& textures,
+        const std::vector<light_t>& lights,
+        const MeshOptimization& meshOptimization);
   Scene(const Scene&) = delete;
   Scene& operator=(const Scene&) = delete;
 
-  const std::vector<std::unique_ptr<Triangle>>& triangles() const;
+  const Mesh& mesh() const;
+  const std::vector<Material>& materials() const;
   const std::vector<std::unique_ptr<Light>>& lights() const;
   const BoundingBox& aabb() const;
+  // Vertex and triangle counts before and after optimizeMesh().
+  const MeshOptimization& meshOptimization() const;
+  // Texture lookups are thread-safe; the non-const overload is for tuning.
+  TextureCache& textures();
+  const TextureCache& textures() const;
+
+  // Swaps in an edited set of materials in place, leaving the geometry, and
+  // so any acceleration structure built over it, as it is. materials must
+  // be as many as before, with diffuseTexture indexing textures; files new
+  // to textures() are added, known ones are not read again, and those that
+  // cannot be read are left out as when loading. Emissive materials must
+  // stay emissive and the others not, as that would move lights. Throws
+  // std::invalid_argument otherwise, or std::out_of_range for a bad texture
+  // index, before changing anything. Must not run during a render.
+  //
+  // Returns the materials that changed. A changed light alters the direct
+  // light at every hit, so then all materials count as changed.
+  MaterialMask replaceMaterials(std::vector<Material> materials,
+                                const std::vector<std::string>& textures);
+
+  const Material& material(const uint32_t primitive) const {
+    return materials_[mesh_.materialIds[primitive]];
+  }
 
   friend std::ostream& operator<<(std::ostream& os, const Scene& scene);
 
  private:
-  const std::vector<Vec3> vertices_;
-  const std::vector<Vec3> texcoords_;
-  const std::vector<Vec3> normals_;
-  const std::vector<Material> materials_;
-  const std::vector<std::unique_ptr<Triangle>> triangles_;
+  // Replaced only in place, as lights_ refer to them.
+  std::vector<Material> materials_;
+  // Filled in while building mesh_.
+  MeshOptimization meshOptimization_;
+  const Mesh mesh_;
   const std::vector<std::unique_ptr<Light>> lights_;
   const BoundingBox aabb_;
+  TextureCache textures_;
 };
 }  // namespace tinyrt
@@ -0,0 +1,279 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/scene_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "core/obj.h"
+#include "util/hash.h"
+#include "util/mapped_file.h"
+
+namespace tinyrt {
+namespace {
+constexpr char kMagic[8] = "TRSCENE";
+// Bump whenever the layout below or of the stored types changes.
+constexpr uint32_t kVersion = 2;
+// Sections start on cache line boundaries.
+constexpr size_t kAlignment = 64;
+
+static_assert(std::is_trivially_copyable_v<Vec3> &&
+              std::is_trivially_copyable_v<Material>);
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  // Guards against reading a cache written by a differently built binary.
+  uint32_t vec3Size;
+  uint32_t materialSize;
+  uint32_t numLights;
+  uint64_t key;
+  uint64_t numPositions;
+  uint64_t numQuantizedPositions;
+  uint64_t numNormals;
+  uint64_t numTexcoords;
+  uint64_t numTriangles;
+  uint64_t numMaterials;
+  // Texture paths, each followed by a NUL.
+  uint64_t textureBytes;
+  float quantizationOrigin[3];
+  float quantizationScale[3];
+  uint64_t before[2];
+  uint64_t after[2];
+};
+
+struct StoredLight {
+  float min[3];
+  float max[3];
+  uint32_t material;
+};
+
+static size_t align(const size_t offset) {
+  return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+static void toFloats(const Vec3& vec, float (&out)[3]) {
+  for (auto i = 0; i < 3; ++i) {
+    out[i] = vec[i];
+  }
+}
+
+static Vec3 fromFloats(const float (&in)[3]) {
+  return Vec3(in[0], in[1], in[2]);
+}
+
+// Hashes the material libraries an OBJ file loads, in order, as
+// Obj::materialLibraries() lists them for hot reloading.
+static uint64_t hashMaterialLibraries(const std::string& path, uint64_t hash) {
+  for (const auto& library : Obj::materialLibraries(path)) {
+    hash = hashBytes(library.string(), hash);
+    if (std::filesystem::exists(library)) {
+      const MappedFile contents(library);
+      hash = hashBytes(contents.contents(), hash);
+    }
+  }
+  return hash;
+}
+
+// Bounds checked reads of the sections that follow the header.
+class Reader final {
+ public:
+  explicit Reader(const std::string_view data) : data_(data) {}
+
+  template <typename T>
+  void read(std::vector<T>& out, const size_t count) {
+    offset_ = align(offset_);
+    if (count > (data_.size() - std::min(offset_, data_.size())) / sizeof(T)) {
+      throw std::runtime_error("Truncated scene cache");
+    }
+    out.resize(count);
+    std::memcpy(out.data(), data_.data() + offset_, count * sizeof(T));
+    offset_ += count * sizeof(T);
+  }
+
+ private:
+  const std::string_view data_;
+  size_t offset_ = sizeof(Header);
+};
+
+class Writer final {
+ public:
+  explicit Writer(std::ofstream& out) : out_(out) {}
+
+  template <typename T>
+  void write(const std::vector<T>& data) {
+    static const char kPadding[kAlignment] = {};
+    out_.write(kPadding, align(offset_) - offset_);
+    offset_ = align(offset_);
+    out_.write(reinterpret_cast<const char*>(data.data()),
+               data.size() * sizeof(T));
+    offset_ += data.size() * sizeof(T);
+  }
+
+ private:
+  std::ofstream& out_;
+  size_t offset_ = sizeof(Header);
+};
+}  // namespace
+
+SceneCache::SceneCache(const std::string& path,
+                       const MeshOptions& meshOptions)
+    : path_(path + ".tinyrt") {
+  const MappedFile file(path);
+  key_ = hashBytes(file.contents());
+  if (!path.ends_with(".ply") && !path.ends_with(".glb")) {
+    key_ = hashMaterialLibraries(path, key_);
+  }
+  const bool options[] = {meshOptions.optimize, meshOptions.quantizePositions};
+  key_ = hashBytes({reinterpret_cast<const char*>(options), sizeof(options)},
+                   key_);
+}
+
+std::unique_ptr<Scene> SceneCache::load() const {
+  if (!std::filesystem::exists(path_)) {
+    return nullptr;
+  }
+  const MappedFile file(path_);
+  const auto data = file.contents();
+  Header header;
+  if (data.size() < sizeof(header)) {
+    return nullptr;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.vec3Size != sizeof(Vec3) ||
+      header.materialSize != sizeof(Material) || header.key != key_) {
+    return nullptr;
+  }
+
+  Mesh mesh;
+  std::vector<Material> materials;
+  std::vector<StoredLight> storedLights;
+  std::vector<char> textureBytes;
+  Reader reader(data);
+  reader.read(mesh.positions, header.numPositions);
+  reader.read(mesh.quantizedPositions, header.numQuantizedPositions);
+  reader.read(mesh.normals, header.numNormals);
+  reader.read(mesh.texcoords, header.numTexcoords);
+  reader.read(mesh.indices, header.numTriangles * 3);
+  reader.read(mesh.materialIds, header.numTriangles);
+  reader.read(materials, header.numMaterials);
+  reader.read(storedLights, header.numLights);
+  reader.read(textureBytes, header.textureBytes);
+  mesh.quantizationOrigin = fromFloats(header.quantizationOrigin);
+  mesh.quantizationScale = fromFloats(header.quantizationScale);
+
+  std::vector<std::string> textures;
+  for (auto begin = textureBytes.begin(); begin != textureBytes.end();) {
+    const auto end = std::find(begin, textureBytes.end(), '\0');
+    if (end == textureBytes.end()) {
+      return nullptr;
+    }
+    textures.emplace_back(begin, end);
+    begin = end + 1;
+  }
+  std::vector<light_t> lights;
+  lights.reserve(storedLights.size());
+  for (const auto& light : storedLights) {
+    lights.emplace_back(
+        BoundingBox(fromFloats(light.min), fromFloats(light.max)),
+        light.material);
+  }
+  const MeshOptimization optimization{
+      .before = {header.before[0], header.before[1]},
+      .after = {header.after[0], header.after[1]},
+  };
+  try {
+    return std::make_unique<Scene>(std::move(mesh), std::move(materials),
+                                   textures, lights, optimization);
+  } catch (const std::logic_error& e) {
+    throw std::runtime_error(std::string("Damaged scene cache: ") + e.what());
+  }
+}
+
+void SceneCache::store(const Scene& scene) const {
+  const auto& mesh = scene.mesh();
+  const auto& materials = scene.materials();
+  std::vector<StoredLight> lights;
+  for (const auto& light : scene.lights()) {
+    auto& stored = lights.emplace_back();
+    toFloats(light->aabb.min(), stored.min);
+    toFloats(light->aabb.max(), stored.max);
+    stored.material = &light->material - materials.data();
+  }
+  std::vector<char> textureBytes;
+  for (const auto& path : scene.textures().paths()) {
+    textureBytes.insert(textureBytes.end(), path.begin(), path.end());
+    textureBytes.push_back('\0');
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.vec3Size = sizeof(Vec3);
+  header.materialSize = sizeof(Material);
+  header.numLights = lights.size();
+  header.key = key_;
+  header.numPositions = mesh.positions.size();
+  header.numQuantizedPositions = mesh.quantizedPositions.size();
+  header.numNormals = mesh.normals.size();
+  header.numTexcoords = mesh.texcoords.size();
+  header.numTriangles = mesh.size();
+  header.numMaterials = materials.size();
+  header.textureBytes = textureBytes.size();
+  toFloats(mesh.quantizationOrigin, header.quantizationOrigin);
+  toFloats(mesh.quantizationScale, header.quantizationScale);
+  const auto& optimization = scene.meshOptimization();
+  header.before[0] = optimization.before.vertices;
+  header.before[1] = optimization.before.triangles;
+  header.after[0] = optimization.after.vertices;
+  header.after[1] = optimization.after.triangles;
+
+  // Written aside and renamed over the entry, so that readers never see a
+  // partial file.
+  const auto temporaryPath = path_ + ".tmp";
+  {
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    Writer writer(out);
+    writer.write(mesh.positions);
+    writer.write(mesh.quantizedPositions);
+    writer.write(mesh.normals);
+    writer.write(mesh.texcoords);
+    writer.write(mesh.indices);
+    writer.write(mesh.materialIds);
+    writer.write(materials);
+    writer.write(lights);
+    writer.write(textureBytes);
+    if (!out.flush()) {
+      throw std::runtime_error("Failed to write scene cache");
+    }
+  }
+  std::filesystem::rename(temporaryPath, path_);
+}
+}  // namespace tinyrt
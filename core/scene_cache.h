@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "core/scene.h"
+
+namespace tinyrt {
+// Binary snapshot of a fully built Scene, i.e. the optimized, compressed mesh
+// with its materials and lights, stored next to the scene file it came from.
+// Entries are keyed by a hash of the scene file, the OBJ material libraries it
+// references and the mesh options, so any change to them makes the entry
+// stale. Loading maps the snapshot and copies each array into place once,
+// with no parsing or mesh processing.
+class SceneCache final {
+ public:
+  // path is the scene file; hashes it and its dependencies.
+  SceneCache(const std::string& path, const MeshOptions& meshOptions);
+
+  // Returns null when there is no entry for this key. Throws
+  // std::runtime_error on a damaged entry.
+  std::unique_ptr<Scene> load() const;
+  // Replaces the entry with scene. Throws std::runtime_error on I/O errors.
+  void store(const Scene& scene) const;
+
+  const std::string& path() const { return path_; }
+  // Hash of the scene file, its dependencies and the mesh options.
+  uint64_t key() const { return key_; }
+
+ private:
+  std::string path_;
+  uint64_t key_;
+};
+}  // namespace tinyrt
@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/scene_loader.h"
+
+#include <exception>
+#include <utility>
+#include <string_view>
+
+#include "core/glb.h"
+#include "core/obj.h"
+#include "core/ply.h"
+#include "core/scene_cache.h"
+#include "util/log.h"
+
+namespace tinyrt {
+std::unique_ptr<Scene> parseScene(const std::string& path,
+                                  const MeshOptions& meshOptions) {
+  const auto hasExtension = [&](const std::string_view extension) {
+    return path.ends_with(extension);
+  };
+  if (hasExtension(".ply")) {
+    Ply ply(path);
+    LOG(INFO) << "PLY file loaded: " << ply;
+    return ply.toScene(meshOptions);
+  }
+  if (hasExtension(".glb")) {
+    Glb glb(path);
+    LOG(INFO) << "GLB file loaded: " << glb;
+    return glb.toScene(meshOptions);
+  }
+  Obj obj(path);
+  LOG(INFO) << "OBJ file loaded: " << obj;
+  return std::move(obj).moveToScene(meshOptions);
+}
+
+std::unique_ptr<Scene> loadScene(const std::string& path,
+                                 const MeshOptions& meshOptions,
+                                 const bool useCache) {
+  if (!useCache) {
+    return parseScene(path, meshOptions);
+  }
+  const SceneCache cache(path, meshOptions);
+  try {
+    if (auto scene = cache.load()) {
+      LOG(INFO) << "Scene cache loaded: " << cache.path();
+      return scene;
+    }
+  } catch (const std::exception& e) {
+    LOG(WARNING) << e.what() << ", rebuilding " << cache.path();
+  }
+  auto scene = parseScene(path, meshOptions);
+  try {
+    cache.store(*scene);
+    LOG(INFO) << "Scene cache written: " << cache.path();
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Scene cache not written: " << e.what();
+  }
+  return scene;
+}
+}  // namespace tinyrt
@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/sequence.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#include "core/camera.h"
+#include "core/framebuffer.h"
+#include "core/image_writer.h"
+#include "core/reprojection.h"
+#include "util/async.h"
+#include "util/log.h"
+
+namespace tinyrt {
+void renderSequence(const std::vector<Job>& frames,
+                    const unsigned reuseSamples, const Scene& scene,
+                    const Renderer& renderer) {
+  for (const auto& job : frames) {
+    if (job.preview || job.bandRows > 0 || !job.checkpointPath.empty() ||
+        job.rasterSamples > 0) {
+      throw std::runtime_error(
+          "Sequence frames cannot have previews, bands, checkpoints or "
+          "rasterized primary hits: " +
+          job.outPath);
+    }
+  }
+  std::unique_ptr<Frame> previous;
+  for (auto index = 0U; index < frames.size(); ++index) {
+    const auto& job = frames[index];
+    const auto region = job.region();
+    const auto begin = std::chrono::steady_clock::now();
+    std::unique_ptr<Frame> current(new Frame{
+        Camera(job.position, job.direction, job.up, job.fov)
+            .adapt(job.width, job.height),
+        SurfaceBuffer(job.width, job.height, region),
+        Progress(job.width, job.height, region),
+    });
+    Framebuffer result(job.width, job.height, region);
+    SampleTargets targets(job.width, job.height, region);
+    ImageWriter writer(job.outPath, job.width, job.height, region);
+    const auto newSamples = std::clamp(reuseSamples, 1U, job.samples);
+    const ReuseOptions reuse{
+        .reuseSamples = newSamples,
+        .samples = job.samples,
+        .maxHistory = job.samples - newSamples,
+    };
+    TraceOptions options{
+        .directRays = std::max(job.passSamples, 1U),
+        .indirectRays = 1,
+        .shadowRays = 1,
+    };
+    // Fresh noise every frame, or reuse would keep averaging the same.
+    const uint32_t seed = job.seed + index;
+    std::atomic_uint reused = 0;
+    Async::submitN(
+        [&](const unsigned tile) {
+          const auto pixels = result.tile(tile);
+          renderer.renderSurfaces(scene, current->rayGenerator, pixels,
+                                  current->surfaces);
+          reused += reproject(previous.get(), current->surfaces, pixels,
+                              reuse, current->progress, targets);
+          for (auto done = 0U; done < job.samples;
+               done += options.directRays) {
+            renderer.renderAdaptivePass(scene, current->rayGenerator, options,
+                                        seed, pixels, targets,
+                                        current->progress, result);
+          }
+          writer.submit(result, pixels);
+        },
+        result.numTiles());
+    writer.finish();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - begin;
+    LOG(INFO) << "Frame " << index + 1 << "/" << frames.size() << " done, "
+              << reused * 100.f /
+                     ((region.x1 - region.x0) * (region.y1 - region.y0))
+              << "% of pixels reused, " << elapsed.count() << "s.";
+    previous = std::move(current);
+  }
+}
+}  // namespace tinyrt
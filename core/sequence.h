@@ -0,0 +1,41 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <vector>
+
+#include "core/job.h"
+#include "core/render.h"
+#include "core/scene.h"
+
+namespace tinyrt {
+// Renders frames, a camera path through the scene, in order. Each frame
+// starts from the previous one carried over through the primary hits, see
+// reproject(), so that pixels that stay in view only take reuseSamples new
+// samples while disoccluded and specular ones take all of theirs.
+//
+// Frames are traced in full; throws std::runtime_error for frames that ask
+// for previews, bands, checkpoints or rasterized primary hits.
+void renderSequence(const std::vector<Job>& frames, unsigned reuseSamples,
+                    const Scene& scene, const Renderer& renderer);
+}  // namespace tinyrt
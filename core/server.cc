@@ -0,0 +1,129 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/server.h"
+
+#include <bit>
+#include <chrono>
+#include <exception>
+
+#include "core/obj.h"
+#include "core/scene_loader.h"
+#include "util/json.h"
+#include "util/log.h"
+
+namespace tinyrt {
+Server::Server(Job defaults, const int avx, const size_t capacity,
+               const bool useSceneCache, const size_t textureBudget)
+    : defaults_(std::move(defaults)),
+      avx_(avx),
+      useSceneCache_(useSceneCache),
+      textureBudget_(textureBudget),
+      scenes_(capacity) {}
+
+std::string Server::handle(const std::string_view request) {
+  try {
+    const auto begin = std::chrono::steady_clock::now();
+    const auto job = parseJob(Json::parse(request), defaults_);
+    bool cached;
+    auto& loaded = load(job, cached);
+    auto view = job;
+    view.outPath.clear();
+    if (auto key = jobJson(view); key != loaded.retained.view) {
+      loaded.retained = {
+          .view = std::move(key),
+          .image = nullptr,
+          .touched = {},
+      };
+    }
+    render(job, *loaded.scene, *loaded.renderer, &loaded.retained);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - begin;
+    return "{\"ok\":true,\"out\":" + quote(job.outPath) +
+           ",\"cached\":" + (cached ? "true" : "false") +
+           ",\"seconds\":" + std::to_string(elapsed.count()) + "}";
+  } catch (const std::exception& e) {
+    LOG(ERROR) << "Job failed: " << e.what();
+    return "{\"ok\":false,\"error\":" + quote(e.what()) + "}";
+  }
+}
+
+Server::Loaded& Server::load(const Job& job, bool& cached) {
+  const auto key =
+      job.scenePath + (job.meshOptions.quantizePositions ? " q" : "");
+  const auto modified = std::filesystem::last_write_time(job.scenePath);
+  auto* loaded = scenes_.find(key);
+  cached = loaded && loaded->modified == modified && reloadMaterials(*loaded);
+  if (cached) {
+    return *loaded;
+  }
+  // Let go of a stale copy before loading its replacement.
+  scenes_.erase(key);
+  auto scene = loadScene(job.scenePath, job.meshOptions, useSceneCache_);
+  LOG(INFO) << "Scene created: " << *scene;
+  scene->textures().setBudget(textureBudget_);
+  auto renderer = createRenderer(avx_);
+  renderer->initialize(*scene);
+  file_times_t libraries;
+  if (!job.scenePath.ends_with(".ply") && !job.scenePath.ends_with(".glb")) {
+    for (auto& library : Obj::materialLibraries(job.scenePath)) {
+      const auto libraryModified = std::filesystem::last_write_time(library);
+      libraries.emplace_back(std::move(library), libraryModified);
+    }
+  }
+  return scenes_.insert(key, {
+                                 .modified = modified,
+                                 .libraries = std::move(libraries),
+                                 .scene = std::move(scene),
+                                 .renderer = std::move(renderer),
+                                 .retained = {},
+                             });
+}
+
+bool Server::reloadMaterials(Loaded& loaded) {
+  try {
+    auto edited = false;
+    std::vector<std::filesystem::path> paths;
+    for (auto& [path, modified] : loaded.libraries) {
+      const auto now = std::filesystem::last_write_time(path);
+      edited |= now != modified;
+      modified = now;
+      paths.push_back(path);
+    }
+    if (!edited) {
+      return true;
+    }
+    std::vector<std::string> textures;
+    auto materials = Obj::loadMaterials(paths, textures);
+    const auto changed =
+        loaded.scene->replaceMaterials(std::move(materials), textures);
+    loaded.retained.stale |= changed;
+    LOG(INFO) << "Materials reloaded, " << std::popcount(changed)
+              << " of 64 material bits changed.";
+    return true;
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Reloading the scene, its materials did not reload: "
+                 << e.what();
+    return false;
+  }
+}
+}  // namespace tinyrt
@@ -0,0 +1,93 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "core/job.h"
+#include "core/render.h"
+#include "core/scene.h"
+#include "util/lru_cache.h"
+
+namespace tinyrt {
+// Long-running mode for many small renders: takes one job per line, as a
+// JSON object, and answers each with a JSON line. Loaded scenes stay in
+// memory with their built renderers, so repeated jobs on a scene skip the
+// parse, the Scene construction and the kd-tree build.
+//
+// Requests are as parseJob() reads them, on top of defaults such as the
+// command line flags.
+//
+// For look-dev, edits to the material libraries of a loaded OBJ scene are
+// swapped into it in place, keeping its kd-tree, and a job for the same
+// view as the last one only renders again the tiles that hit edited
+// materials.
+class Server final {
+ public:
+  // Renders with the kernels for AVX version avx, see createRenderer(), and
+  // keeps up to capacity scenes loaded.
+  Server(Job defaults, int avx, size_t capacity, bool useSceneCache,
+         size_t textureBudget);
+
+  // Runs the job in request, returning the reply. Failed jobs get an error
+  // reply; the server carries on.
+  std::string handle(std::string_view request);
+
+ private:
+  using file_times_t =
+      std::vector<std::pair<std::filesystem::path,
+                            std::filesystem::file_time_type>>;
+
+  struct Loaded {
+    std::filesystem::file_time_type modified;
+    // Material libraries of an OBJ scene.
+    file_times_t libraries;
+    std::unique_ptr<Scene> scene;
+    std::unique_ptr<Renderer> renderer;
+    // The last render of the scene.
+    Retained retained;
+  };
+
+  // The scene of job with its renderer, from memory unless it is new or its
+  // file changed since it was loaded.
+  Loaded& load(const Job& job, bool& cached);
+
+  // Swaps edited material libraries of loaded's scene into it and marks
+  // what changed as stale in its last render. Returns false if the scene
+  // needs loading again instead, e.g. as materials were added or lights
+  // appeared.
+  bool reloadMaterials(Loaded& loaded);
+
+  const Job defaults_;
+  const int avx_;
+  const bool useSceneCache_;
+  const size_t textureBudget_;
+  LruCache<std::string, Loaded> scenes_;
+};
+}  // namespace tinyrt
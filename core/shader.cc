@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/shader.h"
+
+#include <algorithm>
+
+namespace tinyrt {
+void ShadingBatch::clear() {
+  intersections_.clear();
+  kernels_.clear();
+  for (auto dim = 0U; dim < 3; ++dim) {
+    position_[dim].clear();
+    normal_[dim].clear();
+    view_[dim].clear();
+    diffuse_[dim].clear();
+    specular_[dim].clear();
+    emission_[dim].clear();
+  }
+  specularExponent_.clear();
+}
+
+void ShadingBatch::add(const Intersection& intersection) {
+  const auto i = size();
+  if (i % kPadding == 0) {
+    for (auto dim = 0U; dim < 3; ++dim) {
+      position_[dim].resize(i + kPadding);
+      normal_[dim].resize(i + kPadding);
+      view_[dim].resize(i + kPadding);
+      diffuse_[dim].resize(i + kPadding);
+      specular_[dim].resize(i + kPadding);
+      emission_[dim].resize(i + kPadding);
+    }
+    specularExponent_.resize(i + kPadding);
+  }
+  intersections_.push_back(&intersection);
+
+  const auto* material = intersection.material;
+  kernels_.push_back(material->kernel);
+  const auto light = material->light();
+  const auto diffuse =
+      !light && (material->illuminationModel & Material::DIFFUSE)
+          ? intersection.diffuse()
+          : Vec3();
+  const auto specular =
+      !light && (material->illuminationModel & Material::SPECULAR) &&
+              !material->specular.small()
+          ? material->specular
+          : Vec3();
+  const auto emission = light ? material->ambient * M_PI : Vec3();
+  const auto& normal = intersection.normal();
+  for (auto dim = 0U; dim < 3; ++dim) {
+    position_[dim][i] = intersection.position[dim];
+    normal_[dim][i] = normal[dim];
+    view_[dim][i] = -intersection.ray.direction[dim];
+    diffuse_[dim][i] = diffuse[dim];
+    specular_[dim][i] = specular[dim];
+    emission_[dim][i] = emission[dim];
+  }
+  specularExponent_[i] = material->specularExponent;
+}
+
+bool ShadingBatch::glossy(const size_t begin, const size_t end) const {
+  return std::any_of(kernels_.begin() + begin,
+                     kernels_.begin() + std::min(end, size()),
+                     [](const Material::Kernel kernel) {
+                       return kernel >= Material::Kernel::GLOSSY;
+                     });
+}
+
+void Shader::shadeBatch(const ShadingBatch& hits,
+                        const std::vector<std::unique_ptr<Light>>& lights,
+                        std::vector<Color>& out) const {
+  out.resize(hits.size() * lights.size());
+  for (auto i = 0U; i < hits.size(); ++i) {
+    for (auto j = 0U; j < lights.size(); ++j) {
+      out[i * lights.size() + j] = shade(hits[i], *lights[j]);
+    }
+  }
+}
+}  // namespace tinyrt
@@ -22,16 +22,75 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "core/intersecter.h"
 #include "core/light.h"
+#include "util/aligned_allocator.h"
 
 namespace tinyrt {
 using Color = Vec3;
 
+// Hits gathered for shading in one go. Besides the intersections themselves,
+// the per-hit inputs of the Phong model are kept as structure-of-arrays with
+// the illumination model already folded into the coefficients: diffuse and
+// specular are zero where the model disables them, and emission is non-zero
+// only for light materials. Arrays are zero padded to a multiple of kPadding
+// so that any SIMD width can load whole lanes. Callers that add hits grouped
+// by Material::Kernel let shaders skip work for whole lanes at a time.
+class ShadingBatch final {
+ public:
+  static constexpr unsigned kPadding = 16;
+
+  void clear();
+  void add(const Intersection& intersection);
+
+  size_t size() const { return intersections_.size(); }
+  const Intersection& operator[](const size_t i) const {
+    return *intersections_[i];
+  }
+
+  const float* position(const unsigned dim) const {
+    return position_[dim].data();
+  }
+  const float* normal(const unsigned dim) const { return normal_[dim].data(); }
+  const float* view(const unsigned dim) const { return view_[dim].data(); }
+  const float* diffuse(const unsigned dim) const {
+    return diffuse_[dim].data();
+  }
+  const float* specular(const unsigned dim) const {
+    return specular_[dim].data();
+  }
+  const float* emission(const unsigned dim) const {
+    return emission_[dim].data();
+  }
+  const float* specularExponent() const { return specularExponent_.data(); }
+  // Whether any of hits [begin, end) has a specular lobe.
+  bool glossy(size_t begin, size_t end) const;
+
+ private:
+  std::vector<const Intersection*> intersections_;
+  std::vector<Material::Kernel> kernels_;
+  aligned_vector<float> position_[3];
+  aligned_vector<float> normal_[3];
+  aligned_vector<float> view_[3];
+  aligned_vector<float> diffuse_[3];
+  aligned_vector<float> specular_[3];
+  aligned_vector<float> emission_[3];
+  aligned_vector<float> specularExponent_;
+};
+
 class Shader {
  public:
   virtual ~Shader() = default;
   virtual Color shade(const Intersection& intersection,
                       const Light& light) const = 0;
+
+  // Shades every hit against every light. The color of hit i under light j
+  // goes to out[i * lights.size() + j].
+  virtual void shadeBatch(const ShadingBatch& hits,
+                          const std::vector<std::unique_ptr<Light>>& lights,
+                          std::vector<Color>& out) const;
 };
 }  // namespace tinyrt
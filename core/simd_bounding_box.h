@@ -0,0 +1,76 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <limits>
+#include <vector>
+
+#include "core/bounding_box.h"
+#include "core/simd_vec3.h"
+
+namespace tinyrt {
+template <typename TVec3>
+struct SimdBoundingBox final {
+  using vec3_t = TVec3;
+
+  // Indexed by Ray::sign so that bounds[sign] is the near plane.
+  const std::array<TVec3, 2> bounds;
+
+  explicit SimdBoundingBox(const std::array<TVec3, 2>& bounds)
+      : bounds(bounds) {}
+
+  const TVec3& min() const { return bounds[0]; }
+  const TVec3& max() const { return bounds[1]; }
+};
+
+// Packs boxes kSimdWidth at a time. Unused lanes hold an inverted box that no
+// ray can hit.
+template <typename TVec3>
+std::vector<SimdBoundingBox<TVec3>> buildSimdBoundingBoxes(
+    const std::vector<BoundingBox>& aabbs) {
+  static constexpr auto kWidth = kSimdWidth<TVec3>;
+  static constexpr auto kMaxFloat = std::numeric_limits<float>::max();
+  std::vector<SimdBoundingBox<TVec3>> ret;
+  alignas(64) float buffer[3][kWidth];
+  std::array<TVec3, 2> bounds;
+  for (auto b = 0UL; b < aabbs.size(); b += kWidth) {
+    for (auto i = 0U; i < 2; ++i) {
+      for (auto j = 0U; j < kWidth; ++j) {
+        for (auto k = 0U; k < 3; ++k) {
+          if (b + j < aabbs.size()) {
+            buffer[k][j] = i == 0 ? aabbs[b + j].min()[k]
+                                  : aabbs[b + j].max()[k];
+          } else {
+            buffer[k][j] = i == 0 ? kMaxFloat : -kMaxFloat;
+          }
+        }
+      }
+      bounds[i] = TVec3((float const*)&buffer[0], (float const*)&buffer[1],
+                        (float const*)&buffer[2]);
+    }
+    ret.emplace_back(bounds);
+  }
+  return ret;
+}
+}  // namespace tinyrt
@@ -0,0 +1,58 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <exception>
+
+#include "core/intersecter.h"
+#include "core/kdtree_intersecter.h"
+#include "core/simd_kdtree_node.h"
+
+namespace tinyrt {
+// KdTreeIntersecter fixed to SimdKdTreeNode<TVec3>. Knowing the node type
+// lets the traversal call the SIMD leaf test directly instead of through
+// KdTree::Node.
+template <typename TVec3>
+class SimdKdTreeIntersecter final : public Intersecter {
+ public:
+  void initialize(const Scene& scene) override {
+    scene_ = &scene;
+    kdTree_ = std::make_unique<KdTree>(
+        scene, std::make_unique<SimdKdTreeNodeFactory<TVec3>>());
+  }
+
+  std::optional<Intersection> intersect(const Ray& ray) const override {
+    if (!kdTree_) {
+      throw std::runtime_error("Must initialize with a scene first!");
+    }
+    if (const auto hit = traverse<SimdKdTreeNode<TVec3>>(*kdTree_, ray)) {
+      return Intersection(ray, *hit, *scene_);
+    }
+    return std::nullopt;
+  }
+
+ private:
+  const Scene* scene_ = nullptr;
+  std::unique_ptr<KdTree> kdTree_;
+};
+}  // namespace tinyrt
@@ -22,8 +22,12 @@
 
 #pragma once
 
+#include <limits>
+#include <vector>
+
 #include "core/intersect.h"
 #include "core/kdtree.h"
+#include "core/simd_bounding_box.h"
 #include "core/simd_triangle.h"
 
 namespace tinyrt {
@@ -34,24 +38,84 @@ class SimdKdTreeNode final : public KdTree::Node {
                  KdTree::NodePtr right)
       : KdTree::Node(split, std::move(left), std::move(right)) {}
 
-  explicit SimdKdTreeNode(std::vector<const Triangle*> triangles)
-      : simdTriangles_(buildSimdTriangles<TVec3>(triangles)) {}
+  SimdKdTreeNode(const Mesh& mesh, std::span<const uint32_t> primitives,
+                 Arena& arena)
+      : simdTriangles_(buildSimdTriangles<TVec3>(mesh, primitives, arena)),
+        groupBoxes_(buildGroupBoxes(mesh, primitives, arena)) {}
 
-  std::optional<Intersection> intersect(const Ray& ray, const float tEntry,
-                                        const float tExit) const override {
-    std::optional<Intersection> intersection;
-    for (const auto& triangle : simdTriangles_) {
-      auto candidate = ::tinyrt::intersect(ray, triangle, tEntry, tExit);
-      if (candidate &&
-          (!intersection || intersection->time > candidate->time)) {
-        intersection = candidate;
+  std::optional<Hit> intersect(const Ray& ray, const float tEntry,
+                               const float tExit) const override {
+    std::optional<Hit> intersection;
+    // Small leaves are a single group.
+    if (groupBoxes_.empty()) {
+      for (const auto& triangle : simdTriangles_) {
+        auto candidate = ::tinyrt::intersect(ray, triangle, tEntry, tExit);
+        if (candidate &&
+            (!intersection || intersection->time > candidate->time)) {
+          intersection = candidate;
+        }
+      }
+      return intersection;
+    }
+    // Otherwise the groups whose boxes the ray enters go nearest first, and
+    // those entered beyond the closest hit so far are skipped.
+    static constexpr auto kWidth = kSimdWidth<TVec3>;
+    static constexpr auto kMaxFloat = std::numeric_limits<float>::max();
+    auto tClosest = tExit;
+    for (auto b = 0UL; b < groupBoxes_.size(); ++b) {
+      const auto slabs =
+          ::tinyrt::intersect(ray, groupBoxes_[b], tEntry, tClosest);
+      auto entries = slabs.tEntry.retain(slabs.mask, kMaxFloat);
+      for (auto lane = entries.minIndex();
+           lane >= 0 && entries.v[lane] <= tClosest;
+           lane = entries.minIndex()) {
+        entries.v[lane] = kMaxFloat;
+        const auto group = b * kWidth + lane;
+        if (group >= simdTriangles_.size()) {
+          break;
+        }
+        auto candidate = ::tinyrt::intersect(ray, simdTriangles_[group],
+                                             tEntry, tClosest);
+        if (candidate &&
+            (!intersection || intersection->time > candidate->time)) {
+          intersection = candidate;
+          tClosest = candidate->time;
+        }
       }
     }
     return intersection;
   }
 
  private:
-  const std::vector<SimdTriangle<TVec3>> simdTriangles_;
+  // Bounds of each group of simdTriangles_, packed kSimdWidth at a time;
+  // none for leaves of a single group.
+  static std::span<const SimdBoundingBox<TVec3>> buildGroupBoxes(
+      const Mesh& mesh, std::span<const uint32_t> primitives, Arena& arena) {
+    static constexpr auto kWidth = kSimdWidth<TVec3>;
+    if (primitives.size() <= kWidth) {
+      return {};
+    }
+    std::vector<BoundingBox> boxes;
+    for (auto t = 0UL; t < primitives.size(); t += kWidth) {
+      auto& box = boxes.emplace_back();
+      for (auto j = t; j < std::min(t + kWidth, primitives.size()); ++j) {
+        for (auto i = 0U; i < 3; ++i) {
+          box.add(mesh.position(primitives[j], i));
+        }
+      }
+    }
+    const auto packed = buildSimdBoundingBoxes<TVec3>(boxes);
+    auto* ret = static_cast<SimdBoundingBox<TVec3>*>(
+        arena.allocate(packed.size() * sizeof(SimdBoundingBox<TVec3>),
+                       alignof(SimdBoundingBox<TVec3>)));
+    for (auto b = 0UL; b < packed.size(); ++b) {
+      new (ret + b) SimdBoundingBox<TVec3>(packed[b]);
+    }
+    return {ret, packed.size()};
+  }
+
+  const std::span<const SimdTriangle<TVec3>> simdTriangles_;
+  const std::span<const SimdBoundingBox<TVec3>> groupBoxes_;
 };
 
 template <typename TVec3>
@@ -59,14 +123,16 @@ class SimdKdTreeNodeFactory final : public KdTree::NodeFactory {
  public:
   KdTree::NodePtr createIntermediate(const std::optional<SplitPlane>& split,
                                      KdTree::NodePtr left,
-                                     KdTree::NodePtr right) const override {
-    return std::make_unique<SimdKdTreeNode<TVec3>>(split, std::move(left),
-                                                   std::move(right));
+                                     KdTree::NodePtr right,
+                                     Arena& arena) const override {
+    return arena.make<SimdKdTreeNode<TVec3>>(split, std::move(left),
+                                             std::move(right));
   }
 
-  virtual KdTree::NodePtr createLeaf(
-      std::vector<const Triangle*> triangles) const override {
-    return std::make_unique<SimdKdTreeNode<TVec3>>(std::move(triangles));
+  KdTree::NodePtr createLeaf(const Mesh& mesh,
+                             std::span<const uint32_t> primitives,
+                             Arena& arena) const override {
+    return arena.make<SimdKdTreeNode<TVec3>>(mesh, primitives, arena);
   }
 };
 }  // namespace tinyrt
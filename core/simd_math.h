@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "core/avx2float.h"
+#include "core/avx512float.h"
+#include "util/algorithm.h"
+
+namespace tinyrt {
+// Polynomial approximations for the SIMD float types. Relative error is around
+// 1e-7 within the documented ranges.
+
+// log2(x) for normal x up to 2^126.
+template <typename TFloat>
+TFloat log2Approx(const TFloat& x) {
+  // Split x = m * 2^e with m in [2/3, 4/3), then
+  // log2(m) = 2 / ln(2) * atanh(s) with s = (m - 1) / (m + 1) and |s| <= 0.2.
+  const TFloat exponent = std::logb(x * 1.5f);
+  const TFloat mantissa = std::ldexp(x, -exponent);
+  const TFloat s = (mantissa - 1.f) / (mantissa + 1.f);
+  const TFloat s2 = s * s;
+  const TFloat poly =
+      (((s2 * 0.320598898f + 0.412198583f) * s2 + 0.577078016f) * s2 +
+       0.961796694f) *
+          s2 +
+      2.88539008f;
+  return exponent + s * poly;
+}
+
+// 2^x, with x clamped to the normal float exponent range.
+template <typename TFloat>
+TFloat exp2Approx(const TFloat& x) {
+  const TFloat clamped =
+      tinyrt::max(tinyrt::min(x, TFloat(127.f)), TFloat(-126.f));
+  const TFloat whole = std::floor(clamped);
+  const TFloat f = clamped - whole;
+  const TFloat poly =
+      ((((f * 0.0018775767f + 0.0089893397f) * f + 0.055826318f) * f +
+        0.24015361f) *
+           f +
+       0.69315308f) *
+          f +
+      0.99999994f;
+  return std::ldexp(poly, whole);
+}
+
+// base^exponent for base > 0. Smaller bases are clamped to the smallest normal
+// float, so they come out as ~0 for positive exponents.
+template <typename TFloat>
+TFloat powApprox(const TFloat& base, const TFloat& exponent) {
+  const TFloat clamped =
+      tinyrt::max(base, TFloat(std::numeric_limits<float>::min()));
+  return exp2Approx(exponent * log2Approx(clamped));
+}
+
+// {sin(2 * pi * u), cos(2 * pi * u)} for u in [0, 1).
+template <typename TFloat>
+std::pair<TFloat, TFloat> sinCos2PiApprox(const TFloat& u) {
+  // Reduce to a quarter turn a in [0, pi / 2) and rotate by the quadrant.
+  const TFloat turns = u * 4.f;
+  const TFloat quadrant = std::floor(turns);
+  const TFloat a = (turns - quadrant) * float(M_PI / 2);
+  const TFloat a2 = a * a;
+  const TFloat sin =
+      ((((((a2 * 1.6059044e-10f - 2.5052108e-8f) * a2 + 2.7557319e-6f) * a2 -
+          1.9841270e-4f) *
+             a2 +
+         8.3333333e-3f) *
+            a2 -
+        0.16666667f) *
+           a2 +
+       1.f) *
+      a;
+  const TFloat cos =
+      ((((((a2 * -1.1470745e-11f + 2.0876757e-9f) * a2 - 2.7557319e-7f) * a2 +
+          2.4801587e-5f) *
+             a2 -
+         1.3888889e-3f) *
+            a2 +
+        0.041666667f) *
+           a2 -
+       0.5f) *
+          a2 +
+      1.f;
+  const auto swap = (quadrant == 1.f) || (quadrant == 3.f);
+  const TFloat sinSwapped = cos.retain(swap, sin);
+  const TFloat cosSwapped = sin.retain(swap, cos);
+  return {(-sinSwapped).retain(quadrant >= 2.f, sinSwapped),
+          (-cosSwapped).retain((quadrant == 1.f) || (quadrant == 2.f),
+                               cosSwapped)};
+}
+}  // namespace tinyrt
@@ -0,0 +1,111 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/simd_phong_shader.h"
+
+#include <algorithm>
+
+#include "core/simd_math.h"
+
+namespace tinyrt {
+namespace {
+template <typename TVec3>
+TVec3 load(const float* const* soa, const size_t offset) {
+  return TVec3(soa[0] + offset, soa[1] + offset, soa[2] + offset);
+}
+}  // namespace
+
+template <typename TVec3>
+void SimdPhongShader<TVec3>::shadeBatch(
+    const ShadingBatch& hits, const std::vector<std::unique_ptr<Light>>& lights,
+    std::vector<Color>& out) const {
+  using float_t = typename TVec3::float_t;
+  static constexpr auto kWidth = kSimdWidth<TVec3>;
+  static const float_t kZero = 0.f;
+  static const float_t kTwo = 2.f;
+
+  const auto numLights = lights.size();
+  out.resize(hits.size() * numLights);
+  const float* position[3] = {hits.position(0), hits.position(1),
+                              hits.position(2)};
+  const float* normal[3] = {hits.normal(0), hits.normal(1), hits.normal(2)};
+  const float* view[3] = {hits.view(0), hits.view(1), hits.view(2)};
+  const float* diffuse[3] = {hits.diffuse(0), hits.diffuse(1),
+                             hits.diffuse(2)};
+  const float* specular[3] = {hits.specular(0), hits.specular(1),
+                              hits.specular(2)};
+  const float* emission[3] = {hits.emission(0), hits.emission(1),
+                              hits.emission(2)};
+
+  for (auto offset = 0UL; offset < hits.size(); offset += kWidth) {
+    const auto p = load<TVec3>(position, offset);
+    const auto n = load<TVec3>(normal, offset);
+    const auto v = load<TVec3>(view, offset);
+    const auto kd = load<TVec3>(diffuse, offset);
+    const auto ks = load<TVec3>(specular, offset);
+    const auto ke = load<TVec3>(emission, offset);
+    const float_t exponent = hits.specularExponent() + offset;
+    const auto lanes = std::min(kWidth, hits.size() - offset);
+    // Diffuse-only chunks have zero specular coefficients; skip the pow.
+    const auto glossy = hits.glossy(offset, offset + lanes);
+
+    for (auto j = 0U; j < numLights; ++j) {
+      const auto& light = *lights[j];
+      const auto& center = light.aabb.center();
+      const auto& size = light.aabb.size();
+      const auto& emittance = light.material.emittance;
+      const float_t areax = size->y * size->z;
+      const float_t areay = size->x * size->z;
+      const float_t areaz = size->x * size->y;
+
+      // Vector from the light to the hit, as in Light::intensity.
+      const auto distance = p - TVec3(center->x, center->y, center->z);
+      const auto norm = std::sqrt(distance.norm2());
+      const auto l = -distance / norm;
+      const auto cosine = l.dot(n);
+      const auto diffuseTerm = tinyrt::max(cosine, kZero);
+      auto specularTerm = kZero;
+      if (glossy) {
+        const auto r = n * (cosine * kTwo) - l;
+        const auto base = r.dot(v);
+        specularTerm = powApprox(base, exponent).retain(base > kZero, 0.f);
+      }
+      const auto unattenuated =
+          (std::abs(distance->x) * areax + std::abs(distance->y) * areay +
+           std::abs(distance->z) * areaz) /
+          (norm * (areax + areay + areaz));
+      const auto intensity = unattenuated / (norm * float_t(4 * M_PI));
+      const auto e = TVec3(emittance->x, emittance->y, emittance->z);
+      const auto color =
+          (e * kd * diffuseTerm + e * ks * specularTerm) * intensity + ke;
+
+      for (auto k = 0UL; k < lanes; ++k) {
+        out[(offset + k) * numLights + j] =
+            Color(color->x.v[k], color->y.v[k], color->z.v[k]);
+      }
+    }
+  }
+}
+
+/* explicit */ template class SimdPhongShader<AVX2Vec3>;
+/* explicit */ template class SimdPhongShader<AVX512Vec3>;
+}  // namespace tinyrt
@@ -23,59 +23,62 @@
 #pragma once
 
 #include <algorithm>
+#include <span>
 
-#include "core/avx2float.h"
-#include "core/avx512float.h"
-#include "core/triangle.h"
+#include "core/simd_vec3.h"
+#include "core/mesh.h"
+#include "util/arena.h"
 
 namespace tinyrt {
 template <typename TVec3>
 struct SimdTriangle final {
   using vec3_t = TVec3;
+  static constexpr auto kWidth = kSimdWidth<TVec3>;
 
   const std::array<TVec3, 3> vertices;
-  const std::vector<const Triangle*> sources;
+  // Padding lanes repeat the last triangle.
+  const std::array<uint32_t, kWidth> primitives;
 
   explicit SimdTriangle(const std::array<TVec3, 3>& vertices,
-                        const std::vector<const Triangle*>& sources)
-      : vertices(vertices), sources(sources) {}
+                        const std::array<uint32_t, kWidth>& primitives)
+      : vertices(vertices), primitives(primitives) {}
 
   const TVec3& a() const { return vertices[0]; }
   const TVec3& b() const { return vertices[1]; }
   const TVec3& c() const { return vertices[2]; }
 };
 
-using AVX2Vec3 = Vec3T<AVX2Float>;
 using AVX2Triangle = SimdTriangle<AVX2Vec3>;
 
-using AVX512Vec3 = Vec3T<AVX512Float, AVX512FMask>;
 using AVX512Triangle = SimdTriangle<AVX512Vec3>;
 
+// Packs the primitives of mesh kSimdWidth at a time into arena.
 template <typename TVec3>
-std::vector<SimdTriangle<TVec3>> buildSimdTriangles(
-    const std::vector<const Triangle*>& triangles) {
-  static constexpr auto kWidth =
-      sizeof(typename TVec3::float_t) / sizeof(float);
-  std::vector<SimdTriangle<TVec3>> ret;
-  alignas(32) float buffer[3][kWidth];
+std::span<const SimdTriangle<TVec3>> buildSimdTriangles(
+    const Mesh& mesh, std::span<const uint32_t> primitives, Arena& arena) {
+  static constexpr auto kWidth = kSimdWidth<TVec3>;
+  const auto count = (primitives.size() + kWidth - 1) / kWidth;
+  auto* ret = static_cast<SimdTriangle<TVec3>*>(arena.allocate(
+      count * sizeof(SimdTriangle<TVec3>), alignof(SimdTriangle<TVec3>)));
+  alignas(64) float buffer[3][kWidth];
   std::array<TVec3, 3> vertices;
-  std::vector<const Triangle*> sourceTriangles(kWidth);
-  for (auto t = 0UL; t < triangles.size(); t += kWidth) {
+  std::array<uint32_t, kWidth> lanes;
+  for (auto t = 0UL; t < primitives.size(); t += kWidth) {
+    for (auto j = 0U; j < kWidth; ++j) {
+      lanes[j] = primitives[std::min(t + j, primitives.size() - 1)];
+    }
     for (auto i = 0U; i < 3; ++i) {
       for (auto j = 0U; j < kWidth; ++j) {
-        const auto& vertex =
-            triangles[std::min(t + j, triangles.size() - 1)]->vertices()[i];
+        const auto position = mesh.position(lanes[j], i);
         for (auto k = 0U; k < 3; ++k) {
-          buffer[k][j] = vertex.coord[k];
+          buffer[k][j] = position[k];
         }
       }
       vertices[i] = TVec3((float const*)&buffer[0], (float const*)&buffer[1],
                           (float const*)&buffer[2]);
     }
-    std::copy_n(triangles.begin() + t, std::min(triangles.size() - t, kWidth),
-                sourceTriangles.begin());
-    ret.emplace_back(vertices, sourceTriangles);
+    new (ret + t / kWidth) SimdTriangle<TVec3>(vertices, lanes);
   }
-  return ret;
+  return {ret, count};
 }
 }  // namespace tinyrt
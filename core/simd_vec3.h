@@ -20,18 +20,17 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#include "core/triangle.h"
+#pragma once
+
+#include "core/avx2float.h"
+#include "core/avx512float.h"
+#include "core/vec3.h"
 
 namespace tinyrt {
-Triangle::Triangle(const std::array<Vertex, 3>& vertices,
-                   const Material& material)
-    : vertices_(vertices), material_(material) {}
+using AVX2Vec3 = Vec3T<AVX2Float>;
+using AVX512Vec3 = Vec3T<AVX512Float, AVX512FMask>;
 
-BoundingBox Triangle::aabb() const {
-  BoundingBox aabb;
-  for (auto i = 0U; i < 3; ++i) {
-    aabb.add(vertices_[i].coord);
-  }
-  return aabb;
-}
+template <typename TVec3>
+inline constexpr auto kSimdWidth =
+    sizeof(typename TVec3::float_t) / sizeof(float);
 }  // namespace tinyrt
@@ -20,45 +20,33 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-#pragma once
-
 #include "core/avx2float.h"
 #include "core/bounding_box.h"
+#include "core/glb.h"
 #include "core/obj.h"
+#include "core/ply.h"
 #include "core/scene.h"
-#include "core/triangle.h"
+#include "core/texture_cache.h"
 #include "core/vec3.h"
 
 namespace tinyrt {
-std::ostream& operator<<(std::ostream& os, const Vertex& vertex) {
-  os << "Vertex{coord=" << vertex.coord << ", texcoord=";
-  if (vertex.texcoord) {
-    os << *vertex.texcoord;
-  } else {
-    os << "none";
-  }
-  os << ", normal=" << vertex.normal << "}";
-  return os;
-}
-
-std::ostream& operator<<(std::ostream& os, const Triangle& triangle) {
-  os << "Triangle{a=" << triangle.a() << ", \tb=" << triangle.b()
-     << ", \tc=" << triangle.c() << "}";
-  return os;
-}
-
 std::ostream& operator<<(std::ostream& os, const Scene& scene) {
   constexpr auto triangleThreshold = 100U;
   constexpr auto lightThreshold = 16U;
 
-  os << "Scene{Triangles: ";
-  if (scene.triangles_.size() <= triangleThreshold) {
-    os << std::endl;
-    for (auto i = 0; i < scene.triangles_.size(); ++i) {
-      os << "#" << i << ": " << *scene.triangles_.at(i) << std::endl;
+  const auto& mesh = scene.mesh_;
+  const auto& optimization = scene.meshOptimization_;
+  // Counts as loaded -> after optimization.
+  os << "Scene{Vertices: " << optimization.before.vertices << " -> "
+     << optimization.after.vertices
+     << ", Triangles: " << optimization.before.triangles << " -> "
+     << optimization.after.triangles << std::endl;
+  if (mesh.size() <= triangleThreshold) {
+    for (auto i = 0U; i < mesh.size(); ++i) {
+      os << "#" << i << ": Triangle{a=" << mesh.position(i, 0)
+         << ", \tb=" << mesh.position(i, 1) << ", \tc=" << mesh.position(i, 2)
+         << "}" << std::endl;
     }
-  } else {
-    os << scene.triangles_.size() << std::endl;
   }
 
   os << "Lights: ";
@@ -76,8 +64,26 @@ std::ostream& operator<<(std::ostream& os, const Scene& scene) {
 std::ostream& operator<<(std::ostream& os, const Obj& obj) {
   os << "Obj{vertices=" << obj.vertices_.size()
      << ", texcoords=" << obj.texcoords_.size()
-     << ", normals=" << obj.normals_.size() << ", faces=" << obj.faces_.size()
-     << "}";
+     << ", normals=" << obj.normals_.size()
+     << ", triangles=" << obj.triangles_.size() << "}";
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Ply& ply) {
+  os << "Ply{";
+  for (auto i = 0U; i < ply.elements_.size(); ++i) {
+    os << (i > 0 ? ", " : "") << ply.elements_[i].name << "="
+       << ply.elements_[i].count;
+  }
+  os << "}";
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, const Glb& glb) {
+  os << "Glb{nodes=" << glb.json_["nodes"].size()
+     << ", meshes=" << glb.json_["meshes"].size()
+     << ", materials=" << glb.json_["materials"].size()
+     << ", bin=" << glb.bin_.size() << "}";
   return os;
 }
 
@@ -91,6 +97,14 @@ std::ostream& operator<<(std::ostream& os, const Light& light) {
   return os;
 }
 
+std::ostream& operator<<(std::ostream& os, const TextureCache& cache) {
+  const auto stats = cache.stats();
+  os << "TextureCache{textures=" << cache.size() << ", hits=" << stats.hits
+     << ", misses=" << stats.misses << ", evictions=" << stats.evictions
+     << ", bytes=" << stats.bytes << "}";
+  return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const AVX2Float& avx2float) {
   os << "{";
   for (auto i = 0; i < 8; ++i) {
@@ -0,0 +1,309 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core/texture_cache.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "util/mapped_file.h"
+#include "util/text.h"
+
+namespace tinyrt {
+namespace {
+constexpr unsigned kMaxTextures = 1U << 16;
+constexpr unsigned kMaxTiles = 1U << 21;
+
+static uint64_t tileKey(const uint32_t texture, const unsigned level,
+                        const unsigned tx, const unsigned ty) {
+  return uint64_t{texture} << 48 | uint64_t{level} << 42 | uint64_t{ty} << 21 |
+         tx;
+}
+
+static unsigned shardOf(const uint64_t key) {
+  return (key * 0x9E3779B97F4A7C15ULL) >> 60;
+}
+
+static int wrap(const int value, const int size) {
+  const auto wrapped = value % size;
+  return wrapped < 0 ? wrapped + size : wrapped;
+}
+}  // namespace
+
+struct TextureCache::Texture {
+  enum class Format { PPM, PFM };
+
+  explicit Texture(const std::string& path) : file(path) {
+    auto text = file.contents();
+    // Headers are whitespace separated tokens, possibly spread over lines
+    // and interleaved with # comments, with one whitespace character before
+    // the data.
+    const auto token = [&] {
+      while (!text.empty() &&
+             (std::isspace(text.front()) || text.front() == '#')) {
+        if (text.front() == '#') {
+          nextLine(text);
+        } else {
+          text.remove_prefix(1);
+        }
+      }
+      auto end = 0UL;
+      while (end < text.size() && !std::isspace(text[end])) {
+        ++end;
+      }
+      const auto value = text.substr(0, end);
+      text.remove_prefix(end);
+      return value;
+    };
+    const auto magic = token();
+    if (magic == "P6") {
+      format = Format::PPM;
+    } else if (magic == "PF") {
+      format = Format::PFM;
+    } else {
+      throw std::runtime_error("Unsupported texture format: " + path);
+    }
+    width = parseNumber<unsigned>(token());
+    height = parseNumber<unsigned>(token());
+    if (format == Format::PPM) {
+      if (parseNumber<unsigned>(token()) != 255) {
+        throw std::runtime_error("Only 8-bit PPM textures are supported");
+      }
+    } else {
+      bigEndian = parseNumber<float>(token()) > 0;
+    }
+    if (text.empty() || width == 0 || height == 0 ||
+        width / kTileSize >= kMaxTiles || height / kTileSize >= kMaxTiles) {
+      throw std::runtime_error("Malformed texture: " + path);
+    }
+    dataOffset = file.contents().size() - text.size() + 1;
+    const size_t texelSize = format == Format::PPM ? 3 : 3 * sizeof(float);
+    if (file.contents().size() < dataOffset + size_t{width} * height *
+                                                   texelSize) {
+      throw std::runtime_error("Truncated texture: " + path);
+    }
+    levels = std::bit_width(std::max(width, height));
+  }
+
+  unsigned levelWidth(const unsigned level) const {
+    return std::max(width >> level, 1U);
+  }
+  unsigned levelHeight(const unsigned level) const {
+    return std::max(height >> level, 1U);
+  }
+
+  // Texel (x, y) of the file, counting rows from the top.
+  Vec3 read(const unsigned x, const unsigned y) const {
+    const auto* data = file.contents().data() + dataOffset;
+    if (format == Format::PPM) {
+      const auto* texel =
+          reinterpret_cast<const uint8_t*>(data) + (size_t{y} * width + x) * 3;
+      return Vec3(texel[0], texel[1], texel[2]) / 255.f;
+    }
+    // PFM rows run bottom to top.
+    uint32_t bits[3];
+    std::memcpy(bits, data + ((size_t{height - 1 - y}) * width + x) * 12, 12);
+    Vec3 texel;
+    for (auto c = 0; c < 3; ++c) {
+      texel[c] = std::bit_cast<float>(bigEndian ? __builtin_bswap32(bits[c])
+                                                : bits[c]);
+    }
+    return texel;
+  }
+
+  MappedFile file;
+  Format format;
+  bool bigEndian = false;
+  unsigned width;
+  unsigned height;
+  size_t dataOffset;
+  unsigned levels;
+};
+
+TextureCache::TextureCache(const size_t budget) : budget_(budget) {}
+
+TextureCache::~TextureCache() = default;
+
+uint32_t TextureCache::add(const std::string& path) {
+  if (textures_.size() >= kMaxTextures) {
+    throw std::runtime_error("Too many textures");
+  }
+  textures_.push_back(std::make_unique<Texture>(path));
+  paths_.push_back(path);
+  return textures_.size() - 1;
+}
+
+void TextureCache::setBudget(const size_t budget) { budget_ = budget; }
+
+const TextureCache::Texture& TextureCache::texture(const uint32_t id) const {
+  return *textures_[id];
+}
+
+Vec3 TextureCache::sample(const uint32_t id, const float s, const float t,
+                          const float footprint) const {
+  const auto& tex = texture(id);
+  const auto texels = footprint * std::max(tex.width, tex.height);
+  const auto lod = std::clamp(texels > 1.f ? std::log2(texels) : 0.f, 0.f,
+                              float(tex.levels - 1));
+  const auto level = static_cast<unsigned>(lod);
+  const auto blend = lod - level;
+  auto color = bilinear(tex, id, level, s, t);
+  if (blend > 0.f) {
+    color = color * (1.f - blend) + bilinear(tex, id, level + 1, s, t) * blend;
+  }
+  return color;
+}
+
+Vec3 TextureCache::bilinear(const Texture& texture, const uint32_t id,
+                            const unsigned level, const float s,
+                            const float t) const {
+  // Texel centers sit at half-integer coordinates; rows count from the top.
+  const auto x = (s - std::floor(s)) * texture.levelWidth(level) - .5f;
+  const auto y = (1.f - (t - std::floor(t))) * texture.levelHeight(level) - .5f;
+  const auto x0 = static_cast<int>(std::floor(x));
+  const auto y0 = static_cast<int>(std::floor(y));
+  const auto fx = x - x0;
+  const auto fy = y - y0;
+  std::shared_ptr<const Tile> tile;
+  uint64_t key = ~uint64_t{0};
+  const auto top = texel(texture, id, level, x0, y0, tile, key) * (1 - fx) +
+                   texel(texture, id, level, x0 + 1, y0, tile, key) * fx;
+  const auto bottom =
+      texel(texture, id, level, x0, y0 + 1, tile, key) * (1 - fx) +
+      texel(texture, id, level, x0 + 1, y0 + 1, tile, key) * fx;
+  return top * (1 - fy) + bottom * fy;
+}
+
+Vec3 TextureCache::texel(const Texture& texture, const uint32_t id,
+                         const unsigned level, int x, int y,
+                         std::shared_ptr<const Tile>& tile,
+                         uint64_t& key) const {
+  x = wrap(x, texture.levelWidth(level));
+  y = wrap(y, texture.levelHeight(level));
+  const auto tx = x / kTileSize;
+  const auto ty = y / kTileSize;
+  const auto wanted = tileKey(id, level, tx, ty);
+  if (wanted != key) {
+    tile = this->tile(texture, id, level, tx, ty);
+    key = wanted;
+  }
+  return (*tile)[(y % kTileSize) * kTileSize + x % kTileSize];
+}
+
+std::shared_ptr<const TextureCache::Tile> TextureCache::tile(
+    const Texture& texture, const uint32_t id, const unsigned level,
+    const unsigned tx, const unsigned ty) const {
+  const auto key = tileKey(id, level, tx, ty);
+  auto& shard = shards_[shardOf(key)];
+  {
+    std::lock_guard<std::mutex> l(shard.mu);
+    if (const auto it = shard.tiles.find(key); it != shard.tiles.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+      ++hits_;
+      return it->second.first;
+    }
+  }
+  ++misses_;
+  // Made without the lock: coarse tiles look up finer ones, which may live
+  // in the same shard. Threads racing for a tile both make it; the first
+  // one in wins.
+  auto made = makeTile(texture, id, level, tx, ty);
+  std::lock_guard<std::mutex> l(shard.mu);
+  const auto [it, inserted] = shard.tiles.try_emplace(key);
+  if (!inserted) {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.second);
+    return it->second.first;
+  }
+  shard.lru.push_front(key);
+  it->second = {std::move(made), shard.lru.begin()};
+  shard.bytes += sizeof(Tile);
+  // Tiles in use elsewhere stay alive through their shared_ptr.
+  const auto shardBudget = budget_ / kShards;
+  while (shard.bytes > shardBudget && shard.lru.size() > 1) {
+    shard.tiles.erase(shard.lru.back());
+    shard.lru.pop_back();
+    shard.bytes -= sizeof(Tile);
+    ++evictions_;
+  }
+  return it->second.first;
+}
+
+std::shared_ptr<const TextureCache::Tile> TextureCache::makeTile(
+    const Texture& texture, const uint32_t id, const unsigned level,
+    const unsigned tx, const unsigned ty) const {
+  auto tile = std::make_shared<Tile>();
+  const auto x0 = tx * kTileSize;
+  const auto y0 = ty * kTileSize;
+  const auto x1 = std::min(x0 + kTileSize, texture.levelWidth(level));
+  const auto y1 = std::min(y0 + kTileSize, texture.levelHeight(level));
+  if (level == 0) {
+    for (auto y = y0; y < y1; ++y) {
+      for (auto x = x0; x < x1; ++x) {
+        (*tile)[(y - y0) * kTileSize + x - x0] = texture.read(x, y);
+      }
+    }
+    return tile;
+  }
+  // Box filter of the level below, whose 2x2 tiles under this one are
+  // fetched up front. Odd sizes repeat the last row or column.
+  const auto below = level - 1;
+  const auto belowWidth = texture.levelWidth(below);
+  const auto belowHeight = texture.levelHeight(below);
+  std::shared_ptr<const Tile> children[2][2];
+  for (auto j = 0U; j < 2; ++j) {
+    for (auto i = 0U; i < 2; ++i) {
+      const auto cx = tx * 2 + i;
+      const auto cy = ty * 2 + j;
+      if (cx * kTileSize < belowWidth && cy * kTileSize < belowHeight) {
+        children[j][i] = this->tile(texture, id, below, cx, cy);
+      }
+    }
+  }
+  const auto child = [&](unsigned x, unsigned y) {
+    x = std::min(x, belowWidth - 1);
+    y = std::min(y, belowHeight - 1);
+    const auto& tile = children[y / kTileSize - ty * 2][x / kTileSize - tx * 2];
+    return (*tile)[(y % kTileSize) * kTileSize + x % kTileSize];
+  };
+  for (auto y = y0; y < y1; ++y) {
+    for (auto x = x0; x < x1; ++x) {
+      (*tile)[(y - y0) * kTileSize + x - x0] =
+          (child(2 * x, 2 * y) + child(2 * x + 1, 2 * y) +
+           child(2 * x, 2 * y + 1) + child(2 * x + 1, 2 * y + 1)) *
+          .25f;
+    }
+  }
+  return tile;
+}
+
+TextureCache::Stats TextureCache::stats() const {
+  Stats stats{hits_, misses_, evictions_, 0};
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> l(shard.mu);
+    stats.bytes += shard.bytes;
+  }
+  return stats;
+}
+}  // namespace tinyrt
@@ -0,0 +1,122 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/vec3.h"
+
+namespace tinyrt {
+// Image textures, read on demand into a fixed-size cache of tiles.
+//
+// Each texture is a MIP pyramid split into kTileSize x kTileSize tiles. A
+// tile is made when a lookup first needs it: level 0 tiles straight from the
+// memory-mapped file, coarser ones by averaging the four tiles below them,
+// which come from the cache in turn. Tiles are evicted least recently used
+// first once the cache exceeds its budget, so memory stays bounded however
+// large the textures are, and distant surfaces, which read coarse levels,
+// only ever touch small ones.
+//
+// Reads binary PPM (P6, 8-bit) and PFM files. Lookups are thread-safe.
+class TextureCache final {
+ public:
+  static constexpr unsigned kTileSize = 32;
+
+  explicit TextureCache(size_t budget = size_t{256} << 20);
+  ~TextureCache();
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+
+  // Registers a texture file and returns its id. Maps the file and reads its
+  // header, throwing std::runtime_error if it is not a supported image; the
+  // texels are only read as lookups need them. Not thread-safe.
+  uint32_t add(const std::string& path);
+  const std::vector<std::string>& paths() const { return paths_; }
+  size_t size() const { return paths_.size(); }
+
+  // Bytes of tiles to keep. Takes effect as tiles are added.
+  void setBudget(size_t budget);
+
+  // Trilinearly filtered color of texture at (s, t), with the origin at the
+  // bottom left and repeating outside [0, 1). footprint is the width of the
+  // lookup as a fraction of the texture's width, and selects the MIP levels.
+  Vec3 sample(uint32_t texture, float s, float t, float footprint) const;
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t bytes;
+  };
+  Stats stats() const;
+
+  friend std::ostream& operator<<(std::ostream& os, const TextureCache& cache);
+
+ private:
+  struct Texture;
+  using Tile = std::array<Vec3, kTileSize * kTileSize>;
+
+  // Tiles are spread over shards by key, each with its own lock, LRU list
+  // and share of the budget, so that threads rarely wait for each other.
+  struct Shard {
+    std::mutex mu;
+    // Most recently used first.
+    std::list<uint64_t> lru;
+    std::unordered_map<uint64_t, std::pair<std::shared_ptr<const Tile>,
+                                           std::list<uint64_t>::iterator>>
+        tiles;
+    size_t bytes = 0;
+  };
+  static constexpr unsigned kShards = 16;
+
+  const Texture& texture(uint32_t id) const;
+  // Texel (x, y) of level, wrapped into the level. tile caches the tile of
+  // the previous call, if any, to skip the cache for neighbouring texels.
+  Vec3 texel(const Texture& texture, uint32_t id, unsigned level, int x,
+             int y, std::shared_ptr<const Tile>& tile, uint64_t& key) const;
+  Vec3 bilinear(const Texture& texture, uint32_t id, unsigned level, float s,
+                float t) const;
+  std::shared_ptr<const Tile> tile(const Texture& texture, uint32_t id,
+                                   unsigned level, unsigned tx,
+                                   unsigned ty) const;
+  std::shared_ptr<const Tile> makeTile(const Texture& texture, uint32_t id,
+                                       unsigned level, unsigned tx,
+                                       unsigned ty) const;
+
+  std::vector<std::string> paths_;
+  std::vector<std::unique_ptr<Texture>> textures_;
+  std::atomic<size_t> budget_;
+  mutable std::array<Shard, kShards> shards_;
+  mutable std::atomic<uint64_t> hits_ = 0;
+  mutable std::atomic<uint64_t> misses_ = 0;
+  mutable std::atomic<uint64_t> evictions_ = 0;
+};
+}  // namespace tinyrt
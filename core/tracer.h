@@ -25,22 +25,36 @@
 #include <functional>
 
 #include "core/intersecter.h"
+#include "core/random.h"
 #include "core/shader.h"
 
 namespace tinyrt {
 struct TraceOptions {
-  unsigned directRays;
-  unsigned indirectRays;
-  unsigned shadowRays;
-  Color background;
+  unsigned directRays = 0;
+  unsigned indirectRays = 0;
+  unsigned shadowRays = 0;
+  Color background = Color();
+  // If set, tracers add the materialBit() of every hit to it, shadow ray
+  // hits included.
+  MaterialMask* touchedMaterials = nullptr;
 };
 
+// Adds the material of hit to options.touchedMaterials, if set.
+inline void touch(const TraceOptions& options, const Scene& scene,
+                  const Intersection& hit) {
+  if (options.touchedMaterials) {
+    *options.touchedMaterials |=
+        materialBit(hit.material - scene.materials().data());
+  }
+}
+
 using RaySampler = std::function<Ray()>;
 
 class Tracer {
  public:
   virtual ~Tracer() = default;
-  virtual Color trace(const RaySampler& raySampler,
+  // Samples draw from random, which the caller seeds per pixel.
+  virtual Color trace(const RaySampler& raySampler, Random& random,
                       const Intersecter& intersecter, const Scene& scene,
                       const Shader& shader,
                       const TraceOptions& options) const = 0;
@@ -36,6 +36,7 @@ class Vec3T {
 
  public:
   using float_t = TFloat;
+  using bool_t = TBool;
 
  public:
   Vec3T() : Vec3T(.0f, .0f, .0f) {}
@@ -89,7 +90,21 @@ class Vec3T {
   }
 
   inline TFloat dot(const vec3_t& other) const {
-    return (v_.x * other->x + v_.y * other->y + v_.z * other->z);
+    return tinyrt::fma(v_.x, other->x,
+                       tinyrt::fma(v_.y, other->y, v_.z * other->z));
+  }
+
+  // Returns *this * scale + offset, fused per component.
+  inline vec3_t mulAdd(const vec3_t& scale, const vec3_t& offset) const {
+    return vec3_t(tinyrt::fma(v_.x, scale->x, offset->x),
+                  tinyrt::fma(v_.y, scale->y, offset->y),
+                  tinyrt::fma(v_.z, scale->z, offset->z));
+  }
+
+  inline vec3_t mulAdd(const TFloat scale, const vec3_t& offset) const {
+    return vec3_t(tinyrt::fma(v_.x, scale, offset->x),
+                  tinyrt::fma(v_.y, scale, offset->y),
+                  tinyrt::fma(v_.z, scale, offset->z));
   }
 
   inline void operator*=(const TFloat scalar) {
@@ -117,14 +132,12 @@ class Vec3T {
   }
 
   inline vec3_t cross(const vec3_t& other) const {
-    return vec3_t(v_.y * other->z - v_.z * other->y,
-                  v_.z * other->x - v_.x * other->z,
-                  v_.x * other->y - v_.y * other->x);
+    return vec3_t(tinyrt::fms(v_.y, other->z, v_.z * other->y),
+                  tinyrt::fms(v_.z, other->x, v_.x * other->z),
+                  tinyrt::fms(v_.x, other->y, v_.y * other->x));
   }
 
-  inline TFloat norm2() const {
-    return v_.x * v_.x + v_.y * v_.y + v_.z * v_.z;
-  }
+  inline TFloat norm2() const { return dot(*this); }
   inline TFloat norm() const { return std::sqrt(norm2()); }
 
   inline vec3_t normalize() const& { return *this / this->norm(); }
@@ -20,134 +20,213 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <algorithm>
 #include <chrono>
-#include <fstream>
-#include <future>
-#include <random>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
 
-#include "core/basic_intersecter.h"
-#include "core/camera.h"
-#include "core/kdtree_intersecter.h"
-#include "core/obj.h"
-#include "core/path_tracer.h"
-#include "core/phong_shader.h"
-#include "core/ray_tracer.h"
-#include "core/simd_kdtree_node.h"
-#include "core/stream.h"
-#include "util/async.h"
+#include "core/batch.h"
+#include "core/coordinator.h"
+#include "core/framebuffer.h"
+#include "core/job.h"
+#include "core/render.h"
+#include "core/scene_loader.h"
+#include "core/sequence.h"
+#include "core/server.h"
 #include "util/capabilities.h"
 #include "util/flag.h"
 #include "util/log.h"
+#include "util/socket.h"
 
 using namespace tinyrt;
-using namespace std::literals;
 
 constexpr char kOBJPath[] = "-obj";
 constexpr char kOutPath[] = "-out";
 constexpr char kForceAvx[] = "-force-avx";
+constexpr char kSeed[] = "-seed";
+constexpr char kQuantizePositions[] = "-quantize-positions";
+constexpr char kSceneCache[] = "-scene-cache";
+constexpr char kWidth[] = "-width";
+constexpr char kHeight[] = "-height";
+constexpr char kSamples[] = "-samples";
+constexpr char kPassSamples[] = "-pass-samples";
+constexpr char kCheckpoint[] = "-checkpoint";
+constexpr char kCheckpointInterval[] = "-checkpoint-interval";
+constexpr char kResume[] = "-resume";
+constexpr char kBandRows[] = "-band-rows";
+constexpr char kTextureCacheMB[] = "-texture-cache-mb";
+constexpr char kServe[] = "-serve";
+constexpr char kSocket[] = "-socket";
+constexpr char kServeScenes[] = "-serve-scenes";
+constexpr char kViews[] = "-views";
+constexpr char kTurntable[] = "-turntable";
+constexpr char kSequence[] = "-sequence";
+constexpr char kReuseSamples[] = "-reuse-samples";
+constexpr char kCrop[] = "-crop";
+constexpr char kPreview[] = "-preview";
+constexpr char kCoordinate[] = "-coordinate";
+constexpr char kWorker[] = "-worker";
+constexpr char kRasterSamples[] = "-raster-samples";
 
-std::unique_ptr<KdTree::NodeFactory> createKdTreeNodeFactory() {
+// Returns the AVX version to build SIMD kernels for: 512, 2 or 0 for none.
+int avxVersion() {
   Flags<Int<kForceAvx, -1>> avxFlags;
   const auto forceAvxVer = avxFlags.get<kForceAvx>();
   const auto hasOverride = forceAvxVer != -1;
   if ((supportsAvx512f() && !hasOverride) || forceAvxVer == 512) {
     LOG(INFO) << "Enabled AVX512F support";
-    return std::make_unique<SimdKdTreeNodeFactory<AVX512Vec3>>();
+    return 512;
   } else if ((supportsAvx2() && !hasOverride) || forceAvxVer == 2) {
     LOG(INFO) << "Enabled AVX2 support";
-    return std::make_unique<SimdKdTreeNodeFactory<AVX2Vec3>>();
+    return 2;
   }
   LOG(INFO) << "No AVX support detected, fallback to default";
-  return nullptr;
+  return 0;
 }
 
 int main(const int argc, const char** argv) {
   initFlags(argc, argv);
-  Flags<String<kOBJPath>, String<kOutPath>> flags;
-
-  Obj cornellBox(flags.get<kOBJPath>());
-  LOG(INFO) << "OBJ file loaded: " << cornellBox;
-
-  auto scene = std::move(cornellBox).moveToScene();
-  LOG(INFO) << "Scene created: " << *scene;
+  Flags<String<kOBJPath>, String<kOutPath>, Int<kSeed, 0>,
+        Bool<kQuantizePositions>, Bool<kSceneCache, true>, Int<kWidth, 640>,
+        Int<kHeight, 508>, Int<kSamples, 200>, Int<kPassSamples, 25>,
+        String<kCheckpoint>, Int<kCheckpointInterval, 600>, Bool<kResume>,
+        Int<kBandRows, 0>, Int<kTextureCacheMB, 256>, Bool<kServe>,
+        String<kSocket>, Int<kServeScenes, 4>, String<kViews>,
+        Int<kTurntable, 0>, Bool<kSequence>, Int<kReuseSamples, 0>,
+        String<kCrop>, Bool<kPreview>, String<kCoordinate>,
+        String<kWorker>, Int<kRasterSamples, 0>>
+      flags;
 
-  Camera camera(Vec3(0.f, .8f, 3.93f), Vec3(0.f, 0.f, -1.f),
-                Vec3(0.f, 1.f, 0.f), 32.f);
-  KdTreeIntersecter intersecter(createKdTreeNodeFactory());
-  PhongShader shader;
-  PathTracer rayTracer;
-  intersecter.initialize(*scene);
-
-  const unsigned width = 640;
-  const unsigned height = 508;
-  const unsigned block = 8;
-  const auto totalBlocks =
-      ((width + block - 1) / block) * ((height + block - 1) / block);
-  Vec3 result[width][height];
-  std::atomic_int completed;
-  std::promise<void> promise;
-
-  const TraceOptions options{
-      .directRays = 200,
-      .indirectRays = 1,
-      .shadowRays = 1,
+  // -crop x0,y0,x1,y1 renders that window of the frame.
+  std::optional<Block> crop;
+  if (const std::string window = flags.get<kCrop>(); !window.empty()) {
+    crop.emplace();
+    if (std::sscanf(window.c_str(), "%u,%u,%u,%u", &crop->x0, &crop->y0,
+                    &crop->x1, &crop->y1) != 4) {
+      LOG(ERROR) << "Bad " << kCrop << ": " << window;
+      return 1;
+    }
+  }
+  Job job{
+      .scenePath = flags.get<kOBJPath>(),
+      .meshOptions = {.quantizePositions = flags.get<kQuantizePositions>()},
+      .outPath = flags.get<kOutPath>(),
+      .width = static_cast<unsigned>(flags.get<kWidth>()),
+      .height = static_cast<unsigned>(flags.get<kHeight>()),
+      .crop = crop,
+      .samples = static_cast<unsigned>(flags.get<kSamples>()),
+      .passSamples = static_cast<unsigned>(flags.get<kPassSamples>()),
+      .seed = static_cast<uint32_t>(flags.get<kSeed>()),
+      .bandRows = static_cast<unsigned>(std::max(flags.get<kBandRows>(), 0)),
+      .checkpointPath = flags.get<kCheckpoint>(),
+      .checkpointInterval =
+          std::chrono::seconds(flags.get<kCheckpointInterval>()),
+      .resume = flags.get<kResume>(),
+      .preview = flags.get<kPreview>(),
+      .rasterSamples = static_cast<unsigned>(
+          std::clamp(flags.get<kRasterSamples>(), 0, 256)),
   };
-  auto rayGenerator = camera.adapt(width, height);
+  const auto textureBudget = size_t(flags.get<kTextureCacheMB>()) << 20;
 
-  LOG(INFO) << "Rendering started.";
-  const auto begin = std::chrono::steady_clock::now();
-  for (auto i = 0; i < width; i += block) {
-    for (auto j = 0; j < height; j += block) {
-      Async::submit([&, i, j] {
-        static thread_local std::mt19937 generator;
-        std::uniform_real_distribution gen(0.f, 1.f);
-        unsigned kTarget = std::min(width, i + block);
-        unsigned lTarget = std::min(height, j + block);
-        for (auto k = i; k < kTarget; ++k) {
-          for (auto l = j; l < lTarget; ++l) {
-            const RaySampler raySampler([&] {
-              return rayGenerator(k + gen(generator), l + gen(generator));
-            });
-            result[k][l] = rayTracer.trace(raySampler, intersecter, *scene,
-                                           shader, options);
-          }
-        }
-        const auto completedBlocks = ++completed;
-        if (completedBlocks % (totalBlocks / 100) == 0) {
-          LOG(INFO) << "Finished " << completedBlocks << "/" << totalBlocks;
-        }
-        if (completedBlocks == totalBlocks) {
-          LOG(INFO) << "Completed!";
-          promise.set_value();
-        }
-      });
+  // Distributed rendering: -coordinate ADDRESS renders the job on the
+  // processes started with -worker ADDRESS, where ADDRESS is host:port or a
+  // UNIX domain socket path.
+  if (const std::string address = flags.get<kWorker>(); !address.empty()) {
+    try {
+      work(address, avxVersion(), flags.get<kSceneCache>(), textureBudget);
+    } catch (const std::exception& e) {
+      LOG(ERROR) << e.what();
+      return 1;
+    }
+    return 0;
+  }
+  if (const std::string address = flags.get<kCoordinate>();
+      !address.empty()) {
+    try {
+      Coordinator coordinator(job);
+      coordinator.run(Socket::listen(address));
+    } catch (const std::exception& e) {
+      LOG(ERROR) << e.what();
+      return 1;
     }
+    return 0;
   }
-  promise.get_future().wait();
-  LOG(INFO) << "Rendering finished. Time elapsed="
-            << std::chrono::duration_cast<std::chrono::seconds>(
-                   std::chrono::steady_clock::now() - begin)
-                   .count()
-            << "s.";
 
-  std::ofstream ppm(flags.get<kOutPath>());
-  ppm << "P3" << std::endl;
-  ppm << width << " " << height << std::endl;
-  ppm << "255" << std::endl;
-  int total = 0;
-  for (auto i = 0; i < height; ++i) {
-    for (auto j = 0; j < width; ++j) {
-      auto c = result[j][i] * 255;
-      for (auto k = 0; k < 3; k++) {
-        int clamped = std::max(std::min((int)c[k], 255), 0);
-        ppm << clamped << " ";
+  if (flags.get<kServe>()) {
+    // Checkpoints and bands are for single big renders.
+    job.bandRows = 0;
+    job.checkpointPath.clear();
+    job.resume = false;
+    Server server(std::move(job), avxVersion(),
+                  std::max(flags.get<kServeScenes>(), 1),
+                  flags.get<kSceneCache>(), textureBudget);
+    const std::string socketPath = flags.get<kSocket>();
+    std::string request;
+    if (socketPath.empty()) {
+      LOG(INFO) << "Serving jobs on stdin.";
+      while (std::getline(std::cin, request)) {
+        std::cout << server.handle(request) << std::endl;
       }
-      if (++total % 5 == 0) {
-        ppm << std::endl;
+      return 0;
+    }
+    const auto listener = Socket::listenUnix(socketPath);
+    LOG(INFO) << "Serving jobs on " << socketPath;
+    // Jobs use the whole thread pool, so clients are served one at a time.
+    for (;;) {
+      auto client = listener.accept();
+      try {
+        while (client.readLine(request)) {
+          client.write(server.handle(request) + "\n");
+        }
+      } catch (const std::system_error& e) {
+        LOG(WARNING) << "Client dropped: " << e.what();
       }
     }
   }
-  ppm.flush();
-  ppm.close();
+
+  try {
+    const auto scene =
+        loadScene(job.scenePath, job.meshOptions, flags.get<kSceneCache>());
+    LOG(INFO) << "Scene created: " << *scene;
+    scene->textures().setBudget(textureBudget);
+    const auto renderer = createRenderer(avxVersion());
+    renderer->initialize(*scene);
+    const std::string viewsPath = flags.get<kViews>();
+    const auto turntableViews = flags.get<kTurntable>();
+    if (viewsPath.empty() && turntableViews <= 0) {
+      render(job, *scene, *renderer);
+      return 0;
+    }
+    // Batch mode: views from a file of parseJob() lines, plus a turntable,
+    // rendered together or, as a sequence, in order with temporal reuse.
+    std::vector<Job> views;
+    if (!viewsPath.empty()) {
+      views = readViews(viewsPath, job);
+    }
+    if (turntableViews > 0) {
+      const auto orbit =
+          turntable(job, scene->aabb().center(), turntableViews);
+      views.insert(views.end(), orbit.begin(), orbit.end());
+    }
+    if (views.empty()) {
+      throw std::runtime_error("No views in " + viewsPath);
+    }
+    if (flags.get<kSequence>()) {
+      // By default a quarter of the samples are new in reused pixels.
+      const auto reuseSamples = flags.get<kReuseSamples>();
+      renderSequence(views,
+                     reuseSamples > 0 ? reuseSamples : job.samples / 4,
+                     *scene, *renderer);
+    } else {
+      renderBatch(views, *scene, *renderer);
+    }
+  } catch (const std::exception& e) {
+    LOG(ERROR) << e.what();
+    return 1;
+  }
   return 0;
-}
\ No newline at end of file
+}
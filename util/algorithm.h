@@ -34,4 +34,17 @@ template <typename T>
 const T max(const T& a, const T& b) {
   return std::max(a, b);
 }
+
+// Returns a * b + c. SIMD types specialize this to a single fused
+// multiply-add; for scalars the compiler contracts it where it can.
+template <typename T>
+inline const T fma(const T& a, const T& b, const T& c) {
+  return a * b + c;
+}
+
+// Returns a * b - c, with the same fusing as fma().
+template <typename T>
+inline const T fms(const T& a, const T& b, const T& c) {
+  return a * b - c;
+}
 }  // namespace tinyrt
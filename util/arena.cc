@@ -0,0 +1,101 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "util/arena.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace tinyrt {
+namespace {
+static constexpr size_t kChunkAlignment = 64;
+
+static size_t roundUp(const size_t value, const size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+Arena::Arena(const size_t chunkSize, const bool hugePages)
+    : chunkSize_(chunkSize), hugePages_(hugePages) {}
+
+Arena::~Arena() {
+  for (const auto& chunk : chunks_) {
+    if (hugePages_) {
+      ::munmap(chunk.data, chunk.size);
+    } else {
+      std::free(chunk.data);
+    }
+  }
+}
+
+void* Arena::allocate(const size_t size, const size_t alignment) {
+  while (true) {
+    for (; current_ < chunks_.size(); ++current_, offset_ = 0) {
+      const auto& chunk = chunks_[current_];
+      const auto base = reinterpret_cast<uintptr_t>(chunk.data);
+      const auto begin = roundUp(base + offset_, alignment) - base;
+      if (begin + size <= chunk.size) {
+        offset_ = begin + size;
+        return chunk.data + begin;
+      }
+    }
+    chunks_.push_back(newChunk(size + alignment));
+    current_ = chunks_.size() - 1;
+  }
+}
+
+void Arena::rewind(const Mark& mark) {
+  current_ = mark.chunk;
+  offset_ = mark.offset;
+}
+
+size_t Arena::reserved() const {
+  size_t total = 0;
+  for (const auto& chunk : chunks_) {
+    total += chunk.size;
+  }
+  return total;
+}
+
+Arena::Chunk Arena::newChunk(const size_t minSize) const {
+  const auto size = std::max(chunkSize_, minSize);
+  if (hugePages_) {
+    const auto mapped = roundUp(size, kHugePageSize);
+    void* data = ::mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    // Only advice; the kernel may decline.
+    ::madvise(data, mapped, MADV_HUGEPAGE);
+    return {static_cast<char*>(data), mapped};
+  }
+  const auto allocated = roundUp(size, kChunkAlignment);
+  if (auto* data = std::aligned_alloc(kChunkAlignment, allocated)) {
+    return {static_cast<char*>(data), allocated};
+  }
+  throw std::bad_alloc();
+}
+}  // namespace tinyrt
@@ -0,0 +1,109 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tinyrt {
+// Deleter for objects placed in an Arena: runs the destructor and leaves the
+// memory to the arena.
+struct ArenaDeleter {
+  template <typename T>
+  void operator()(T* ptr) const {
+    ptr->~T();
+  }
+};
+
+template <typename T>
+using arena_ptr = std::unique_ptr<T, ArenaDeleter>;
+
+// Monotonic arena. Allocation bumps a pointer through large chunks, and
+// memory is only given back in bulk, either to a mark() or entirely by
+// reset(), after which the chunks are reused. Not thread-safe; give each
+// thread its own arena.
+class Arena final {
+ public:
+  static constexpr size_t kDefaultChunkSize = 1 << 20;
+  static constexpr size_t kHugePageSize = 2 << 20;
+
+  // A position to rewind() to.
+  struct Mark {
+    size_t chunk;
+    size_t offset;
+  };
+
+  // With hugePages set, chunks are rounded up to whole huge pages and
+  // advised as such, which helps long-lived data that is read at random.
+  explicit Arena(size_t chunkSize = kDefaultChunkSize, bool hugePages = false);
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  // Returns n default-constructed Ts. Their destructors never run.
+  template <typename T>
+  T* allocateArray(const size_t n) {
+    static_assert(std::is_trivially_destructible_v<T>);
+    auto* ptr = static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    for (auto i = 0UL; i < n; ++i) {
+      new (ptr + i) T();
+    }
+    return ptr;
+  }
+
+  template <typename T, typename... TArgs>
+  arena_ptr<T> make(TArgs&&... args) {
+    return arena_ptr<T>(new (allocate(sizeof(T), alignof(T)))
+                            T(std::forward<TArgs>(args)...));
+  }
+
+  Mark mark() const { return {current_, offset_}; }
+  // Releases everything allocated since mark was taken.
+  void rewind(const Mark& mark);
+  void reset() { rewind({0, 0}); }
+
+  // Bytes held from the system.
+  size_t reserved() const;
+
+ private:
+  struct Chunk {
+    char* data;
+    size_t size;
+  };
+
+  Chunk newChunk(size_t minSize) const;
+
+  const size_t chunkSize_;
+  const bool hugePages_;
+  std::vector<Chunk> chunks_;
+  size_t current_ = 0;
+  size_t offset_ = 0;
+};
+}  // namespace tinyrt
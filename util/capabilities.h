@@ -23,6 +23,9 @@
 #pragma once
 
 namespace tinyrt {
-inline bool supportsAvx2() { return __builtin_cpu_supports("avx2"); }
+// The AVX2 kernels also use FMA, which every AVX2 CPU since Haswell has.
+inline bool supportsAvx2() {
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
 inline bool supportsAvx512f() { return __builtin_cpu_supports("avx512f"); }
 }  // namespace tinyrt
@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+namespace tinyrt {
+// IEEE 754 binary16 conversions. Rounds to nearest even; values beyond the
+// half range become infinities and tiny ones subnormals or zero.
+inline uint16_t floatToHalf(const float value) {
+  const auto bits = std::bit_cast<uint32_t>(value);
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const int32_t floatExponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+  if (floatExponent == 0xff) {
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+  }
+  const int32_t exponent = floatExponent - 127 + 15;
+  if (exponent >= 0x1f) {
+    return sign | 0x7c00;
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return sign;
+    }
+    mantissa |= 0x800000;
+    const auto shift = 14 - exponent;
+    uint32_t half = mantissa >> shift;
+    const auto remainder = mantissa & ((1U << shift) - 1);
+    const auto halfway = 1U << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      ++half;
+    }
+    return sign | half;
+  }
+  // A carry out of the mantissa correctly bumps the exponent.
+  uint32_t half = (exponent << 10) | (mantissa >> 13);
+  const auto remainder = mantissa & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | half;
+}
+
+inline float halfToFloat(const uint16_t half) {
+  const uint32_t sign = (half & 0x8000U) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1f;
+  const uint32_t mantissa = half & 0x3ff;
+  if (exponent == 0) {
+    const auto magnitude = mantissa * (1.f / (1 << 24));
+    return sign ? -magnitude : magnitude;
+  }
+  if (exponent == 0x1f) {
+    return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+  }
+  return std::bit_cast<float>(sign | ((exponent + 112) << 23) |
+                              (mantissa << 13));
+}
+}  // namespace tinyrt
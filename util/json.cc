@@ -0,0 +1,365 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "util/json.h"
+
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+
+namespace tinyrt {
+namespace {
+const Json kNull;
+const std::string kEmptyString;
+const Json::object_t kEmptyObject;
+}  // namespace
+
+class Json::Parser final {
+ public:
+  explicit Parser(const std::string_view text) : text_(text) {}
+
+  Json parseDocument() {
+    auto value = parseValue();
+    skipSpace();
+    if (pos_ != text_.size()) {
+      fail("Trailing characters");
+    }
+    return value;
+  }
+
+ private:
+  // Deeper documents are rejected rather than overflowing the stack.
+  static constexpr unsigned kMaxDepth = 256;
+
+  [[noreturn]] void fail(const char* what) const {
+    throw std::invalid_argument(std::string("Malformed JSON: ") + what +
+                                " at offset " + std::to_string(pos_));
+  }
+
+  void skipSpace() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' ||
+            text_[pos_] == '\r')) {
+      ++pos_;
+    }
+  }
+
+  char peek() {
+    skipSpace();
+    if (pos_ >= text_.size()) {
+      fail("Unexpected end");
+    }
+    return text_[pos_];
+  }
+
+  void expect(const char c) {
+    if (peek() != c) {
+      fail("Unexpected character");
+    }
+    ++pos_;
+  }
+
+  void expectWord(const std::string_view word) {
+    if (text_.substr(pos_, word.size()) != word) {
+      fail("Unknown literal");
+    }
+    pos_ += word.size();
+  }
+
+  Json parseValue() {
+    if (++depth_ > kMaxDepth) {
+      fail("Nesting too deep");
+    }
+    Json json;
+    switch (peek()) {
+      case '{':
+        json.value_ = parseObject();
+        break;
+      case '[':
+        json.value_ = parseArray();
+        break;
+      case '"':
+        json.value_ = parseString();
+        break;
+      case 't':
+        expectWord("true");
+        json.value_ = true;
+        break;
+      case 'f':
+        expectWord("false");
+        json.value_ = false;
+        break;
+      case 'n':
+        expectWord("null");
+        break;
+      default:
+        json.value_ = parseNumber();
+        break;
+    }
+    --depth_;
+    return json;
+  }
+
+  object_t parseObject() {
+    object_t object;
+    expect('{');
+    if (peek() == '}') {
+      ++pos_;
+      return object;
+    }
+    while (true) {
+      if (peek() != '"') {
+        fail("Expected a key");
+      }
+      auto key = parseString();
+      expect(':');
+      object.emplace_back(std::move(key), parseValue());
+      if (peek() == ',') {
+        ++pos_;
+      } else {
+        expect('}');
+        return object;
+      }
+    }
+  }
+
+  array_t parseArray() {
+    array_t array;
+    expect('[');
+    if (peek() == ']') {
+      ++pos_;
+      return array;
+    }
+    while (true) {
+      array.push_back(parseValue());
+      if (peek() == ',') {
+        ++pos_;
+      } else {
+        expect(']');
+        return array;
+      }
+    }
+  }
+
+  double parseNumber() {
+    double value;
+    const auto* begin = text_.data() + pos_;
+    const auto [end, ec] =
+        std::from_chars(begin, text_.data() + text_.size(), value);
+    if (ec != std::errc() || end == begin) {
+      fail("Expected a value");
+    }
+    pos_ += end - begin;
+    return value;
+  }
+
+  unsigned parseHex4() {
+    if (pos_ + 4 > text_.size()) {
+      fail("Truncated escape");
+    }
+    unsigned value = 0;
+    const auto* begin = text_.data() + pos_;
+    const auto [end, ec] = std::from_chars(begin, begin + 4, value, 16);
+    if (ec != std::errc() || end != begin + 4) {
+      fail("Bad unicode escape");
+    }
+    pos_ += 4;
+    return value;
+  }
+
+  static void appendUtf8(std::string& out, const unsigned codePoint) {
+    if (codePoint < 0x80) {
+      out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+      out += static_cast<char>(0xc0 | (codePoint >> 6));
+      out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+      out += static_cast<char>(0xe0 | (codePoint >> 12));
+      out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    } else {
+      out += static_cast<char>(0xf0 | (codePoint >> 18));
+      out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+      out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    }
+  }
+
+  std::string parseString() {
+    expect('"');
+    std::string out;
+    while (true) {
+      if (pos_ >= text_.size()) {
+        fail("Unterminated string");
+      }
+      const auto c = text_[pos_++];
+      if (c == '"') {
+        return out;
+      }
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos_ >= text_.size()) {
+        fail("Unterminated string");
+      }
+      switch (text_[pos_++]) {
+        case '"':
+          out += '"';
+          break;
+        case '\\':
+          out += '\\';
+          break;
+        case '/':
+          out += '/';
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'u': {
+          auto codePoint = parseHex4();
+          // A high surrogate must be followed by an escaped low one.
+          if (codePoint >= 0xd800 && codePoint < 0xdc00 &&
+              text_.substr(pos_, 2) == "\\u") {
+            pos_ += 2;
+            const auto low = parseHex4();
+            if (low < 0xdc00 || low >= 0xe000) {
+              fail("Bad surrogate pair");
+            }
+            codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+          }
+          appendUtf8(out, codePoint);
+        } break;
+        default:
+          fail("Bad escape");
+      }
+    }
+  }
+
+  const std::string_view text_;
+  size_t pos_ = 0;
+  unsigned depth_ = 0;
+};
+
+Json Json::parse(const std::string_view text) {
+  return Parser(text).parseDocument();
+}
+
+bool Json::isNull() const {
+  return std::holds_alternative<std::nullptr_t>(value_);
+}
+
+bool Json::isNumber() const { return std::holds_alternative<double>(value_); }
+
+bool Json::isString() const {
+  return std::holds_alternative<std::string>(value_);
+}
+
+bool Json::isArray() const { return std::holds_alternative<array_t>(value_); }
+
+bool Json::isObject() const {
+  return std::holds_alternative<object_t>(value_);
+}
+
+bool Json::contains(const std::string_view key) const {
+  return !(*this)[key].isNull();
+}
+
+const Json& Json::operator[](const std::string_view key) const {
+  if (const auto* object = std::get_if<object_t>(&value_)) {
+    for (const auto& [name, value] : *object) {
+      if (name == key) {
+        return value;
+      }
+    }
+  }
+  return kNull;
+}
+
+const Json& Json::operator[](const size_t index) const {
+  if (const auto* array = std::get_if<array_t>(&value_)) {
+    if (index < array->size()) {
+      return (*array)[index];
+    }
+  }
+  return kNull;
+}
+
+size_t Json::size() const {
+  if (const auto* array = std::get_if<array_t>(&value_)) {
+    return array->size();
+  }
+  if (const auto* object = std::get_if<object_t>(&value_)) {
+    return object->size();
+  }
+  return 0;
+}
+
+double Json::number(const double fallback) const {
+  const auto* value = std::get_if<double>(&value_);
+  return value ? *value : fallback;
+}
+
+bool Json::boolean(const bool fallback) const {
+  const auto* value = std::get_if<bool>(&value_);
+  return value ? *value : fallback;
+}
+
+const std::string& Json::string() const {
+  const auto* value = std::get_if<std::string>(&value_);
+  return value ? *value : kEmptyString;
+}
+
+const Json::object_t& Json::members() const {
+  const auto* value = std::get_if<object_t>(&value_);
+  return value ? *value : kEmptyObject;
+}
+
+std::string quote(const std::string_view text) {
+  std::string quoted = "\"";
+  for (const auto c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+}  // namespace tinyrt
@@ -0,0 +1,74 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace tinyrt {
+// Read-only JSON document, enough for file format headers such as glTF.
+// Lookups of missing keys or indices return a null value rather than
+// throwing, so optional fields read as e.g. json["a"]["b"].number(1.f).
+class Json final {
+ public:
+  using array_t = std::vector<Json>;
+  // Objects are small in practice; a flat list keeps key order and avoids a
+  // map of an incomplete type.
+  using object_t = std::vector<std::pair<std::string, Json>>;
+
+  Json() = default;
+
+  // Throws std::invalid_argument on malformed input.
+  static Json parse(std::string_view text);
+
+  bool isNull() const;
+  bool isNumber() const;
+  bool isString() const;
+  bool isArray() const;
+  bool isObject() const;
+
+  bool contains(std::string_view key) const;
+  const Json& operator[](std::string_view key) const;
+  const Json& operator[](size_t index) const;
+  // Elements of an array or members of an object; 0 otherwise.
+  size_t size() const;
+
+  double number(double fallback = 0) const;
+  bool boolean(bool fallback = false) const;
+  const std::string& string() const;
+  const object_t& members() const;
+
+ private:
+  class Parser;
+
+  std::variant<std::nullptr_t, bool, double, std::string, array_t, object_t>
+      value_;
+};
+
+// JSON string literal of text, e.g. for replies that echo a path.
+std::string quote(std::string_view text);
+}  // namespace tinyrt
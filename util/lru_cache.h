@@ -0,0 +1,80 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace tinyrt {
+// Map of at most capacity entries that drops the least recently used one to
+// make room. Not thread-safe.
+template <typename TKey, typename TValue>
+class LruCache final {
+ public:
+  explicit LruCache(const size_t capacity) : capacity_(capacity) {}
+  LruCache(const LruCache&) = delete;
+  LruCache& operator=(const LruCache&) = delete;
+
+  // Returns the value for key, now the most recently used, or null.
+  TValue* find(const TKey& key) {
+    const auto it = index_.find(key);
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->second;
+  }
+
+  // Adds or replaces the value for key, evicting as needed, and returns it.
+  TValue& insert(const TKey& key, TValue value) {
+    erase(key);
+    // Evicted first, so that the old values go before the new one is in.
+    while (!entries_.empty() && entries_.size() >= capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(key, std::move(value));
+    index_.emplace(key, entries_.begin());
+    return entries_.front().second;
+  }
+
+  void erase(const TKey& key) {
+    if (const auto it = index_.find(key); it != index_.end()) {
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  using entry_t = std::pair<TKey, TValue>;
+
+  const size_t capacity_;
+  // Most recently used first.
+  std::list<entry_t> entries_;
+  std::unordered_map<TKey, typename std::list<entry_t>::iterator> index_;
+};
+}  // namespace tinyrt
@@ -0,0 +1,291 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "util/socket.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+namespace tinyrt {
+namespace {
+static std::system_error lastError(const char* what) {
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+static sockaddr_un unixAddress(const std::string& path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw std::system_error(std::make_error_code(std::errc::filename_too_long),
+                            path);
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+
+static Socket unixSocket() {
+  const auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw lastError("socket");
+  }
+  return Socket(fd);
+}
+
+// Small messages go out at once rather than wait to fill a segment. Fails
+// harmlessly on UNIX domain sockets.
+static void noDelay(const int fd) {
+  const int on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+// Calls connectOrBind with a new socket for each address of host:port in
+// turn, returning the first socket it succeeds with.
+template <typename TFunction>
+static Socket tcpSocket(const std::string& host, const std::string& port,
+                        const int flags, TFunction&& connectOrBind) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = flags;
+  addrinfo* addresses;
+  if (const auto error = ::getaddrinfo(host.empty() ? nullptr : host.c_str(),
+                                       port.c_str(), &hints, &addresses)) {
+    throw std::system_error(
+        std::make_error_code(std::errc::host_unreachable),
+        host + ":" + port + ": " + ::gai_strerror(error));
+  }
+  auto error = std::make_error_code(std::errc::host_unreachable);
+  for (auto* address = addresses; address; address = address->ai_next) {
+    const auto fd = ::socket(address->ai_family,
+                             address->ai_socktype | SOCK_CLOEXEC,
+                             address->ai_protocol);
+    if (fd < 0) {
+      error = std::error_code(errno, std::generic_category());
+      continue;
+    }
+    Socket socket(fd);
+    if (connectOrBind(fd, *address)) {
+      ::freeaddrinfo(addresses);
+      return socket;
+    }
+    error = std::error_code(errno, std::generic_category());
+  }
+  ::freeaddrinfo(addresses);
+  throw std::system_error(error, host + ":" + port);
+}
+
+// Splits a host:port address at its last ':'.
+static std::pair<std::string, std::string> hostPort(
+    const std::string& address) {
+  const auto colon = address.rfind(':');
+  return {address.substr(0, colon), address.substr(colon + 1)};
+}
+
+static bool isUnixPath(const std::string& address) {
+  return address.find('/') != std::string::npos ||
+         address.find(':') == std::string::npos;
+}
+}  // namespace
+
+Socket Socket::listenUnix(const std::string& path) {
+  const auto address = unixAddress(path);
+  auto socket = unixSocket();
+  struct stat status;
+  if (::lstat(path.c_str(), &status) == 0) {
+    if (!S_ISSOCK(status.st_mode)) {
+      throw std::system_error(EEXIST, std::generic_category(),
+                              path + " is not a socket");
+    }
+    ::unlink(path.c_str());
+  }
+  if (::bind(socket.fd_, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0) {
+    throw lastError("bind");
+  }
+  if (::listen(socket.fd_, SOMAXCONN) != 0) {
+    throw lastError("listen");
+  }
+  return socket;
+}
+
+Socket Socket::connectUnix(const std::string& path) {
+  const auto address = unixAddress(path);
+  auto socket = unixSocket();
+  if (::connect(socket.fd_, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) != 0) {
+    throw lastError("connect");
+  }
+  return socket;
+}
+
+Socket Socket::listenTcp(const std::string& host, const std::string& port) {
+  return tcpSocket(host, port, AI_PASSIVE, [](const int fd, auto& address) {
+    const int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    return ::bind(fd, address.ai_addr, address.ai_addrlen) == 0 &&
+           ::listen(fd, SOMAXCONN) == 0;
+  });
+}
+
+Socket Socket::connectTcp(const std::string& host, const std::string& port) {
+  return tcpSocket(host, port, 0, [](const int fd, auto& address) {
+    if (::connect(fd, address.ai_addr, address.ai_addrlen) != 0) {
+      return false;
+    }
+    noDelay(fd);
+    return true;
+  });
+}
+
+Socket Socket::listen(const std::string& address) {
+  if (isUnixPath(address)) {
+    return listenUnix(address);
+  }
+  const auto [host, port] = hostPort(address);
+  return listenTcp(host, port);
+}
+
+Socket Socket::connect(const std::string& address) {
+  if (isUnixPath(address)) {
+    return connectUnix(address);
+  }
+  const auto [host, port] = hostPort(address);
+  return connectTcp(host, port);
+}
+
+Socket::Socket(Socket&& other)
+    : fd_(std::exchange(other.fd_, -1)), buffer_(std::move(other.buffer_)) {}
+
+Socket& Socket::operator=(Socket&& other) {
+  if (this != &other) {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = std::exchange(other.fd_, -1);
+    buffer_ = std::move(other.buffer_);
+  }
+  return *this;
+}
+
+Socket::~Socket() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+Socket Socket::accept() const {
+  for (;;) {
+    const auto fd = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) {
+      noDelay(fd);
+      return Socket(fd);
+    }
+    if (errno != EINTR) {
+      throw lastError("accept");
+    }
+  }
+}
+
+std::optional<Socket> Socket::accept(
+    const std::chrono::milliseconds timeout) const {
+  pollfd listening{.fd = fd_, .events = POLLIN, .revents = 0};
+  const auto ready = ::poll(&listening, 1, timeout.count());
+  if (ready < 0 && errno != EINTR) {
+    throw lastError("poll");
+  }
+  if (ready <= 0) {
+    return std::nullopt;
+  }
+  return accept();
+}
+
+bool Socket::readLine(std::string& line) {
+  for (;;) {
+    if (const auto newline = buffer_.find('\n');
+        newline != std::string::npos) {
+      line = buffer_.substr(0, newline);
+      buffer_.erase(0, newline + 1);
+      return true;
+    }
+    char chunk[4096];
+    const auto size = ::read(fd_, chunk, sizeof(chunk));
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size < 0) {
+      throw lastError("read");
+    }
+    if (size == 0) {
+      // A last line without its newline still counts.
+      line = std::exchange(buffer_, {});
+      return !line.empty();
+    }
+    buffer_.append(chunk, size);
+  }
+}
+
+bool Socket::read(void* data, size_t size) {
+  auto* bytes = static_cast<char*>(data);
+  const auto buffered = std::min(size, buffer_.size());
+  std::memcpy(bytes, buffer_.data(), buffered);
+  buffer_.erase(0, buffered);
+  for (auto done = buffered; done < size;) {
+    const auto read = ::read(fd_, bytes + done, size - done);
+    if (read < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read < 0) {
+      throw lastError("read");
+    }
+    if (read == 0) {
+      return false;
+    }
+    done += read;
+  }
+  return true;
+}
+
+void Socket::write(std::string_view data) const {
+  while (!data.empty()) {
+    const auto size = ::send(fd_, data.data(), data.size(), MSG_NOSIGNAL);
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size < 0) {
+      throw lastError("write");
+    }
+    data.remove_prefix(size);
+  }
+}
+}  // namespace tinyrt
@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tinyrt {
+// Connected or listening stream socket that owns its descriptor, with
+// buffered reads of newline-terminated messages. Failures throw
+// std::system_error.
+class Socket final {
+ public:
+  // Listens on a UNIX domain socket at path, replacing a stale socket there.
+  // Fails if path is anything but a socket.
+  static Socket listenUnix(const std::string& path);
+  static Socket connectUnix(const std::string& path);
+  // TCP on host:port; an empty host listens on all interfaces.
+  static Socket listenTcp(const std::string& host, const std::string& port);
+  static Socket connectTcp(const std::string& host, const std::string& port);
+  // Either of the above by address: host:port for TCP, or a UNIX domain
+  // socket path if it has a '/' or no ':'.
+  static Socket listen(const std::string& address);
+  static Socket connect(const std::string& address);
+
+  explicit Socket(int fd) : fd_(fd) {}
+  Socket(Socket&& other);
+  Socket& operator=(Socket&& other);
+  ~Socket();
+
+  // Blocks for the next connection to a listening socket.
+  Socket accept() const;
+  // Same, but gives up after timeout.
+  std::optional<Socket> accept(std::chrono::milliseconds timeout) const;
+  // Reads the next line, without its newline. Returns false at the end of
+  // the stream.
+  bool readLine(std::string& line);
+  // Reads exactly size bytes, e.g. a payload announced by a line. Returns
+  // false if the stream ends first.
+  bool read(void* data, size_t size);
+  void write(std::string_view data) const;
+
+ private:
+  int fd_;
+  // Read past the last line returned.
+  std::string buffer_;
+};
+}  // namespace tinyrt
@@ -0,0 +1,71 @@
+// MIT License
+//
+// Copyright (c) 2020 Kaikai Wang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace tinyrt {
+// Splits the next line, without its terminator, off text.
+inline std::string_view nextLine(std::string_view& text) {
+  const auto end = text.find('\n');
+  const auto line = text.substr(0, end);
+  text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+  return line;
+}
+
+// Splits the next whitespace separated token off line; empty at its end.
+inline std::string_view nextToken(std::string_view& line) {
+  const auto isSpace = [](const char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  };
+  auto begin = 0UL;
+  while (begin < line.size() && isSpace(line[begin])) {
+    ++begin;
+  }
+  auto end = begin;
+  while (end < line.size() && !isSpace(line[end])) {
+    ++end;
+  }
+  const auto token = line.substr(begin, end - begin);
+  line.remove_prefix(end);
+  return token;
+}
+
+// Parses all of token as a T; throws std::invalid_argument otherwise.
+template <typename T>
+T parseNumber(std::string_view token) {
+  if (!token.empty() && token.front() == '+') {
+    token.remove_prefix(1);
+  }
+  T value{};
+  const auto* end = token.data() + token.size();
+  const auto [ptr, ec] = std::from_chars(token.data(), end, value);
+  if (ec != std::errc() || ptr != end) {
+    throw std::invalid_argument("Malformed number: " + std::string(token));
+  }
+  return value;
+}
+}  // namespace tinyrt